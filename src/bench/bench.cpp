@@ -0,0 +1,137 @@
+#include "bench.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <thread>
+
+namespace Bench {
+
+namespace {
+
+struct Sample {
+    double seconds = 0.0;
+    double cpu_seconds = 0.0;
+    u64 items = 0;
+};
+
+// upper limit for the calibration, protects against bodies that finish instantly
+constexpr u64 MAX_ITERATIONS = 1'000'000'000;
+
+std::vector<Benchmark> registry;
+std::vector<SelfCheck> check_registry;
+
+Sample Measure(const Body& body, u64 iterations) {
+    const std::clock_t cpu_start = std::clock();
+    const auto start = std::chrono::steady_clock::now();
+    const u64 items = body(iterations);
+    const auto end = std::chrono::steady_clock::now();
+    const std::clock_t cpu_end = std::clock();
+
+    return {
+        .seconds = std::chrono::duration<double>(end - start).count(),
+        .cpu_seconds = static_cast<double>(cpu_end - cpu_start) / CLOCKS_PER_SEC,
+        .items = items,
+    };
+}
+
+}    // namespace
+
+void Register(std::string name, std::string unit, Fixture fixture) {
+    registry.push_back({std::move(name), std::move(unit), std::move(fixture)});
+}
+
+const std::vector<Benchmark>& Registry() {
+    return registry;
+}
+
+void RegisterCheck(std::string name, Check check) {
+    check_registry.push_back({std::move(name), std::move(check)});
+}
+
+const std::vector<SelfCheck>& CheckRegistry() {
+    return check_registry;
+}
+
+Result Run(const Benchmark& benchmark, const Options& options) {
+    const Body body = benchmark.fixture();
+
+    // grow the iteration count until a run takes long enough to extrapolate the count for the minimum time
+    const double calibration_time = options.min_time / 10.0;
+    u64 iterations = 1;
+    for (;;) {
+        const Sample sample = Measure(body, iterations);
+        if (iterations >= MAX_ITERATIONS) break;
+
+        if (sample.seconds >= calibration_time) {
+            const double scale = options.min_time / sample.seconds;
+            iterations = static_cast<u64>(std::ceil(static_cast<double>(iterations) * scale));
+            break;
+        }
+
+        const double scale =
+            sample.seconds > 0.0 ? std::clamp(calibration_time / sample.seconds * 1.5, 2.0, 10.0) : 10.0;
+        iterations = static_cast<u64>(static_cast<double>(iterations) * scale);
+    }
+    iterations = std::clamp<u64>(iterations, 1, MAX_ITERATIONS);
+
+    std::vector<Sample> samples;
+    for (u32 i = 0; i < std::max(options.repetitions, 1u); i++) samples.push_back(Measure(body, iterations));
+
+    std::sort(samples.begin(), samples.end(), [](const Sample& a, const Sample& b) { return a.seconds < b.seconds; });
+    const Sample& median = samples[samples.size() / 2];
+
+    return {
+        .name = benchmark.name,
+        .unit = benchmark.unit,
+        .iterations = iterations,
+        .items = median.items,
+        .seconds = median.seconds,
+        .cpu_seconds = median.cpu_seconds,
+    };
+}
+
+bool WriteJSON(const std::string& path, const std::vector<Result>& results, const Options& options) {
+    std::FILE* file = std::fopen(path.c_str(), "w");
+    if (!file) return false;
+
+    char date[64] = {};
+    const std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+    std::fprintf(file, "{\n");
+    std::fprintf(file, "  \"context\": {\n");
+    std::fprintf(file, "    \"date\": \"%s\",\n", date);
+    std::fprintf(file, "    \"executable\": \"frustration-bench\",\n");
+    std::fprintf(file, "    \"num_cpus\": %u,\n", std::thread::hardware_concurrency());
+    std::fprintf(file, "    \"build_type\": \"%s\",\n", BENCH_BUILD_TYPE);
+    std::fprintf(file, "    \"min_time\": %g,\n", options.min_time);
+    std::fprintf(file, "    \"repetitions\": %u\n", options.repetitions);
+    std::fprintf(file, "  },\n");
+    std::fprintf(file, "  \"benchmarks\": [");
+
+    for (usize i = 0; i < results.size(); i++) {
+        const Result& result = results[i];
+
+        std::fprintf(file, "%s\n    {\n", i == 0 ? "" : ",");
+        std::fprintf(file, "      \"name\": \"%s\",\n", result.name.c_str());
+        std::fprintf(file, "      \"run_name\": \"%s\",\n", result.name.c_str());
+        std::fprintf(file, "      \"run_type\": \"iteration\",\n");
+        std::fprintf(file, "      \"repetitions\": %u,\n", options.repetitions);
+        std::fprintf(file, "      \"iterations\": %llu,\n", static_cast<unsigned long long>(result.iterations));
+        std::fprintf(file, "      \"real_time\": %.4f,\n", result.NanosecondsPerIteration());
+        std::fprintf(file, "      \"cpu_time\": %.4f,\n",
+                     result.cpu_seconds * 1e9 / static_cast<double>(result.iterations));
+        std::fprintf(file, "      \"time_unit\": \"ns\",\n");
+        std::fprintf(file, "      \"items_per_second\": %.4f,\n", result.ItemsPerSecond());
+        std::fprintf(file, "      \"label\": \"%s\"\n", result.unit.c_str());
+        std::fprintf(file, "    }");
+    }
+
+    std::fprintf(file, "\n  ]\n}\n");
+    return std::fclose(file) == 0;
+}
+
+}    // namespace Bench
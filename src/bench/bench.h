@@ -0,0 +1,82 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "util/types.h"
+
+// Minimal benchmark harness.
+// Every benchmark consists of a fixture that sets up the emulator state outside of the measurement
+// and returns the body that gets timed. The body runs the given number of iterations and returns
+// the number of processed items (instructions, primitives, words, ...).
+namespace Bench {
+
+using Body = std::function<u64(u64 iterations)>;
+using Fixture = std::function<Body()>;
+
+struct Benchmark {
+    std::string name;
+    // what a single item is, only used for the report
+    std::string unit;
+    Fixture fixture;
+};
+
+struct Options {
+    // minimum duration of a single repetition in seconds
+    double min_time = 0.5;
+    u32 repetitions = 3;
+};
+
+struct Result {
+    std::string name;
+    std::string unit;
+    u64 iterations = 0;
+    u64 items = 0;
+    // wall clock and process cpu time of the median repetition
+    double seconds = 0.0;
+    double cpu_seconds = 0.0;
+
+    double NanosecondsPerIteration() const { return seconds * 1e9 / static_cast<double>(iterations); }
+    double ItemsPerSecond() const { return static_cast<double>(items) / seconds; }
+};
+
+void Register(std::string name, std::string unit, Fixture fixture);
+const std::vector<Benchmark>& Registry();
+
+// Self-checks guard the optimized code paths the benchmarks measure, they compare them against a reference and
+// return false on a mismatch. They only run with --check.
+using Check = std::function<bool()>;
+
+struct SelfCheck {
+    std::string name;
+    Check check;
+};
+
+void RegisterCheck(std::string name, Check check);
+const std::vector<SelfCheck>& CheckRegistry();
+
+Result Run(const Benchmark& benchmark, const Options& options);
+
+// same layout as the JSON output of Google Benchmark, so existing comparison tools can be used
+bool WriteJSON(const std::string& path, const std::vector<Result>& results, const Options& options);
+
+// prevents the compiler from optimizing away the computation of a value
+template<typename T>
+ALWAYS_INLINE void DoNotOptimize(const T& value) {
+#ifdef _MSC_VER
+    const volatile T* volatile sink = &value;
+    (void)sink;
+#else
+    asm volatile("" : : "r,m"(value) : "memory");
+#endif
+}
+
+}    // namespace Bench
+
+// every file registers its benchmarks explicitly, which keeps the order of the report stable
+void RegisterCpuBenchmarks();
+void RegisterBusBenchmarks();
+void RegisterGpuBenchmarks();
+void RegisterGteBenchmarks();
+void RegisterDmaBenchmarks();
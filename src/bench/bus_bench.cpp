@@ -0,0 +1,75 @@
+#include <memory>
+#include <string>
+
+#include "bench.h"
+#include "bus.h"
+#include "system.h"
+
+namespace {
+
+struct Region {
+    const char* name;
+    u32 start;
+    // accesses cycle through a window of this size (power of two)
+    u32 window;
+    bool writable;
+};
+
+// clang-format off
+const Region REGIONS[] = {
+    {"ram_kuseg",   0x00010000, 16 * 1024, true},
+    {"ram_kseg0",   0x80010000, 16 * 1024, true},
+    {"ram_kseg1",   0xA0010000, 16 * 1024, true},
+    {"ram_mirror",  0x80610000, 16 * 1024, true},
+    {"scratchpad",  0x1F800000, 1024,      true},
+    {"bios",        0xBFC00000, 16 * 1024, false},
+    {"io_irq_mask", 0x1F801074, 1,         true},
+    {"io_spu",      0x1F801C00, 512,       true},
+};
+// clang-format on
+
+template<typename T>
+Bench::Body MakeLoadBody(const Region& region) {
+    auto sys = std::make_shared<System>();
+
+    return [sys, start = region.start, mask = region.window - 1](u64 iterations) -> u64 {
+        u32 sum = 0;
+        for (u64 i = 0; i < iterations; i++) {
+            const u32 address = start + ((static_cast<u32>(i) * sizeof(T)) & mask);
+            sum += sys->bus->Load<T>(address);
+        }
+        Bench::DoNotOptimize(sum);
+        return iterations;
+    };
+}
+
+template<typename T>
+Bench::Body MakeStoreBody(const Region& region) {
+    auto sys = std::make_shared<System>();
+
+    return [sys, start = region.start, mask = region.window - 1](u64 iterations) -> u64 {
+        for (u64 i = 0; i < iterations; i++) {
+            const u32 address = start + ((static_cast<u32>(i) * sizeof(T)) & mask);
+            // only the lower 7 bits of the interrupt mask are writable
+            sys->bus->Store<T>(address, static_cast<T>(i & 0x7F));
+        }
+        return iterations;
+    };
+}
+
+template<typename T>
+void RegisterRegion(const Region& region) {
+    const std::string suffix = std::to_string(sizeof(T) * 8) + "/" + region.name;
+
+    Bench::Register("bus/load" + suffix, "accesses", [&region] { return MakeLoadBody<T>(region); });
+    if (region.writable)
+        Bench::Register("bus/store" + suffix, "accesses", [&region] { return MakeStoreBody<T>(region); });
+}
+
+}    // namespace
+
+void RegisterBusBenchmarks() {
+    for (const Region& region : REGIONS) RegisterRegion<u32>(region);
+    for (const Region& region : REGIONS) RegisterRegion<u16>(region);
+    for (const Region& region : REGIONS) RegisterRegion<u8>(region);
+}
@@ -0,0 +1,190 @@
+#include <cstring>
+#include <memory>
+#include <span>
+#include <string>
+
+#include "bench.h"
+#include "bus.h"
+#include "cpu/cpu.h"
+#include "cpu/cpu_common.h"
+#include "system.h"
+
+namespace {
+
+using namespace CPU;
+
+constexpr u32 PROGRAM_START = 0x80010000;
+constexpr u32 DATA_START = 0x80020000;
+
+// register indices
+constexpr u32 ZERO = 0, T0 = 8, T1 = 9, T2 = 10, T3 = 11, T4 = 12, T5 = 13, T6 = 14, T7 = 15, S0 = 16, S1 = 17;
+constexpr u32 RA = 31;
+
+constexpr u32 IType(PrimaryOpcode op, u32 rs, u32 rt, u32 imm) {
+    return (static_cast<u32>(op) << 26) | (rs << 21) | (rt << 16) | (imm & 0xFFFF);
+}
+
+constexpr u32 RType(SecondaryOpcode sop, u32 rs, u32 rt, u32 rd, u32 sa = 0) {
+    return (rs << 21) | (rt << 16) | (rd << 11) | (sa << 6) | static_cast<u32>(sop);
+}
+
+constexpr u32 JType(PrimaryOpcode op, u32 target) {
+    return (static_cast<u32>(op) << 26) | ((target >> 2) & 0x3FFFFFF);
+}
+
+constexpr u32 COP2Move(CoprocessorOpcode op, u32 rt, u32 rd) {
+    return (static_cast<u32>(PrimaryOpcode::cop2) << 26) | (static_cast<u32>(op) << 21) | (rt << 16) | (rd << 11);
+}
+
+constexpr u32 COP2Command(u32 command) {
+    return (static_cast<u32>(PrimaryOpcode::cop2) << 26) | (1u << 25) | command;
+}
+
+// branch offset in instructions, relative to the delay slot
+constexpr u32 Offset(s32 from, s32 to) {
+    return static_cast<u32>(to - (from + 1));
+}
+
+constexpr u32 NOP = 0;
+
+// All programs are endless loops that start at PROGRAM_START and count their iterations in T0.
+// T0 has to stay zero until the loop starts.
+
+// mix of ALU, load/store and branch instructions
+// clang-format off
+constexpr u32 ALU_MIX_PROGRAM[] = {
+    IType(PrimaryOpcode::lui, ZERO, S0, DATA_START >> 16),
+    IType(PrimaryOpcode::addiu, ZERO, T0, 0),
+    // loop:
+    IType(PrimaryOpcode::lw, S0, T1, 0),
+    IType(PrimaryOpcode::addiu, T0, T0, 1),
+    RType(SecondaryOpcode::addu, T1, T0, T2),
+    RType(SecondaryOpcode::sll, ZERO, T2, T3, 2),
+    RType(SecondaryOpcode::xorr, T3, T0, T4),
+    IType(PrimaryOpcode::sw, S0, T4, 4),
+    IType(PrimaryOpcode::andi, T4, T5, 0xFF),
+    RType(SecondaryOpcode::slt, T5, T0, T6),
+    RType(SecondaryOpcode::orr, T6, T3, T7),
+    IType(PrimaryOpcode::bne, T0, ZERO, Offset(11, 2)),
+    IType(PrimaryOpcode::sw, S0, T7, 8),
+};
+
+// loads and stores of all sizes to RAM and the scratchpad
+constexpr u32 LOAD_STORE_PROGRAM[] = {
+    IType(PrimaryOpcode::lui, ZERO, S0, DATA_START >> 16),
+    IType(PrimaryOpcode::addiu, ZERO, T0, 0),
+    IType(PrimaryOpcode::lui, ZERO, S1, 0x1F80),
+    // loop:
+    IType(PrimaryOpcode::lw, S0, T1, 0),
+    IType(PrimaryOpcode::lh, S0, T2, 4),
+    IType(PrimaryOpcode::lbu, S0, T3, 8),
+    IType(PrimaryOpcode::sw, S0, T1, 12),
+    IType(PrimaryOpcode::sh, S1, T2, 0),
+    IType(PrimaryOpcode::sb, S1, T3, 4),
+    IType(PrimaryOpcode::lw, S1, T4, 0),
+    IType(PrimaryOpcode::addiu, T0, T0, 1),
+    IType(PrimaryOpcode::bne, T0, ZERO, Offset(11, 3)),
+    RType(SecondaryOpcode::addu, T4, T1, T5),
+};
+
+// short blocks connected by taken and not taken branches, a call and a return
+constexpr u32 BRANCH_PROGRAM[] = {
+    IType(PrimaryOpcode::lui, ZERO, S0, DATA_START >> 16),
+    IType(PrimaryOpcode::addiu, ZERO, T0, 0),
+    // loop:
+    IType(PrimaryOpcode::addiu, T0, T0, 1),
+    JType(PrimaryOpcode::jal, PROGRAM_START + 12 * 4),
+    NOP,
+    IType(PrimaryOpcode::beq, ZERO, ZERO, Offset(5, 8)),
+    IType(PrimaryOpcode::addiu, T2, T2, 1),
+    IType(PrimaryOpcode::addiu, T2, T2, 100),
+    // skip:
+    IType(PrimaryOpcode::bne, ZERO, ZERO, Offset(8, 2)),
+    NOP,
+    IType(PrimaryOpcode::bne, T0, ZERO, Offset(10, 2)),
+    NOP,
+    // function:
+    IType(PrimaryOpcode::addiu, T3, T3, 1),
+    RType(SecondaryOpcode::jr, RA, ZERO, ZERO),
+    NOP,
+};
+
+// loads a vertex into the GTE, projects it and reads the result before RTPS is done, which stalls the CPU
+constexpr u32 GTE_PROGRAM[] = {
+    IType(PrimaryOpcode::lui, ZERO, S0, DATA_START >> 16),
+    IType(PrimaryOpcode::addiu, ZERO, T0, 0),
+    // loop:
+    IType(PrimaryOpcode::lw, S0, T1, 0),
+    IType(PrimaryOpcode::lw, S0, T2, 4),
+    COP2Move(CoprocessorOpcode::mt, T1, 0),
+    COP2Move(CoprocessorOpcode::mt, T2, 1),
+    COP2Command((1u << 19) | 0x01),
+    IType(PrimaryOpcode::addiu, T0, T0, 1),
+    COP2Move(CoprocessorOpcode::mf, T3, 14),
+    RType(SecondaryOpcode::addu, T4, T1, T4),
+    IType(PrimaryOpcode::bne, T0, ZERO, Offset(10, 2)),
+    IType(PrimaryOpcode::sw, S0, T3, 8),
+};
+// clang-format on
+
+struct Program {
+    const char* name;
+    std::span<const u32> code;
+    // instructions executed per iteration
+    u32 loop_length;
+};
+
+const Program PROGRAMS[] = {
+    {"alu_mix", ALU_MIX_PROGRAM, 11},
+    {"load_store", LOAD_STORE_PROGRAM, 10},
+    {"branch", BRANCH_PROGRAM, 12},
+    {"gte", GTE_PROGRAM, 10},
+};
+
+enum class CpuMode { Uncached, CodeCache, Recompiler };
+
+// the loop counter is only checked between slices, which only overshoots by a few iterations
+constexpr u32 SLICE_CYCLES = 256;
+
+Bench::Body MakeCpuBody(const Program& program, CpuMode mode) {
+    auto sys = std::make_shared<System>();
+
+    // reset vector jumps straight into the test program
+    auto bios = sys->bus->BiosImage();
+    const u32 reset_code[] = {
+        IType(PrimaryOpcode::lui, ZERO, T1, PROGRAM_START >> 16),
+        RType(SecondaryOpcode::jr, T1, ZERO, ZERO),
+        NOP,
+    };
+    std::memcpy(bios.data(), reset_code, sizeof(reset_code));
+
+    for (u32 i = 0; i < program.code.size(); i++) sys->bus->Store<u32>(PROGRAM_START + i * 4, program.code[i]);
+
+    // also flushes the code cache
+    sys->cpu->SetCodeCacheEnabled(mode != CpuMode::Uncached);
+    sys->cpu->SetRecompilerEnabled(mode == CpuMode::Recompiler);
+
+    return [sys, loop_length = program.loop_length](u64 iterations) -> u64 {
+        // a single step can execute a whole block, so count loop iterations instead of steps
+        const u32 start = sys->cpu->gp.t0;
+        while (sys->cpu->gp.t0 - start < iterations) sys->cpu->Execute<false>(SLICE_CYCLES);
+        return static_cast<u64>(sys->cpu->gp.t0 - start) * loop_length;
+    };
+}
+
+}    // namespace
+
+void RegisterCpuBenchmarks() {
+    for (const Program& program : PROGRAMS) {
+        const std::string prefix = std::string("cpu/") + program.name;
+
+        Bench::Register(prefix + "/interpreter", "instructions",
+                        [&program] { return MakeCpuBody(program, CpuMode::Uncached); });
+        Bench::Register(prefix + "/code_cache", "instructions",
+                        [&program] { return MakeCpuBody(program, CpuMode::CodeCache); });
+        if (CPU::CPU::RecompilerAvailable()) {
+            Bench::Register(prefix + "/recompiler", "instructions",
+                            [&program] { return MakeCpuBody(program, CpuMode::Recompiler); });
+        }
+    }
+}
@@ -0,0 +1,90 @@
+#include <memory>
+#include <string>
+
+#include "bench.h"
+#include "bus.h"
+#include "dma.h"
+#include "gpu.h"
+#include "system.h"
+
+namespace {
+
+constexpr u32 LIST_START = 0x00100000;
+constexpr u32 END_MARKER = 0x00FFFFFF;
+
+// DMA control register, the default value with the GPU channel enabled like the BIOS does it
+constexpr u32 DPCR = 0x70;
+constexpr u32 DPCR_GPU_ENABLED = 0x07654B21;
+// DMA channel 2 (GPU) registers, relative to the start of the DMA registers
+constexpr u32 GPU_MADR = 0x20;
+constexpr u32 GPU_BCR = 0x24;
+constexpr u32 GPU_CHCR = 0x28;
+// RAM to device direction, linked list sync mode, start
+constexpr u32 LINKED_LIST_START = 0x01000401;
+// RAM to device direction, request sync mode, start
+constexpr u32 BLOCK_START = 0x01000201;
+
+// Builds a linked list like the ordering tables of games: a chain of nodes where only every n-th carries a packet.
+// Packets are 1x1 mono rectangles, so the time is spent on walking the list and not on rasterizing.
+Bench::Body MakeLinkedListBody(u32 node_count, u32 packet_interval) {
+    auto sys = std::make_shared<System>();
+    sys->dma->Store(DPCR, DPCR_GPU_ENABLED);
+
+    // clip the rectangles against a non-empty drawing area
+    sys->gpu->SendGP0Cmd(0xE3000000);
+    sys->gpu->SendGP0Cmd(0xE4000000 | (511 << 10) | 1023);
+
+    u32 address = LIST_START;
+    for (u32 i = 0; i < node_count; i++) {
+        const bool has_packet = packet_interval != 0 && (i % packet_interval) == 0;
+        const u32 size = has_packet ? 2 : 0;
+        const u32 next = i + 1 == node_count ? END_MARKER : address + 4 + size * 4;
+
+        sys->bus->Store<u32>(address, (size << 24) | next);
+        if (has_packet) {
+            sys->bus->Store<u32>(address + 4, 0x68000000 | (i & 0xFFFFFF));
+            sys->bus->Store<u32>(address + 8, ((i % 512) << 16) | (i % 1024));
+        }
+        address = next;
+    }
+
+    return [sys, node_count](u64 iterations) -> u64 {
+        for (u64 i = 0; i < iterations; i++) {
+            sys->dma->Store(GPU_MADR, LIST_START);
+            sys->dma->Store(GPU_CHCR, LINKED_LIST_START);
+        }
+        return iterations * node_count;
+    };
+}
+
+// Uploads an image to VRAM the way games do: the copy command goes through GP0 and the image data gets sent by DMA
+// in blocks of 16 words.
+Bench::Body MakeImageUploadBody(u32 width, u32 height) {
+    auto sys = std::make_shared<System>();
+    sys->dma->Store(DPCR, DPCR_GPU_ENABLED);
+
+    const u32 word_count = width * height / 2;
+    for (u32 i = 0; i < word_count; i++) sys->bus->Store<u32>(LIST_START + i * 4, i * 0x00010001);
+
+    return [sys, width, height, word_count](u64 iterations) -> u64 {
+        for (u64 i = 0; i < iterations; i++) {
+            sys->gpu->SendGP0Cmd(0xA0000000);
+            sys->gpu->SendGP0Cmd((128 << 16) | 128);
+            sys->gpu->SendGP0Cmd((height << 16) | width);
+
+            sys->dma->Store(GPU_MADR, LIST_START);
+            sys->dma->Store(GPU_BCR, ((word_count / 16) << 16) | 16);
+            sys->dma->Store(GPU_CHCR, BLOCK_START);
+        }
+        return iterations * width * height;
+    };
+}
+
+}    // namespace
+
+void RegisterDmaBenchmarks() {
+    Bench::Register("dma/gpu_linked_list/empty", "nodes", [] { return MakeLinkedListBody(1024, 0); });
+    Bench::Register("dma/gpu_linked_list/sparse", "nodes", [] { return MakeLinkedListBody(1024, 8); });
+    Bench::Register("dma/gpu_linked_list/dense", "nodes", [] { return MakeLinkedListBody(1024, 1); });
+    Bench::Register("dma/gpu_block/image_256x256", "pixels", [] { return MakeImageUploadBody(256, 256); });
+}
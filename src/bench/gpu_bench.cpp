@@ -0,0 +1,190 @@
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "gpu.h"
+#include "system.h"
+
+namespace {
+
+// texture page at (512, 0) and CLUT at (0, 480)
+constexpr u32 TEXPAGE_X = 512;
+constexpr u32 CLUT_Y = 480;
+
+constexpr u32 Position(u32 x, u32 y) {
+    return (y << 16) | x;
+}
+
+constexpr u32 TexCoord(u32 u, u32 v) {
+    return (v << 8) | u;
+}
+
+enum class Depth : u32 { Bit4 = 0, Bit8 = 1, Bit15 = 2 };
+
+constexpr u32 Texpage(Depth depth) {
+    return (TEXPAGE_X / 64) | (static_cast<u32>(depth) << 7);
+}
+
+constexpr u32 CLUT = CLUT_Y << 6;
+
+std::vector<u32> CopyToVram(u32 x, u32 y, u32 width, u32 height, u16 (*pixel)(u32 x, u32 y)) {
+    std::vector<u32> words = {0xA0000000, Position(x, y), Position(width, height)};
+    for (u32 i = 0; i < width * height; i += 2) {
+        const u32 first = pixel(i % width, i / width);
+        const u32 second = pixel((i + 1) % width, (i + 1) / width);
+        words.push_back(first | (second << 16));
+    }
+    return words;
+}
+
+// draw everything into the whole VRAM, fill the texture page and the CLUT with a pattern that has no transparent texels
+std::vector<u32> SetupWords() {
+    std::vector<u32> words = {
+        0xE1000000 | Texpage(Depth::Bit15),
+        0xE3000000 | Position(0, 0),
+        0xE4000000 | (511 << 10) | 1023,
+        0xE5000000,
+    };
+
+    const auto texture = CopyToVram(TEXPAGE_X, 0, 256, 256, [](u32 x, u32 y) { return u16(0x8421 | (x ^ y)); });
+    const auto clut = CopyToVram(0, CLUT_Y, 256, 1, [](u32 x, u32) { return u16(0x0421 * ((x & 0x1F) | 1)); });
+    words.insert(words.end(), texture.begin(), texture.end());
+    words.insert(words.end(), clut.begin(), clut.end());
+    return words;
+}
+
+struct Primitive {
+    const char* name;
+    std::vector<u32> words;
+};
+
+// all polygons cover 64x64 pixels
+std::vector<Primitive> Primitives() {
+    const u32 p0 = Position(16, 16), p1 = Position(80, 16), p2 = Position(16, 80), p3 = Position(80, 80);
+    const u32 t0 = TexCoord(0, 0), t1 = TexCoord(63, 0), t2 = TexCoord(0, 63), t3 = TexCoord(63, 63);
+    const u32 red = 0x0000FF, green = 0x00FF00, blue = 0xFF0000, gray = 0x808080;
+
+    const auto TexturedTriangle = [&](u32 op, Depth depth) {
+        return std::vector<u32>{op | gray, p0, (CLUT << 16) | t0, p1, (Texpage(depth) << 16) | t1, p2, t2};
+    };
+
+    // clang-format off
+    return {
+        {"triangle_mono",             {0x20000000 | red, p0, p1, p2}},
+        {"triangle_mono_semi",        {0x22000000 | red, p0, p1, p2}},
+        {"triangle_shaded",           {0x30000000 | red, p0, green, p1, blue, p2}},
+        {"triangle_textured_4bpp",    TexturedTriangle(0x24000000, Depth::Bit4)},
+        {"triangle_textured_8bpp",    TexturedTriangle(0x24000000, Depth::Bit8)},
+        {"triangle_textured_15bpp",   TexturedTriangle(0x24000000, Depth::Bit15)},
+        {"triangle_textured_raw",     TexturedTriangle(0x25000000, Depth::Bit15)},
+        {"triangle_textured_shaded",  {0x34000000 | red, p0, (CLUT << 16) | t0,
+                                       green, p1, (Texpage(Depth::Bit8) << 16) | t1, blue, p2, t2}},
+        {"quad_mono",                 {0x28000000 | red, p0, p1, p2, p3}},
+        {"quad_shaded",               {0x38000000 | red, p0, green, p1, blue, p2, gray, p3}},
+        {"quad_textured",             {0x2C000000 | gray, p0, (CLUT << 16) | t0, p1,
+                                       (Texpage(Depth::Bit8) << 16) | t1, p2, t2, p3, t3}},
+        {"rect_mono",                 {0x60000000 | red, p0, Position(64, 64)}},
+        {"rect_mono_16",              {0x78000000 | red, p0}},
+        {"rect_textured",             {0x64000000 | gray, p0, (CLUT << 16) | t0, Position(64, 64)}},
+        {"line_mono",                 {0x40000000 | red, p0, p3}},
+        {"line_shaded",               {0x50000000 | red, p0, blue, p3}},
+        {"polyline_mono",             {0x48000000 | red, p0, p1, p2, p3, 0x55555555}},
+    };
+    // clang-format on
+}
+
+// sends the same command words to GP0 in every iteration
+Bench::Body MakeGp0Body(std::vector<u32> words, u64 items_per_iteration) {
+    auto sys = std::make_shared<System>();
+    for (u32 word : SetupWords()) sys->gpu->SendGP0Cmd(word);
+
+    return [sys, words = std::move(words), items_per_iteration](u64 iterations) -> u64 {
+        for (u64 i = 0; i < iterations; i++) {
+            for (u32 word : words) sys->gpu->SendGP0Cmd(word);
+        }
+        return iterations * items_per_iteration;
+    };
+}
+
+// a frame worth of small overlapping triangles inside of a 320x240 framebuffer
+std::vector<u32> SceneWords(u32 triangle_count) {
+    std::vector<u32> words;
+    u32 seed = 1;
+    const auto Next = [&seed](u32 range) {
+        seed = seed * 1103515245 + 12345;
+        return (seed >> 16) % range;
+    };
+
+    for (u32 i = 0; i < triangle_count; i++) {
+        const u32 x = Next(320 - 48), y = Next(240 - 48);
+        words.insert(words.end(), {0x34000000 | Next(0x1000000), Position(x + Next(48), y + Next(48)),
+                                   (CLUT << 16) | TexCoord(Next(256), Next(256)), Next(0x1000000),
+                                   Position(x + Next(48), y + Next(48)),
+                                   (Texpage(Depth::Bit8) << 16) | TexCoord(Next(256), Next(256)), Next(0x1000000),
+                                   Position(x + Next(48), y + Next(48)), TexCoord(Next(256), Next(256))});
+    }
+    return words;
+}
+
+// reading VRAM is a sync point, so the time includes the rasterization of deferred draws
+Bench::Body MakeSceneBody(bool multithreaded, bool gpu_thread, u32 triangle_count) {
+    auto sys = std::make_shared<System>();
+    sys->gpu->SetMultithreadedRenderer(multithreaded);
+    sys->gpu->SetGpuThread(gpu_thread);
+    for (u32 word : SetupWords()) sys->gpu->SendGP0Cmd(word);
+
+    return [sys, words = SceneWords(triangle_count), triangle_count](u64 iterations) -> u64 {
+        for (u64 i = 0; i < iterations; i++) {
+            for (u32 word : words) sys->gpu->SendGP0Cmd(word);
+            Bench::DoNotOptimize(sys->gpu->GetVRAM()[0]);
+        }
+        return iterations * triangle_count;
+    };
+}
+
+// copies the display area out of VRAM every iteration, optionally after filling a single row inside of it
+Bench::Body MakeVideoOutputBody(bool write_row) {
+    auto sys = std::make_shared<System>();
+    for (u32 word : SetupWords()) sys->gpu->SendGP0Cmd(word);
+
+    return [sys, write_row](u64 iterations) -> u64 {
+        for (u64 i = 0; i < iterations; i++) {
+            if (write_row) {
+                for (u32 word : {0x02000000 | u32(i & 0xFFFFFF), Position(0, 16), Position(64, 1)})
+                    sys->gpu->SendGP0Cmd(word);
+            }
+            Bench::DoNotOptimize(sys->gpu->GetVideoOutput()[0]);
+        }
+        return iterations;
+    };
+}
+
+}    // namespace
+
+void RegisterGpuBenchmarks() {
+    for (Primitive& primitive : Primitives()) {
+        Bench::Register(std::string("gpu/draw/") + primitive.name, "primitives",
+                        [words = std::move(primitive.words)] { return MakeGp0Body(words, 1); });
+    }
+
+    Bench::Register("gpu/scene/sw", "triangles", [] { return MakeSceneBody(false, false, 2000); });
+    Bench::Register("gpu/scene/mt", "triangles", [] { return MakeSceneBody(true, false, 2000); });
+    Bench::Register("gpu/scene/sw_gpu_thread", "triangles", [] { return MakeSceneBody(false, true, 2000); });
+    Bench::Register("gpu/scene/mt_gpu_thread", "triangles", [] { return MakeSceneBody(true, true, 2000); });
+
+    Bench::Register("gpu/fill_vram/256x256", "pixels", [] {
+        return MakeGp0Body({0x02000000 | 0x402010, Position(128, 128), Position(256, 256)}, 256 * 256);
+    });
+
+    Bench::Register("gpu/copy_cpu_to_vram/64x64", "pixels", [] {
+        return MakeGp0Body(CopyToVram(128, 128, 64, 64, [](u32 x, u32 y) { return u16(x * y); }), 64 * 64);
+    });
+
+    Bench::Register("gpu/video_output/static", "frames", [] { return MakeVideoOutputBody(false); });
+    Bench::Register("gpu/video_output/one_row_changed", "frames", [] { return MakeVideoOutputBody(true); });
+
+    Bench::Register("gpu/copy_vram_to_vram/64x64", "pixels", [] {
+        return MakeGp0Body({0x80000000, Position(TEXPAGE_X, 0), Position(128, 128), Position(64, 64)}, 64 * 64);
+    });
+}
@@ -0,0 +1,216 @@
+#include <cstdio>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "bench.h"
+#include "cpu/gte.h"
+
+namespace {
+
+constexpr u32 SF = 1u << 19;
+constexpr u32 LM = 1u << 10;
+
+constexpr u32 MVMVA(u32 matrix, u32 vector, u32 translation) {
+    return 0x12 | (matrix << 17) | (vector << 15) | (translation << 13);
+}
+
+struct Command {
+    const char* name;
+    u32 value;
+};
+
+// clang-format off
+const Command COMMANDS[] = {
+    {"RTPS",  SF | 0x01},
+    {"NCLIP",      0x06},
+    {"OP",    SF | 0x0C},
+    {"DPCS",  SF | 0x10},
+    {"INTPL", SF | 0x11},
+    {"MVMVA_rt_v0_tr",  SF | MVMVA(0, 0, 0)},
+    {"MVMVA_llm_v0_bk", SF | LM | MVMVA(1, 0, 1)},
+    {"MVMVA_lcm_ir_fc", SF | LM | MVMVA(2, 3, 2)},
+    {"NCDS",  SF | LM | 0x13},
+    {"CDP",   SF | LM | 0x14},
+    {"NCDT",  SF | LM | 0x16},
+    {"NCCS",  SF | LM | 0x1B},
+    {"CC",    SF | LM | 0x1C},
+    {"NCS",   SF | LM | 0x1E},
+    {"NCT",   SF | LM | 0x20},
+    {"SQR",   SF | 0x28},
+    {"DCPL",  SF | LM | 0x29},
+    {"DPCT",  SF | LM | 0x2A},
+    {"AVSZ3",      0x2D},
+    {"AVSZ4",      0x2E},
+    {"RTPT",  SF | 0x30},
+    {"GPF",   SF | 0x3D},
+    {"GPL",   SF | 0x3E},
+    {"NCCT",  SF | LM | 0x3F},
+};
+
+// register index and value, typical values for a scene with a camera, one light and a few vertices
+constexpr std::pair<u32, u32> REGISTERS[] = {
+    // V0, V1, V2
+    {0, 0xFF80'0040}, {1, 0x0100},
+    {2, 0x0040'FFC0}, {3, 0x0180},
+    {4, 0xFFC0'FFC0}, {5, 0x0200},
+    // RGBC, IR0..IR3
+    {6, 0x3080'6040}, {8, 0x0800}, {9, 0x0400}, {10, 0xFC00}, {11, 0x0200},
+    // SXY0..SXY2
+    {12, 0x0020'0010}, {13, 0x0010'0080}, {14, 0x0090'0070},
+    // SZ0..SZ3
+    {16, 0x0400}, {17, 0x0500}, {18, 0x0600}, {19, 0x0700},
+    // rotation matrix (slightly rotated around the y axis) and translation
+    {32, 0x0000'0FB0}, {33, 0x0000'0180}, {34, 0x0000'1000}, {35, 0x0000'FE80}, {36, 0x0FB0},
+    {37, 0x0010}, {38, 0xFFF0}, {39, 0x0800},
+    // light matrix, background color, light color matrix and far color
+    {40, 0x0000'0800}, {41, 0x0800'0000}, {42, 0x0800'0000}, {43, 0x0000'0000}, {44, 0x0000},
+    {45, 0x0200}, {46, 0x0200}, {47, 0x0200},
+    {48, 0x0000'1000}, {49, 0x0000'0000}, {50, 0x0000'1000}, {51, 0x0000'0000}, {52, 0x1000},
+    {53, 0x0100}, {54, 0x0200}, {55, 0x0300},
+    // screen offset, projection plane distance, depth cueing and average z scale factors
+    {56, 160 << 16}, {57, 120 << 16}, {58, 0x0140}, {59, 0xFFFF'FF00}, {60, 0x0140'0000},
+    {61, 0x0155}, {62, 0x0100},
+};
+// clang-format on
+
+Bench::Body MakeGteBody(u32 command) {
+    auto gte = std::make_shared<GTE>();
+    gte->Reset();
+
+    return [gte, command](u64 iterations) -> u64 {
+        for (u64 i = 0; i < iterations; i++) {
+            // restore the inputs, otherwise the results of a command feed back into the next one and saturate
+            if ((i & 0xFF) == 0) {
+                for (const auto& [index, value] : REGISTERS) gte->SetReg(index, value);
+            }
+            gte->ExecuteCommand(command);
+        }
+        Bench::DoNotOptimize(gte->GetReg(63));
+        return iterations;
+    };
+}
+
+// RTPT over a large set of random vertices, unlike the fixed inputs above every perspective divide gets a new
+// divisor and the vertex data doesn't fit into the caches
+Bench::Body MakeRandomVerticesBody() {
+    static constexpr u32 VERTEX_COUNT = 3 << 20;
+
+    auto gte = std::make_shared<GTE>();
+    gte->Reset();
+    for (const auto& [index, value] : REGISTERS) gte->SetReg(index, value);
+
+    // VXY and VZ register values, all vertices end up in front of the camera (the translation z is 0x800)
+    auto vertices = std::make_shared<std::vector<std::pair<u32, u32>>>(VERTEX_COUNT);
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<s32> coord(-0x400, 0x400);
+    for (auto& [xy, z] : *vertices) {
+        xy = static_cast<u16>(coord(rng)) | (static_cast<u32>(static_cast<u16>(coord(rng))) << 16);
+        z = static_cast<u32>(coord(rng));
+    }
+
+    return [gte, vertices](u64 iterations) -> u64 {
+        u32 next = 0;
+        u32 sink = 0;
+        for (u64 i = 0; i < iterations; i++) {
+            for (u32 v = 0; v < 3; v++) {
+                gte->SetReg(v * 2, (*vertices)[next + v].first);
+                gte->SetReg(v * 2 + 1, (*vertices)[next + v].second);
+            }
+            next = (next + 3) % VERTEX_COUNT;
+
+            gte->ExecuteCommand(SF | 0x30);
+            sink += gte->GetReg(14);
+        }
+        Bench::DoNotOptimize(sink);
+        return iterations * 3;
+    };
+}
+
+// Random commands on random register contents, run twice: one GTE has its registers read right after every command,
+// the other one only after the inputs of the next command got written, which is where the deferred FLAG bits of the
+// lane kernels could go wrong. Both have to agree, and the registers read right after the commands have to hash to
+// the value recorded with the former implementation that built FLAG during the commands.
+bool CheckDeferredFlag() {
+    static constexpr u32 ITERATIONS = 200'000;
+    static constexpr u64 EXPECTED_HASH = 0x3933'9970'41F4'4585;
+
+    auto immediate = std::make_unique<GTE>();
+    auto deferred = std::make_unique<GTE>();
+    immediate->Reset();
+    deferred->Reset();
+
+    // every value gets its own statement, the evaluation order of operands is unspecified
+    std::mt19937 rng(1);
+    auto RandomValue = [&rng]() -> u32 {
+        const u32 kind = rng() % 5;
+        const u32 value = rng();
+        const u32 sign = rng();
+        switch (kind) {
+            // anything, most commands saturate
+            case 0: return value;
+            // all magnitudes of both signs
+            case 1: return static_cast<u32>(static_cast<s32>(value) >> (sign % 32));
+            // two small signed 16-bit halves
+            case 2: return (value & 0x0FFF'0FFF) | ((sign & 1) ? 0xF000'F000 : 0);
+            // close to the limits, translation and color vectors like that push the sums out of the 44-bit range
+            case 3: return ((sign & 1) ? 0x7FFF'F000 : 0x8000'0000) | (value & 0xFFF);
+            default: return static_cast<u32>(static_cast<s32>(value % 0x2000) - 0x1000);
+        }
+    };
+
+    u64 hash = 0xCBF2'9CE4'8422'2325;
+    u32 mismatches = 0;
+
+    for (u32 i = 0; i < ITERATIONS; i++) {
+        const u32 opcode = COMMANDS[rng() % std::size(COMMANDS)].value & 0x3F;
+        const u32 command = opcode | (rng() & (SF | LM | (0x3F << 13)));
+        immediate->ExecuteCommand(command);
+        deferred->ExecuteCommand(command);
+
+        // FLAG comes last, reading the other registers doesn't change it
+        for (u32 index = 0; index < 64; index++) hash = (hash ^ immediate->GetReg(index)) * 0x100'0000'01B3;
+
+        // inputs of the next command, FLAG itself included
+        const u32 writes = rng() % 6;
+        for (u32 w = 0; w < writes; w++) {
+            const u32 index = rng() % 64;
+            const u32 value = RandomValue();
+            immediate->SetReg(index, value);
+            deferred->SetReg(index, value);
+        }
+
+        // like games, the deferred GTE doesn't get its FLAG read after every command
+        if (rng() % 2) {
+            for (u32 index = 0; index < 64; index++) {
+                const u32 expected = immediate->GetReg(index);
+                const u32 value = deferred->GetReg(index);
+                if (value != expected && mismatches++ < 8) {
+                    std::printf("Command %u (0x%08X), register %u: 0x%08X instead of 0x%08X\n", i, command, index, value,
+                                expected);
+                }
+            }
+        }
+    }
+
+    if (hash != EXPECTED_HASH) {
+        std::printf("Register hash 0x%016llX instead of 0x%016llX\n", static_cast<unsigned long long>(hash),
+                    static_cast<unsigned long long>(EXPECTED_HASH));
+    }
+    return mismatches == 0 && hash == EXPECTED_HASH;
+}
+
+}    // namespace
+
+void RegisterGteBenchmarks() {
+    for (const Command& command : COMMANDS) {
+        Bench::Register(std::string("gte/") + command.name, "commands",
+                        [value = command.value] { return MakeGteBody(value); });
+    }
+    Bench::Register("gte/RTPT_random_vertices", "vertices", MakeRandomVerticesBody);
+
+    Bench::RegisterCheck("gte/deferred_flag", CheckDeferredFlag);
+}
@@ -0,0 +1,130 @@
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "bench.h"
+#include "common/log.h"
+
+namespace {
+
+void PrintUsageAndExit(int exit_code) {
+    std::printf("Usage: frustration-bench [options]\n\n");
+    std::printf("Options:\n");
+    std::printf("  -h, --help              Show this message\n");
+    std::printf("  -l, --list              List all benchmarks and exit\n");
+    std::printf("  -c, --check             Run the self-checks instead of the benchmarks, fails on a mismatch\n");
+    std::printf("  -f, --filter TEXT       Only run benchmarks whose name contains TEXT\n");
+    std::printf("  -j, --json FILE         Write the results to FILE as JSON\n");
+    std::printf("  -t, --min-time SECONDS  Minimum duration of a single repetition (default: %g)\n",
+                Bench::Options{}.min_time);
+    std::printf("  -r, --repetitions N     Number of repetitions, the median gets reported (default: %u)\n",
+                Bench::Options{}.repetitions);
+    std::exit(exit_code);
+}
+
+void PrintResult(const Bench::Result& result) {
+    double throughput = result.ItemsPerSecond();
+    const char* prefix = "";
+    if (throughput >= 1e9) {
+        throughput /= 1e9, prefix = "G";
+    } else if (throughput >= 1e6) {
+        throughput /= 1e6, prefix = "M";
+    } else if (throughput >= 1e3) {
+        throughput /= 1e3, prefix = "k";
+    }
+
+    std::printf("%-44s %12llu %12.1f ns %10.2f %s%s/s\n", result.name.c_str(),
+                static_cast<unsigned long long>(result.iterations), result.NanosecondsPerIteration(), throughput,
+                prefix, result.unit.c_str());
+    std::fflush(stdout);
+}
+
+}    // namespace
+
+int main(int argc, char* argv[]) {
+    Bench::Options options;
+    std::string filter;
+    std::string json_path;
+    bool list_only = false;
+    bool run_checks = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg(argv[i]);
+
+        auto NextArg = [&]() -> const char* {
+            if (i + 1 >= argc) PrintUsageAndExit(1);
+            return argv[++i];
+        };
+
+        if (arg == "-h" || arg == "--help") PrintUsageAndExit(0);
+
+        if (arg == "-l" || arg == "--list") {
+            list_only = true;
+        } else if (arg == "-c" || arg == "--check") {
+            run_checks = true;
+        } else if (arg == "-f" || arg == "--filter") {
+            filter = NextArg();
+        } else if (arg == "-j" || arg == "--json") {
+            json_path = NextArg();
+        } else if (arg == "-t" || arg == "--min-time") {
+            options.min_time = std::strtod(NextArg(), nullptr);
+            if (options.min_time <= 0.0) PrintUsageAndExit(1);
+        } else if (arg == "-r" || arg == "--repetitions") {
+            options.repetitions = static_cast<u32>(std::strtoul(NextArg(), nullptr, 10));
+            if (options.repetitions == 0) PrintUsageAndExit(1);
+        } else {
+            std::printf("Unknown argument '%s'\n", arg.data());
+            PrintUsageAndExit(1);
+        }
+    }
+
+    Log::Init(spdlog::level::warn);
+
+    RegisterCpuBenchmarks();
+    RegisterBusBenchmarks();
+    RegisterGpuBenchmarks();
+    RegisterGteBenchmarks();
+    RegisterDmaBenchmarks();
+
+    if (run_checks) {
+        int exit_code = 0;
+        for (const Bench::SelfCheck& check : Bench::CheckRegistry()) {
+            if (!filter.empty() && check.name.find(filter) == std::string::npos) continue;
+
+            const bool passed = check.check();
+            std::printf("%-44s %s\n", check.name.c_str(), passed ? "passed" : "FAILED");
+            std::fflush(stdout);
+            if (!passed) exit_code = 1;
+        }
+
+        Log::Shutdown();
+        return exit_code;
+    }
+
+    std::vector<Bench::Result> results;
+    for (const Bench::Benchmark& benchmark : Bench::Registry()) {
+        if (!filter.empty() && benchmark.name.find(filter) == std::string::npos) continue;
+
+        if (list_only) {
+            std::printf("%s\n", benchmark.name.c_str());
+            continue;
+        }
+
+        results.push_back(Bench::Run(benchmark, options));
+        PrintResult(results.back());
+    }
+
+    int exit_code = 0;
+    if (!json_path.empty() && !list_only) {
+        if (!Bench::WriteJSON(json_path, results, options)) {
+            std::printf("Failed to write results to %s\n", json_path.c_str());
+            exit_code = 1;
+        }
+    }
+
+    Log::Shutdown();
+
+    return exit_code;
+}
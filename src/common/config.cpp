@@ -16,6 +16,8 @@ constexpr char CONFIG_FILE[] = "frustration.ini";
 
 // ini section names
 constexpr char SEC_GENERAL[] = "General";
+constexpr char SEC_CPU[] = "CPU";
+constexpr char SEC_GPU[] = "GPU";
 constexpr char SEC_GDB[] = "GDB";
 }
 
@@ -25,15 +27,27 @@ constexpr char SEC_GDB[] = "GDB";
 // General
 ConfigEntry<std::string> bios_path {"SCPH1001.BIN"};
 
+// CPU
+ConfigEntry<bool> cpu_code_cache {true};
+ConfigEntry<bool> cpu_recompiler {true};
+
+// GPU
+ConfigEntry<bool> gpu_multithreaded_renderer {false};
+ConfigEntry<bool> gpu_thread {false};
+
 // GDB
 ConfigEntry<bool> gdb_server_enabled {false};
 ConfigEntry<u16> gdb_server_port {45678};
 
 // ### NOT SAVED TO FILE ###
 
+bool config_file_enabled = true;
+
 std::string psexe_file_path;
 std::string ps_bin_file_path;
 
+bool recompiler_differential_testing = false;
+
 // ImGUI
 bool draw_mem_viewer = true;
 bool draw_cpu_state = true;
@@ -43,9 +57,15 @@ bool draw_debugger = true;
 bool draw_timer_state = true;
 
 void SaveConfig() {
+    if (!config_file_enabled) return;
+
     CSimpleIniA ini;
 
     ini.SetValue(SEC_GENERAL, "BiosFilePath", bios_path.Get().c_str());
+    ini.SetValue(SEC_CPU, "CodeCache", std::to_string(cpu_code_cache.Get()).c_str());
+    ini.SetValue(SEC_CPU, "Recompiler", std::to_string(cpu_recompiler.Get()).c_str());
+    ini.SetValue(SEC_GPU, "MultithreadedRenderer", std::to_string(gpu_multithreaded_renderer.Get()).c_str());
+    ini.SetValue(SEC_GPU, "GpuThread", std::to_string(gpu_thread.Get()).c_str());
     ini.SetValue(SEC_GDB, "ServerEnabled", std::to_string(gdb_server_enabled.Get()).c_str());
     ini.SetValue(SEC_GDB, "ServerPort", std::to_string(gdb_server_port.Get()).c_str());
 
@@ -70,6 +90,10 @@ void LoadConfig() {
     }
 
     bios_path.Set(ini.GetValue(SEC_GENERAL, "BiosFilePath", ""));
+    cpu_code_cache.Set(ini.GetBoolValue(SEC_CPU, "CodeCache", true));
+    cpu_recompiler.Set(ini.GetBoolValue(SEC_CPU, "Recompiler", true));
+    gpu_multithreaded_renderer.Set(ini.GetBoolValue(SEC_GPU, "MultithreadedRenderer", false));
+    gpu_thread.Set(ini.GetBoolValue(SEC_GPU, "GpuThread", false));
     gdb_server_enabled.Set(ini.GetBoolValue(SEC_GDB, "ServerEnabled", false));
     gdb_server_port.Set((u16) ini.GetLongValue(SEC_GDB, "ServerPort", 0));
 }
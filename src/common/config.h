@@ -35,14 +35,28 @@ private:
 // General
 extern ConfigEntry<std::string> bios_path;
 
+// CPU
+extern ConfigEntry<bool> cpu_code_cache;
+extern ConfigEntry<bool> cpu_recompiler;
+
+// GPU
+extern ConfigEntry<bool> gpu_multithreaded_renderer;
+extern ConfigEntry<bool> gpu_thread;
+
 // GDB
 extern ConfigEntry<bool> gdb_server_enabled;
 extern ConfigEntry<u16> gdb_server_port;
 
 
+// headless runs must not touch the config file of the user
+extern bool config_file_enabled;
+
 extern std::string psexe_file_path;
 extern std::string ps_bin_file_path;
 
+// compare every recompiled block against the interpreter
+extern bool recompiler_differential_testing;
+
 // ImGUI
 extern bool draw_mem_viewer;
 extern bool draw_cpu_state;
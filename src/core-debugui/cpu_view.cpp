@@ -0,0 +1,82 @@
+#include "debug_ui.h"
+
+#include "imgui.h"
+
+#include "cpu/cpu.h"
+#include "system.h"
+
+namespace DebugUI {
+
+void DrawCpuState(System& sys, bool* open) {
+    auto& cpu = *sys.cpu;
+
+    ImGui::Begin("CPU State", open);
+    ImGui::Separator();
+
+    if (ImGui::TreeNode("Edit")) {
+        static int curr_gp_reg = 0;
+        ImGui::Text("GP Registers ");
+        ImGui::SameLine();
+        ImGui::Combo("##gp_reg_list", &curr_gp_reg, CPU::REG_NAMES, CPU::GP_REG_COUNT, 10);
+        ImGui::SameLine();
+        ImGui::InputScalar("##gp_reg_edit", ImGuiDataType_U32, &cpu.gp.r[curr_gp_reg], nullptr, nullptr, "%08X",
+                           ImGuiInputTextFlags_CharsHexadecimal);
+
+        static int curr_sp_reg = 0;
+        ImGui::Text("SP Registers ");
+        ImGui::SameLine();
+        ImGui::Combo("##sp_reg_list", &curr_sp_reg, CPU::SP_REG_NAMES, CPU::SP_REG_COUNT);
+        ImGui::SameLine();
+        ImGui::InputScalar("##sp_reg_edit", ImGuiDataType_U32, &cpu.sp.spr[curr_sp_reg], nullptr, nullptr, "%08X",
+                           ImGuiInputTextFlags_CharsHexadecimal);
+
+        static int curr_cop_reg = 0;
+        ImGui::Text("COP0 Registers ");
+        ImGui::SameLine();
+        ImGui::Combo("##cop_reg_list", &curr_cop_reg, CPU::COP0_REG_NAMES, CPU::COP_REG_COUNT, 10);
+        ImGui::SameLine();
+        ImGui::InputScalar("##cop_reg_edit", ImGuiDataType_U32, &cpu.cp.cpr[curr_cop_reg], nullptr, nullptr, "%08X",
+                           ImGuiInputTextFlags_CharsHexadecimal);
+
+        ImGui::TreePop();
+    }
+
+    ImGui::Separator();
+
+    ImGui::Text("GP Registers");
+    ImGui::Columns(4);
+    for (u32 col = 0; col < 4; col++) {
+        for (u32 row = 0; row < 8; row++) {
+            const u32 index = row + col * 8;
+            ImGui::Text(" $%-3s %08X", CPU::REG_NAMES[index], cpu.gp.r[row + col * 8]);
+        }
+        ImGui::NextColumn();
+    }
+    ImGui::Columns(1);
+
+    ImGui::Separator();
+    ImGui::Text("SP Registers");
+    ImGui::Columns(4);
+    ImGui::Text(" PC   %08X", cpu.sp.pc);
+    ImGui::NextColumn();
+    ImGui::Text(" HI   %08X", cpu.sp.hi);
+    ImGui::NextColumn();
+    ImGui::Text(" LO   %08X", cpu.sp.lo);
+    ImGui::Columns(1);
+
+    ImGui::Separator();
+    ImGui::Text("COP0 Registers");
+    ImGui::Columns(4);
+    for (u32 col = 0; col < 4; col++) {
+        for (u32 row = 0; row < 4; row++) {
+            const u32 index = row + col * 4;
+            ImGui::Text(" $%-10s %08X", CPU::COP0_REG_NAMES[index], cpu.cp.cpr[row + col * 4]);
+        }
+        ImGui::NextColumn();
+    }
+    ImGui::Columns(1);
+
+    ImGui::End();
+}
+
+}    // namespace DebugUI
@@ -0,0 +1,35 @@
+#include "debug_ui.h"
+
+#include "imgui.h"
+
+#include "common/config.h"
+#include "gpu.h"
+#include "system.h"
+
+namespace DebugUI {
+
+void DrawDebugWindows(System& sys) {
+    if (Config::draw_mem_viewer) DrawMemoryEditor(sys, &Config::draw_mem_viewer);
+    if (Config::draw_cpu_state) DrawCpuState(sys, &Config::draw_cpu_state);
+    if (Config::draw_gpu_state) DrawGpuState(sys, &Config::draw_gpu_state);
+    if (Config::draw_renderer_state) DrawRendererState(sys, &Config::draw_renderer_state);
+    if (Config::draw_debugger) DrawDebugger(sys, &Config::draw_debugger);
+    if (Config::draw_timer_state) DrawTimerState(sys, &Config::draw_timer_state);
+}
+
+void DrawRendererState(System& sys, bool* open) {
+    ImGui::Begin("Renderer", open);
+
+    ImGui::Text("Backend: %s", sys.gpu->RendererName());
+    ImGui::Separator();
+    ImGui::Text("Primitives");
+    ImGui::Separator();
+    ImGui::Text("Triangles per frame: %lu", sys.stats->frame_triangle_draw_count);
+    ImGui::Text("Rectangles per frame: %lu", sys.stats->frame_rectangle_draw_count);
+    ImGui::Text("Lines per frame: %lu", sys.stats->frame_line_draw_count);
+    ImGui::Separator();
+
+    ImGui::End();
+}
+
+}    // namespace DebugUI
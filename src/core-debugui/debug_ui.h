@@ -0,0 +1,19 @@
+#pragma once
+
+class System;
+
+// ImGui debug views for the emulation core
+// Kept out of the core library, all state is accessed through the public inspection API of the components
+namespace DebugUI {
+
+// draws every view that is enabled in the config
+void DrawDebugWindows(System& sys);
+
+void DrawMemoryEditor(System& sys, bool* open);
+void DrawCpuState(System& sys, bool* open);
+void DrawGpuState(System& sys, bool* open);
+void DrawRendererState(System& sys, bool* open);
+void DrawTimerState(System& sys, bool* open);
+void DrawDebugger(System& sys, bool* open);
+
+}    // namespace DebugUI
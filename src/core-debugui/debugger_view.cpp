@@ -0,0 +1,149 @@
+#include "debug_ui.h"
+
+#include <string>
+
+#include "imgui.h"
+
+#include "common/log.h"
+#include "cpu/cpu.h"
+#include "debugger/debugger.h"
+#include "system.h"
+
+LOG_CHANNEL(Debugger);
+
+namespace DebugUI {
+
+void DrawDebugger(System& sys, bool* open) {
+    auto& debugger = *sys.debugger;
+
+    ImGui::Begin("Debugger", open);
+
+    ImGui::Checkbox("Show instructions", &debugger.show_disasm_view);
+    ImGui::SameLine();
+    ImGui::Checkbox("Frame Step", &debugger.single_frame);
+    ImGui::SameLine();
+    ImGui::Checkbox("Single Step", &debugger.single_step);
+    ImGui::SameLine();
+
+    if (ImGui::Button("Continue") || ImGui::IsKeyReleased(ImGuiKey_F5)) {
+        sys.cpu->halt = false;
+        debugger.single_step = false;
+        debugger.single_frame = false;
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Next Frame") || ImGui::IsKeyReleased(ImGuiKey_F6)) {
+        if (debugger.single_frame) {
+            sys.cpu->halt = false;
+            sys.stats->ResetPerFrameStats();
+            LogInfo("Next Frame");
+        }
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Next Step") || ImGui::IsKeyReleased(ImGuiKey_F7)) {
+        if (debugger.single_step) sys.cpu->halt = false;
+    }
+
+    ImGui::Separator();
+
+    ImGui::PushID("__bp_view");
+    ImGui::Text("Breakpoints");
+    bool add_bp = ImGui::Button("Add");
+    ImGui::SameLine();
+    static u32 bp_address = 0u;
+    ImGui::InputScalar("", ImGuiDataType_U32, &bp_address, nullptr, nullptr, "%08X",
+                       ImGuiInputTextFlags_CharsHexadecimal);
+    if (add_bp) {
+        debugger.AddBreakpoint(bp_address);
+    }
+    if (debugger.HasBreakpoints()) {
+        if (ImGui::TreeNode("__breakpoint_node", "Active")) {
+            for (auto& entry : debugger.GetBreakpoints()) {
+                ImGui::PushID(entry.first);
+                ImGui::Text("Breakpoint @ 0x%08X", entry.first);
+                ImGui::SameLine();
+                if (ImGui::Button("-")) {
+                    debugger.RemoveBreakpoint(entry.first);
+                    ImGui::PopID();
+                    break;
+                }
+                ImGui::PopID();
+            }
+            ImGui::TreePop();
+        }
+    }
+    ImGui::PopID();
+    ImGui::Separator();
+
+#ifdef USE_WATCHPOINTS
+
+    ImGui::PushID("__wp_view");
+    ImGui::Text("Watchpoints");
+    bool add_wp = ImGui::Button("Add");
+    ImGui::SameLine();
+    static u32 wp_address = 0u;
+    ImGui::InputScalar("", ImGuiDataType_U32, &wp_address, nullptr, nullptr, "%08X",
+                       ImGuiInputTextFlags_CharsHexadecimal);
+    static bool on_read = true, on_write = true;
+    ImGui::SameLine();
+    ImGui::Checkbox("On Load", &on_read);
+    ImGui::SameLine();
+    ImGui::Checkbox("On Store", &on_write);
+    Debugger::Watchpoint::Type wp_type =
+        (on_read && on_write)
+            ? Debugger::Watchpoint::ENABLED
+            : (on_read ? Debugger::Watchpoint::ONLY_LOAD
+                       : (on_write ? Debugger::Watchpoint::ONLY_STORE : Debugger::Watchpoint::DISABLED));
+    if (add_wp) {
+        debugger.AddWatchpoint(wp_address, wp_type);
+    }
+    if (!debugger.GetWatchpoints().empty()) {
+        if (ImGui::TreeNode("__watchpoint_node", "Active")) {
+            for (auto& entry : debugger.GetWatchpoints()) {
+                ImGui::PushID(entry.first);
+                ImGui::Text("Watchpoint [%s] @ 0x%08X", entry.second.TypeToString(), entry.first);
+                ImGui::SameLine();
+                if (ImGui::Button("-")) {
+                    debugger.RemoveWatchpoint(entry.first);
+                    ImGui::PopID();
+                    break;
+                }
+                ImGui::PopID();
+            }
+            ImGui::TreePop();
+        }
+    }
+    ImGui::PopID();
+    ImGui::Separator();
+
+#endif
+
+    if (debugger.show_disasm_view) {
+        static bool locked_to_bottom = true;
+        const ImVec4 orange(.8f, .6f, .3f, 1.f);
+        const bool is_line_visible = ImGui::BeginChild("__disasm_view", ImVec2(0, 0), true, ImGuiWindowFlags_MenuBar);
+
+        if (ImGui::BeginMenuBar()) {
+            ImGui::Checkbox("Scroll lock", &locked_to_bottom);
+            ImGui::EndMenuBar();
+        }
+
+        if (is_line_visible) {
+            const auto last_instructions = debugger.GetLastInstructions();
+            for (usize i = 0; i < last_instructions.size(); i++) {
+                auto& instr = last_instructions[i];
+                const std::string line = sys.cpu->DisassembleInstruction(instr.first, instr.second);
+                if (i == last_instructions.size() - 1) {
+                    ImGui::TextColored(orange, "%s   <---", line.c_str());
+                } else {
+                    ImGui::TextUnformatted(line.c_str());
+                }
+                if (locked_to_bottom) ImGui::SetScrollHereY(1.f);
+            }
+        }
+        ImGui::EndChild();
+    }
+
+    ImGui::End();
+}
+
+}    // namespace DebugUI
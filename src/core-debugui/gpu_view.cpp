@@ -0,0 +1,78 @@
+#include "debug_ui.h"
+
+#include "imgui.h"
+
+#include "gpu.h"
+#include "system.h"
+
+namespace DebugUI {
+
+void DrawGpuState(System& sys, bool* open) {
+    auto& gpu = *sys.gpu;
+    const GPU::DebugState state = gpu.GetDebugState();
+    GPU::GpuStatus status;
+    status.value = state.status;
+
+    ImGui::Begin("GPU State", open);
+
+    ImGui::Columns(2);
+    ImGui::Text("Command buffer");
+    ImGui::Separator();
+    const ImVec4 white(1.0, 1.0, 1.0, 1.0);
+    const ImVec4 grey(0.5, 0.5, 0.5, 1.0);
+    for (u32 i = 0; i < 12; i++) {
+        ImGui::TextColored((i > state.command_counter) ? grey : white, " %-2d  %08X", i, state.command_buffer[i]);
+        if (i == state.command_counter) {
+            ImGui::SameLine();
+            ImGui::Text("  <--- cmd end");
+        }
+    }
+    ImGui::NextColumn();
+    if (ImGui::TreeNode("__gpustat_node", "GPUSTAT   0x%08X", status.value)) {
+        ImGui::Text("Tex page base: x=%u, y=%u", status.tex_page_x_base * 64, status.tex_page_y_base * 256);
+        ImGui::Text("Semi transparency: %u", status.semi_transparency.GetValue());
+        static const char* const formats[4] = {"4bit", "8bit", "15bit", "Invalid"};
+        ImGui::Text("Tex page format: %s", formats[status.tex_page_colors]);
+        ImGui::Text("Dithering: %s", status.dither ? "Enabled" : "Off");
+        ImGui::Text("Draw to display area: %s", status.draw_enable ? "Allowed" : "Prohibited");
+        ImGui::Text("Mask bit enabled: %s", status.mask_enable ? "Yes" : "No");
+        ImGui::Text("Draw to masked areas: %s", status.draw_pixels ? "No" : "Yes");
+        ImGui::Text("Interlace field: %u", status.interlace_field.GetValue());
+        ImGui::Text("Reverse flag: %u", status.reverse.GetValue());
+        ImGui::Text("Textures enabled: %s", status.tex_disable ? "No" : "Yes");
+        ImGui::Text("Vertical interlace: %u", status.vertical_interlace.GetValue());
+        ImGui::Text("Display enabled: %s", status.display_disabled ? "No" : "Yes");
+        ImGui::Text("Interrupt Request: %s", status.interrupt_request ? "IRQ1" : "Off");
+        ImGui::Text("DMA / Data Request: %u", status.dma_data_stat.GetValue());
+        ImGui::Text("Ready to receive command: %u", status.can_receive_cmd_word.GetValue());
+        ImGui::Text("Ready to send VRAM: %u", status.can_send_vram_to_cpu.GetValue());
+        ImGui::Text("Ready to receive DMA block: %u", status.can_receive_dma_block.GetValue());
+        ImGui::Text("DMA direction: %u", static_cast<u32>(status.dma_direction.GetValue()));
+        ImGui::Text("Interlace line: %s", status.interlace_even_or_odd_line ? "Odd" : "Even");
+
+        ImGui::TreePop();
+    }
+    ImGui::Text("Transfer mode  %s", state.command_mode ? "[COMMAND]" : "[DATA]");
+
+    ImGui::Text("Draw area [x,y]");
+    ImGui::Text("[%3d,%3d]------+", state.drawing_area_left, state.drawing_area_top);
+    ImGui::Text("    |          | ");
+    ImGui::Text("    +------[%3d,%3d]", state.drawing_area_right, state.drawing_area_bottom);
+
+    ImGui::Text("Draw offset:  x=%d, y=%d", state.drawing_x_offset, state.drawing_y_offset);
+    ImGui::Text("VRAM start:   x=%u, y=%u", state.display_vram_x_start, state.display_vram_y_start);
+    ImGui::Text("Horiz. range: start=%u, end=%u", state.display_horizontal_start, state.display_horizontal_end);
+    ImGui::Text("Line range:   start=%u, end=%u", state.display_line_start, state.display_line_end);
+
+    ImGui::Text("Video mode: %s - %d BPP", status.video_mode == GPU::VideoMode::NTSC ? "NTSC" : "PAL",
+                status.display_area_color_depth ? 24 : 15);
+    ImGui::Text("Horizontal resolution: %u", gpu.HorizontalRes());
+    ImGui::Text("Vertical resolution:   %u", gpu.VerticalRes());
+
+    ImGui::Columns(1);
+    ImGui::Separator();
+
+    ImGui::End();
+}
+
+}    // namespace DebugUI
@@ -0,0 +1,59 @@
+#include "debug_ui.h"
+
+#include "imgui.h"
+#include "imgui_memory_editor.h"
+
+#include "bus.h"
+#include "cpu/cpu.h"
+#include "gpu.h"
+#include "system.h"
+
+namespace DebugUI {
+
+void DrawMemoryEditor(System& sys, bool* open) {
+    // probably not very useful
+    static MemoryEditor mem_editor;
+    // edits bypass BUS::Store, so any cached code has to be dropped afterwards
+    static bool ram_modified = false;
+    // same for the decoded textures of the renderer
+    static bool vram_modified = false;
+    ImGui::Begin("Memory Editor", open);
+
+    if (ImGui::BeginTabBar("__mem_editor_tabs")) {
+        if (ImGui::BeginTabItem("RAM (2 MiB)")) {
+            mem_editor.WriteFn = [](ImU8* data, size_t offset, ImU8 value) {
+                data[offset] = value;
+                ram_modified = true;
+            };
+            mem_editor.DrawContents(sys.bus->Memory().RAM(), GuestMemory::RAM_SIZE, 0);
+            mem_editor.WriteFn = nullptr;
+            if (ram_modified) {
+                sys.cpu->FlushCodeCache();
+                ram_modified = false;
+            }
+            ImGui::EndTabItem();
+        }
+        if (ImGui::BeginTabItem("BIOS (512 KiB)")) {
+            auto bios = sys.bus->BiosImage();
+            mem_editor.DrawContents(bios.data(), bios.size(), 0);
+            ImGui::EndTabItem();
+        }
+        if (ImGui::BeginTabItem("VRAM (1 MiB)")) {
+            mem_editor.WriteFn = [](ImU8* data, size_t offset, ImU8 value) {
+                data[offset] = value;
+                vram_modified = true;
+            };
+            mem_editor.DrawContents((u8*)sys.gpu->GetVRAM(), GPU::VRAM_SIZE * 2, 0);
+            mem_editor.WriteFn = nullptr;
+            if (vram_modified) {
+                sys.gpu->InvalidateVram();
+                vram_modified = false;
+            }
+            ImGui::EndTabItem();
+        }
+        ImGui::EndTabBar();
+    }
+    ImGui::End();
+}
+
+}    // namespace DebugUI
@@ -0,0 +1,71 @@
+#include "debug_ui.h"
+
+#include "imgui.h"
+
+#include "system.h"
+#include "timer/timers.h"
+
+namespace DebugUI {
+
+void DrawTimerState(System& sys, bool* open) {
+    ImGui::Begin("Timer State", open);
+    ImGui::Columns(4);
+
+    const ImVec4 white(1.0, 1.0, 1.0, 1.0);
+    const ImVec4 grey(0.5, 0.5, 0.5, 1.0);
+
+    const auto ClockSourceName = [](Timer* timer) {
+        if (timer->IsUsingSystemClock()) return "System Clock";
+        switch (timer->index) {
+            case TMR0: return "Dotclock";
+            case TMR1: return "HBlank";
+            case TMR2: return "System Clock / 8";
+        }
+        return "XXX";
+    };
+
+    ImGui::Text("Status");
+    ImGui::Text("Counter");
+    ImGui::Text("Target");
+
+    ImGui::Text("Sync");
+    ImGui::Text("Sync mode");
+
+    ImGui::Text("IRQ on target");
+    ImGui::Text("IRQ on max value");
+
+    ImGui::Text("IRQ Mode");
+    ImGui::Text("IRQ Mode");
+
+    ImGui::Text("Clock Source");
+
+    ImGui::Text("IRQ allowed");
+    ImGui::Text("Reached target");
+    ImGui::Text("Reached max value");
+
+    ImGui::NextColumn();
+
+    for (u32 i = 0; i < 3; i++) {
+        auto& timer = sys.timers->timers[i];
+        ImGui::Text("TMR%u [%s]", i, timer->paused ? "paused" : "running");
+        ImGui::Text("%u", timer->counter);
+        ImGui::Text("%u [%s]", timer->target & 0xFFFF,
+                    timer->mode.reset_mode == ResetMode::AfterTarget ? "enabled" : "disabled");
+        ImGui::Text("%s", timer->mode.sync_enabled ? "enabled" : "disabled");
+        ImGui::TextColored(timer->mode.sync_enabled ? white : grey, "%u", timer->mode.sync_mode.GetValue());
+        ImGui::Text("%s", timer->mode.irq_on_target ? "yes" : "no");
+        ImGui::Text("%s", timer->mode.irq_on_max_value ? "yes" : "no");
+        ImGui::Text("%s", timer->mode.irq_repeat_mode ? "Repeat" : "One-Shot");
+        ImGui::Text("%s", timer->mode.irq_toggle_mode ? "Toggle" : "Pulse");
+        ImGui::Text("%s", ClockSourceName(timer));
+        ImGui::Text("%s", timer->mode.allow_irq ? "yes" : "no");
+        ImGui::Text("%s", timer->mode.reached_target ? "true" : "false");
+        ImGui::Text("%s", timer->mode.reached_max_value ? "true" : "false");
+        ImGui::NextColumn();
+    }
+    ImGui::Columns(1);
+
+    ImGui::End();
+}
+
+}    // namespace DebugUI
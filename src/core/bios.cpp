@@ -24,7 +24,7 @@ bool IsPatched() {
     return patched;
 }
 
-static void Patch(std::vector<u8>& bios_image, u32 address, u32 value) {
+static void Patch(std::span<u8> bios_image, u32 address, u32 value) {
     static constexpr u32 BIOS_START = 0x1FC00000;
     static constexpr u32 ADDR_MASK = 0x1FFFFFFF;
 
@@ -36,7 +36,7 @@ static void Patch(std::vector<u8>& bios_image, u32 address, u32 value) {
     std::memcpy(&bios_image[img_addr], &value, sizeof(value));
 }
 
-bool PatchBIOSForPSEXEInjection(std::vector<u8>& bios_image, u32 pc, u32 gp, u32 sp, u32 fp) {
+bool PatchBIOSForPSEXEInjection(std::span<u8> bios_image, u32 pc, u32 gp, u32 sp, u32 fp) {
     if (bios_image.empty()) return false;
 
     // injection point is inside the 'Main(...)' procedure (which starts at 0xBFC067E8)
@@ -1,6 +1,6 @@
 #pragma once
 
-#include <vector>
+#include <span>
 
 #include "util/types.h"
 
@@ -12,7 +12,7 @@ void PutChar(u8 value);
 
 bool IsPatched();
 
-bool PatchBIOSForPSEXEInjection(std::vector<u8>& bios_image, u32 pc, u32 gp, u32 sp, u32 fp);
+bool PatchBIOSForPSEXEInjection(std::span<u8> bios_image, u32 pc, u32 gp, u32 sp, u32 fp);
 
 void TraceFunction(System* sys, u32 address, u32 index);
 
@@ -1,10 +1,8 @@
 #include "bus.h"
 
+#include <cstring>
 #include <fstream>
 
-#include "imgui.h"
-#include "imgui_memory_editor.h"
-
 #include "bios.h"
 #include "cdrom.h"
 #include "common/asserts.h"
@@ -21,7 +19,26 @@
 
 LOG_CHANNEL(BUS);
 
-BUS::BUS(System* system) : sys(system), bios(BIOS_SIZE), ram(RAM_SIZE, 0xCA), scratchpad(SCRATCH_SIZE) {}
+BUS::BUS(System* system) : sys(system), page_flags(PAGE_COUNT) {
+    ram = memory.RAM();
+    bios = memory.BIOS();
+    scratchpad = memory.Scratchpad();
+    std::fill(ram, ram + RAM_SIZE, 0xCA);
+
+    BuildPageTable();
+}
+
+void BUS::BuildPageTable() {
+    const auto SetFlags = [this](u32 start, u32 size, u8 flags) {
+        for (u32 page = start >> PAGE_SHIFT; page < (start + size) >> PAGE_SHIFT; page++) page_flags[page] = flags;
+    };
+
+    // the mirrors go through the slow path if the host couldn't map them
+    SetFlags(RAM_START, memory.RAMMirrored() ? RAM_MIRROR_SIZE : RAM_SIZE, PAGE_READABLE | PAGE_WRITABLE);
+    // the scratchpad occupies a full page, only the first KiB is addressable on real hardware
+    SetFlags(SCRATCH_START, PAGE_SIZE, PAGE_READABLE | PAGE_WRITABLE);
+    SetFlags(BIOS_START, BIOS_SIZE, PAGE_READABLE);
+}
 
 bool BUS::LoadBIOS() {
     std::string path = Config::bios_path.Get();
@@ -41,7 +58,8 @@ bool BUS::LoadBIOS() {
         return false;
     }
 
-    file.read(reinterpret_cast<char*>(bios.data()), BIOS_SIZE);
+    file.read(reinterpret_cast<char*>(bios), BIOS_SIZE);
+    sys->cpu->code_cache.Flush();
     return true;
 }
 
@@ -98,11 +116,13 @@ bool BUS::LoadPsExe() {
     u32 fp_value = sp_value;
 
     // inject the trampoline
-    bool patch_success = BIOS::PatchBIOSForPSEXEInjection(bios, execution_start_addr, gp_value, sp_value, fp_value);
+    bool patch_success = BIOS::PatchBIOSForPSEXEInjection(BiosImage(), execution_start_addr, gp_value, sp_value, fp_value);
 
     if (patch_success) {
         // copy the executable into memory
-        std::memcpy(ram.data() + text_segment_start, buffer.data() + PSEXE_HEADER_SIZE, file_size);
+        std::memcpy(ram + text_segment_start, buffer.data() + PSEXE_HEADER_SIZE, file_size);
+        // both the BIOS and RAM contents changed
+        sys->cpu->code_cache.Flush();
 
         LogInfo("PSEXE file injected at:");
         LogInfo("    pc=0x{:08x}", execution_start_addr);
@@ -133,15 +153,23 @@ ValueType BUS::Load(u32 address) {
     }
 #endif
 
+    // RAM, scratchpad and BIOS
+    if ((DIRECT_SEGMENTS >> (address >> 29)) & 1) {
+        const u32 physical_addr = address & 0x1FFFFFFF;
+        if (page_flags[physical_addr >> PAGE_SHIFT] & PAGE_READABLE) [[likely]]
+            return *reinterpret_cast<const ValueType*>(memory.Base() + physical_addr);
+    }
+
     const u32 masked_addr = MaskRegion(address);
 
-    // RAM
-    if (InArea(RAM_START, RAM_SIZE, masked_addr)) return *reinterpret_cast<ValueType*>(ram.data() + masked_addr);
-    // Scratchpad
-    if (InArea(SCRATCH_START, SCRATCH_SIZE, masked_addr))
-        return *reinterpret_cast<ValueType*>(scratchpad.data() + (masked_addr - SCRATCH_START));
+    // RAM mirrors that couldn't be mapped
+    if (InArea(RAM_START, RAM_MIRROR_SIZE, masked_addr))
+        return *reinterpret_cast<ValueType*>(ram + (masked_addr & (RAM_SIZE - 1)));
+
     // IO Ports
     if (InArea(IO_PORTS_START, IO_PORTS_SIZE, masked_addr)) {
+        if (journal_active) [[unlikely]] journal_io_access = true;
+
         switch (masked_addr) {
             case (0x1F801070): return sys->interrupt->LoadStat();
             case (0x1F801074): return sys->interrupt->LoadMask();
@@ -167,9 +195,6 @@ ValueType BUS::Load(u32 address) {
 
         Panic("Tried to load from IO Ports [0x{:08X}]", address);
     }
-    // BIOS
-    if (InArea(BIOS_START, BIOS_SIZE, masked_addr))
-        return *reinterpret_cast<ValueType*>(bios.data() + (masked_addr - BIOS_START));
     // Cache Control
     if (InArea(CACHE_CTRL_START, CACHE_CTRL_SIZE, masked_addr))
         Panic("Tried to load from Cache Control [0x{:08X}]", address);
@@ -203,22 +228,38 @@ void BUS::Store(u32 address, Value value) {
     }
 #endif
 
+    // RAM and scratchpad
+    if ((DIRECT_SEGMENTS >> (address >> 29)) & 1) {
+        const u32 physical_addr = address & 0x1FFFFFFF;
+        if (page_flags[physical_addr >> PAGE_SHIFT] & PAGE_WRITABLE) [[likely]] {
+            u8* data = memory.Base() + physical_addr;
+            const bool in_ram = physical_addr < RAM_MIRROR_SIZE;
+            const u32 ram_addr = physical_addr & (RAM_SIZE - 1);
+
+            if (journal_active) [[unlikely]] RecordWrite(data, sizeof(value), in_ram, ram_addr);
+            // pages with cached code are write-protected if supported, the fault handler only marks them as dirty,
+            // their blocks get dropped right after the write so the CPU notices before its next instruction
+            std::copy(reinterpret_cast<u8*>(&value), reinterpret_cast<u8*>(&value) + sizeof(value), data);
+            if (memory.HasDirtyPages()) [[unlikely]] sys->cpu->code_cache.InvalidateDirtyPages();
+            else if (in_ram && !memory.SupportsWriteProtection()) sys->cpu->code_cache.InvalidateRAM(ram_addr);
+            return;
+        }
+    }
+
     const u32 masked_addr = MaskRegion(address);
 
-    // RAM
-    if (InArea(RAM_START, RAM_SIZE, masked_addr)) {
-        std::copy(reinterpret_cast<u8*>(&value), reinterpret_cast<u8*>(&value) + sizeof(value),
-                  ram.data() + masked_addr);
-        return;
-    }
-    // Scratchpad
-    if (InArea(SCRATCH_START, SCRATCH_SIZE, masked_addr)) {
-        std::copy(reinterpret_cast<u8*>(&value), reinterpret_cast<u8*>(&value) + sizeof(value),
-                  scratchpad.data() + (masked_addr - SCRATCH_START));
+    // RAM mirrors that couldn't be mapped
+    if (InArea(RAM_START, RAM_MIRROR_SIZE, masked_addr)) {
+        const u32 ram_addr = masked_addr & (RAM_SIZE - 1);
+        if (journal_active) [[unlikely]] RecordWrite(ram + ram_addr, sizeof(value), true, ram_addr);
+        std::copy(reinterpret_cast<u8*>(&value), reinterpret_cast<u8*>(&value) + sizeof(value), ram + ram_addr);
+        sys->cpu->code_cache.InvalidateRAM(ram_addr);
         return;
     }
     // IO Ports
     if (InArea(IO_PORTS_START, IO_PORTS_SIZE, masked_addr)) {
+        if (journal_active) [[unlikely]] journal_io_access = true;
+
         switch (masked_addr) {
             case (0x1F801070): sys->interrupt->StoreStat(value); return;
             case (0x1F801074): sys->interrupt->StoreMask(value); return;
@@ -282,6 +323,31 @@ void BUS::Store(u32 address, Value value) {
     LogCrit("Tried to store in invalid address [0x{:08X}]", address);
 }
 
+void BUS::StartWriteJournal() {
+    journal.clear();
+    journal_io_access = false;
+    journal_active = true;
+}
+
+bool BUS::StopWriteJournal() {
+    journal_active = false;
+    return !journal_io_access;
+}
+
+void BUS::RollbackWriteJournal() {
+    for (auto it = journal.rbegin(); it != journal.rend(); it++) {
+        std::memcpy(it->data, &it->old_value, it->size);
+        if (it->in_ram) sys->cpu->code_cache.InvalidateRAM(it->ram_address);
+    }
+    journal.clear();
+}
+
+void BUS::RecordWrite(u8* data, u32 size, bool in_ram, u32 ram_address) {
+    JournalEntry entry {data, 0, size, in_ram, ram_address};
+    std::memcpy(&entry.old_value, data, size);
+    journal.push_back(entry);
+}
+
 u8 BUS::Peek(u32 address) {
     // TODO: make Peek a template function like Load and Store
 
@@ -290,10 +356,10 @@ u8 BUS::Peek(u32 address) {
     const u32 physical_addr = MaskRegion(address);
 
     // RAM
-    if (InArea(RAM_START, RAM_SIZE, physical_addr)) return *(ram.data() + physical_addr);
+    if (InArea(RAM_START, RAM_MIRROR_SIZE, physical_addr)) return *(ram + (physical_addr & (RAM_SIZE - 1)));
     // Scratchpad
     if (InArea(SCRATCH_START, SCRATCH_SIZE, physical_addr))
-        return *(scratchpad.data() + (physical_addr - SCRATCH_START));
+        return *(scratchpad + (physical_addr - SCRATCH_START));
     // MMIO
     if (InArea(IO_PORTS_START, IO_PORTS_SIZE, physical_addr)) {
         if (InArea(0x1F801070, 4, physical_addr)) return ToU8(sys->interrupt->LoadStat());
@@ -314,7 +380,7 @@ u8 BUS::Peek(u32 address) {
         if (InArea(0x1F801040, 16, physical_addr)) return 0;     // Joypad
     }
     // BIOS
-    if (InArea(BIOS_START, BIOS_SIZE, physical_addr)) return *(bios.data() + (physical_addr - BIOS_START));
+    if (InArea(BIOS_START, BIOS_SIZE, physical_addr)) return *(bios + (physical_addr - BIOS_START));
     // Cache Control
     if (InArea(CACHE_CTRL_START, CACHE_CTRL_SIZE, physical_addr)) return 0;
     // Expansion Region 1
@@ -339,30 +405,8 @@ u32 BUS::Peek32(u32 address) {
 }
 
 void BUS::Reset() {
-    std::fill(ram.begin(), ram.end(), 0xCA);
-}
-
-void BUS::DrawMemEditor(bool* open) {
-    // probably not very useful
-    static MemoryEditor mem_editor;
-    ImGui::Begin("Memory Editor", open);
-
-    if (ImGui::BeginTabBar("__mem_editor_tabs")) {
-        if (ImGui::BeginTabItem("RAM (2 MiB)")) {
-            mem_editor.DrawContents(ram.data(), ram.size(), 0);
-            ImGui::EndTabItem();
-        }
-        if (ImGui::BeginTabItem("BIOS (512 KiB)")) {
-            mem_editor.DrawContents(bios.data(), bios.size(), 0);
-            ImGui::EndTabItem();
-        }
-        if (ImGui::BeginTabItem("VRAM (1 MiB)")) {
-            mem_editor.DrawContents((u8*)sys->gpu->GetVRAM(), GPU::VRAM_SIZE * 2, 0);
-            ImGui::EndTabItem();
-        }
-        ImGui::EndTabBar();
-    }
-    ImGui::End();
+    std::fill(ram, ram + RAM_SIZE, 0xCA);
+    sys->cpu->code_cache.Flush();
 }
 
 template u32 BUS::Load<u32>(u32 address);
@@ -1,8 +1,10 @@
 #pragma once
 
+#include <span>
 #include <string>
 #include <vector>
 
+#include "guest_memory.h"
 #include "util/types.h"
 
 class System;
@@ -18,26 +20,48 @@ public:
     bool LoadBIOS();
     bool LoadPsExe();
 
-    void DrawMemEditor(bool* open);
 
     template<typename ValueType>
     ValueType Load(u32 address);
     template<typename Value>
     void Store(u32 address, Value value);
 
-    std::vector<u8>& BiosImage() {
-        return bios;
+    std::span<u8> BiosImage() {
+        return {bios, BIOS_SIZE};
     }
 
+    GuestMemory& Memory() { return memory; }
+
     // read from memory without causing side effects (i.e. MMIO state changes)
     u8 Peek(u32 address);
     u32 Peek32(u32 address);
 
+    // records all RAM and scratchpad writes so they can be reverted (used by the recompiler differential testing)
+    void StartWriteJournal();
+    // returns false if the IO ports were accessed while recording, these accesses can't be reverted
+    bool StopWriteJournal();
+    void RollbackWriteJournal();
+
 private:
+    struct JournalEntry {
+        u8* data = nullptr;
+        u32 old_value = 0;
+        u32 size = 0;
+        // only set for RAM writes, the code cache has to be notified during rollback
+        bool in_ram = false;
+        u32 ram_address = 0;
+    };
+
+    void RecordWrite(u8* data, u32 size, bool in_ram, u32 ram_address);
+
+    void BuildPageTable();
+
     ALWAYS_INLINE static u32 MaskRegion(u32 address) { return address & MEM_REGION_MASKS[address >> 29]; }
 
     static constexpr u32 BIOS_SIZE = 512 * 1024;
     static constexpr u32 RAM_SIZE = 2048 * 1024;
+    // the first 8 MiB contain four mirrors of RAM
+    static constexpr u32 RAM_MIRROR_SIZE = 4 * RAM_SIZE;
     static constexpr u32 SCRATCH_SIZE = 1024;
     static constexpr u32 CACHE_CTRL_SIZE = 512;
     static constexpr u32 IO_PORTS_SIZE = 8 * 1024;
@@ -56,6 +80,16 @@ private:
 
     static constexpr u32 PSEXE_HEADER_SIZE = 0x800;
 
+    static constexpr u32 PAGE_SHIFT = GuestMemory::PAGE_SHIFT;
+    static constexpr u32 PAGE_SIZE = GuestMemory::PAGE_SIZE;
+    static constexpr u32 PAGE_COUNT = GuestMemory::ADDRESS_SPACE_SIZE >> PAGE_SHIFT;
+
+    static constexpr u8 PAGE_READABLE = 1 << 0;
+    static constexpr u8 PAGE_WRITABLE = 1 << 1;
+
+    // KUSEG (first 512 MiB), KSEG0 and KSEG1 map straight into the physical address space
+    static constexpr u32 DIRECT_SEGMENTS = (1 << 0) | (1 << 4) | (1 << 5);
+
     static constexpr u32 MEM_REGION_MASKS[8] = {
         // KUSEG - 2048 MB
         0xFFFFFFFF,
@@ -73,7 +107,17 @@ private:
 
     System* sys = nullptr;
 
-    std::vector<u8> bios;
-    std::vector<u8> ram;
-    std::vector<u8> scratchpad;
+    GuestMemory memory;
+    // views into the guest memory, BIOS is the writable alias
+    u8* ram = nullptr;
+    u8* bios = nullptr;
+    u8* scratchpad = nullptr;
+
+    // access flags for every 4 KiB page of the physical address space
+    // pages without the matching flag go down the slow path (MMIO, BIOS writes, unmapped regions)
+    std::vector<u8> page_flags;
+
+    bool journal_active = false;
+    bool journal_io_access = false;
+    std::vector<JournalEntry> journal;
 };
@@ -16,10 +16,6 @@ CDROM::CDROM(System* system) : sys(system) {
 
     cycles_until_first_response = MaxCycles;
     cycles_until_second_response = MaxCycles;
-
-    // register timed event
-    sys->RegisterEvent(
-        System::TimedEvent::CDROM, [this](u32 cycles) { Step(cycles); }, [this]() { return CyclesUntilNextEvent(); });
 }
 
 void CDROM::Step(u32 cycles) {
@@ -277,7 +273,7 @@ void CDROM::Store(u32 address, u8 value) {
             pending_command = static_cast<Command>(value);
             ScheduleFirstResponse();
 
-            sys->RecalculateCyclesUntilNextEvent();
+            sys->Schedule(System::TimedEvent::CDROM, CyclesUntilNextEvent());
         }
         if (index == 1 || index == 2 || index == 3) Panic("Unimplemented");
         return;
@@ -299,7 +295,7 @@ void CDROM::Store(u32 address, u8 value) {
             // if an interrupt was waiting it can be sent now
             SendInterrupt();
 
-            sys->RecalculateCyclesUntilNextEvent();
+            sys->Schedule(System::TimedEvent::CDROM, CyclesUntilNextEvent());
         }
         if (index == 2 || index == 3) Panic("Unimplemented");
         return;
@@ -341,7 +337,7 @@ void CDROM::Store(u32 address, u8 value) {
                 }
             }
 
-            sys->RecalculateCyclesUntilNextEvent();
+            sys->Schedule(System::TimedEvent::CDROM, CyclesUntilNextEvent());
         }
         if (index == 2 || index == 3) Panic("Unimplemented");
         return;
@@ -0,0 +1,147 @@
+#include "code_cache.h"
+
+#include <algorithm>
+#include <bit>
+
+#include "bus.h"
+#include "common/asserts.h"
+#include "common/log.h"
+#include "cpu.h"
+#include "system.h"
+
+LOG_CHANNEL(CodeCache);
+
+namespace CPU {
+
+CodeCache::CodeCache(CPU* cpu) : cpu(cpu), ram_blocks(RAM_SIZE / 4), bios_blocks(BIOS_SIZE / 4) {}
+
+CodeCache::~CodeCache() = default;
+
+CodeBlock* CodeCache::GetBlock(u32 address) {
+    // the previous instruction is done by now, nothing can reference the retired blocks anymore
+    if (!retired_blocks.empty()) retired_blocks.clear();
+
+    // writes that didn't go through the BUS (e.g. loading an executable) only got marked by the fault handler
+    if (cpu->sys->bus->Memory().HasDirtyPages()) [[unlikely]] InvalidateDirtyPages();
+
+    if (address & 0x3) return nullptr;
+
+    // only KUSEG (first 512 MiB), KSEG0 and KSEG1 map directly to physical memory
+    const u32 segment = address >> 29;
+    if (segment != 0 && segment != 4 && segment != 5) return nullptr;
+
+    const u32 physical_address = address & 0x1FFFFFFF;
+
+    if (physical_address < RAM_SIZE) {
+        auto& block = ram_blocks[physical_address >> 2];
+        if (block) [[likely]] return block.get();
+        return CompileBlock(address, physical_address, RAM_SIZE);
+    }
+
+    if (physical_address >= BIOS_START && physical_address < BIOS_START + BIOS_SIZE) {
+        auto& block = bios_blocks[(physical_address - BIOS_START) >> 2];
+        if (block) [[likely]] return block.get();
+        return CompileBlock(address, physical_address, BIOS_START + BIOS_SIZE);
+    }
+
+    return nullptr;
+}
+
+CodeBlock* CodeCache::CompileBlock(u32 address, u32 physical_address, u32 region_end) {
+    auto block = std::make_unique<CodeBlock>();
+    block->physical_address = physical_address;
+
+    const u32 max_size = std::min(MAX_BLOCK_SIZE, (region_end - physical_address) / 4);
+    block->instructions.reserve(max_size);
+
+    bool in_delay_slot = false;
+    for (u32 i = 0; i < max_size; i++) {
+        // RAM and BIOS loads don't have any side effects
+        const DecodedInstruction decoded = CPU::Decode(cpu->Load32(address + i * 4));
+        block->instructions.push_back(decoded);
+
+        // the block ends after the delay slot of the first branch
+        if (in_delay_slot) break;
+        in_delay_slot = decoded.is_branch;
+    }
+
+    const u32 last_address = physical_address + static_cast<u32>(block->instructions.size() - 1) * 4;
+    CodeBlock* result = block.get();
+    compiled_block_count++;
+
+    if (physical_address < RAM_SIZE) {
+        block->first_page = physical_address >> PAGE_SHIFT;
+        block->last_page = last_address >> PAGE_SHIFT;
+        for (u32 page = block->first_page; page <= block->last_page; page++) {
+            if (page_blocks[page].empty()) SetPageWriteProtection(page, true);
+            page_blocks[page].push_back(result);
+        }
+
+        ram_blocks[physical_address >> 2] = std::move(block);
+    } else {
+        const u32 index = (physical_address - BIOS_START) >> 2;
+        bios_block_indices.push_back(index);
+
+        bios_blocks[index] = std::move(block);
+    }
+
+    return result;
+}
+
+void CodeCache::InvalidatePage(u32 page) {
+    DebugAssert(page < RAM_PAGE_COUNT);
+
+    std::vector<CodeBlock*> blocks;
+    blocks.swap(page_blocks[page]);
+    SetPageWriteProtection(page, false);
+
+    for (CodeBlock* block : blocks) RetireBlock(block, page);
+}
+
+void CodeCache::InvalidateDirtyPages() {
+    const GuestMemory::PageBits pages = cpu->sys->bus->Memory().TakeDirtyPages();
+
+    for (u32 i = 0; i < pages.size(); i++) {
+        for (u64 bits = pages[i]; bits != 0; bits &= bits - 1) {
+            // also brings the protection state in line with the page the fault handler made writable
+            InvalidatePage(i * 64 + static_cast<u32>(std::countr_zero(bits)));
+        }
+    }
+}
+
+void CodeCache::RetireBlock(CodeBlock* block, u32 skip_page) {
+    block->valid = false;
+    invalidated_block_count++;
+
+    // remove all remaining references from the other pages the block overlaps with
+    for (u32 page = block->first_page; page <= block->last_page; page++) {
+        if (page == skip_page) continue;
+        std::erase(page_blocks[page], block);
+        if (page_blocks[page].empty()) SetPageWriteProtection(page, false);
+    }
+
+    auto& slot = ram_blocks[block->physical_address >> 2];
+    DebugAssert(slot.get() == block);
+    retired_blocks.push_back(std::move(slot));
+}
+
+void CodeCache::SetPageWriteProtection(u32 page, bool write_protected) {
+    cpu->sys->bus->Memory().SetRAMPageWriteProtection(page, write_protected);
+}
+
+void CodeCache::Flush() {
+    for (u32 page = 0; page < RAM_PAGE_COUNT; page++) {
+        if (!page_blocks[page].empty()) InvalidatePage(page);
+    }
+
+    for (u32 index : bios_block_indices) {
+        bios_blocks[index]->valid = false;
+        invalidated_block_count++;
+        retired_blocks.push_back(std::move(bios_blocks[index]));
+    }
+    bios_block_indices.clear();
+
+    LogDebug("Flushed code cache");
+}
+
+}    // namespace CPU
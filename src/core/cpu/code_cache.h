@@ -0,0 +1,103 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <vector>
+
+#include "cpu_common.h"
+#include "util/types.h"
+
+namespace CPU {
+
+class CPU;
+struct DecodedInstruction;
+
+using InstructionHandler = void (*)(CPU& cpu, const DecodedInstruction& i);
+// entry point of a recompiled block, returns the number of cycles spent inside the block
+using HostCode = u32 (*)(CPU* cpu);
+
+// instruction with all fields extracted and the handler resolved ahead of time
+struct DecodedInstruction {
+    InstructionHandler handler = nullptr;
+    u32 value = 0;
+    // sign or zero extended immediate, depending on the instruction
+    // branches store the byte offset and jumps the shifted target address
+    u32 imm = 0;
+    u8 rs = 0, rt = 0, rd = 0, sa = 0;
+    bool is_branch = false;
+};
+
+// sequence of decoded instructions that ends with a branch and its delay slot
+struct CodeBlock {
+    u32 physical_address = 0;
+    u32 first_page = 0, last_page = 0;
+    bool valid = true;
+
+    // the recompiled code depends on the virtual address the block was compiled for
+    HostCode host_code = nullptr;
+    u32 host_code_address = 0;
+    bool recompile_failed = false;
+
+    std::vector<DecodedInstruction> instructions;
+};
+
+// Caches decoded basic blocks of code located in RAM and BIOS, keyed by physical address.
+// Blocks are invalidated on a per-page basis whenever the CPU or a DMA channel writes to a RAM page containing code.
+class CodeCache {
+public:
+    explicit CodeCache(CPU* cpu);
+    ~CodeCache();
+
+    // returns nullptr if the address can't be cached (e.g. misaligned or not in RAM/BIOS)
+    CodeBlock* GetBlock(u32 address);
+
+    // has to be called for every write to RAM unless the guest memory supports write protection
+    // expects a physical address
+    ALWAYS_INLINE void InvalidateRAM(u32 physical_address) {
+        const u32 page = (physical_address & (RAM_SIZE - 1)) >> PAGE_SHIFT;
+        if (!page_blocks[page].empty()) [[unlikely]] InvalidatePage(page);
+    }
+
+    // drops the blocks on the pages the write fault handler of the guest memory marked as dirty
+    void InvalidateDirtyPages();
+
+    // drop all blocks (e.g. after loading a new BIOS image or a bulk copy into RAM)
+    void Flush();
+
+    u64 CompiledBlockCount() const { return compiled_block_count; }
+    u64 InvalidatedBlockCount() const { return invalidated_block_count; }
+
+    static constexpr u32 MAX_BLOCK_SIZE = 128;
+
+private:
+    CodeBlock* CompileBlock(u32 address, u32 physical_address, u32 region_end);
+    void InvalidatePage(u32 page);
+    void RetireBlock(CodeBlock* block, u32 skip_page);
+    // writes to protected pages trap and mark the page as dirty (if the host supports it)
+    void SetPageWriteProtection(u32 page, bool write_protected);
+
+    static constexpr u32 RAM_SIZE = 2048 * 1024;
+    static constexpr u32 BIOS_START = 0x1FC00000;
+    static constexpr u32 BIOS_SIZE = 512 * 1024;
+
+    static constexpr u32 PAGE_SHIFT = 12;
+    static constexpr u32 RAM_PAGE_COUNT = RAM_SIZE >> PAGE_SHIFT;
+
+    CPU* cpu = nullptr;
+
+    // one slot for every word in RAM/BIOS
+    std::vector<std::unique_ptr<CodeBlock>> ram_blocks;
+    std::vector<std::unique_ptr<CodeBlock>> bios_blocks;
+    // blocks that overlap a RAM page (blocks can span at most two pages)
+    std::array<std::vector<CodeBlock*>, RAM_PAGE_COUNT> page_blocks;
+    std::vector<u32> bios_block_indices;
+
+    // invalidated blocks can still be in use by the instruction that triggered the invalidation
+    // so they only get destroyed once the CPU looks up the next block
+    std::vector<std::unique_ptr<CodeBlock>> retired_blocks;
+
+    u64 compiled_block_count = 0;
+    u64 invalidated_block_count = 0;
+};
+
+}    // namespace CPU
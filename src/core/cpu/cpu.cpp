@@ -1,10 +1,12 @@
 #include "cpu.h"
 
-#include "imgui.h"
+#include <algorithm>
+#include <utility>
 
 #include "bios.h"
 #include "bus.h"
 #include "common/asserts.h"
+#include "common/config.h"
 #include "common/log.h"
 #include "cpu_common.h"
 #include "interrupt.h"
@@ -17,9 +19,19 @@ namespace CPU {
 constexpr bool DISASM_INSTRUCTION = false;
 constexpr bool TRACE_BIOS_CALLS = false;
 
-CPU::CPU(System* system) : sys(system), disassembler(this) {
+CPU::CPU(System* system)
+    : sys(system),
+      code_cache(this),
+#ifdef USE_RECOMPILER
+      recompiler(this),
+#endif
+      disassembler(this) {
     cp.prid = 0x2;
     UpdatePC(0xBFC00000);
+
+    code_cache_enabled = Config::cpu_code_cache.Get();
+    recompiler_enabled = RecompilerAvailable() && Config::cpu_recompiler.Get();
+    differential_testing = Config::recompiler_differential_testing;
 }
 
 void CPU::Reset() {
@@ -38,26 +50,30 @@ void CPU::Reset() {
     pending_delay_entry = {0, 0}, new_delay_entry = {0, 0};
     instr.value = 0;
 
+    current_block = nullptr;
+    code_cache.Flush();
+
     gte.Reset();
+    gte_done_ticks = 0;
+    stall_cycles = 0;
 }
 
-void CPU::Step() {
-    if (sys->debugger->IsBreakpoint(sp.pc)) {
-        bool enabled = sys->debugger->IsBreakpointEnabled(sp.pc);
-        sys->debugger->ToggleBreakpoint(sp.pc);
-
-        if (enabled) {
-            LogDebug("Hit breakpoint");
-            halt = true;
-            return;
+template<bool debug>
+ALWAYS_INLINE void CPU::Step() {
+    if constexpr (debug) {
+        if (sys->debugger->IsBreakpoint(sp.pc)) {
+            bool enabled = sys->debugger->IsBreakpointEnabled(sp.pc);
+            sys->debugger->ToggleBreakpoint(sp.pc);
+
+            if (enabled) {
+                LogDebug("Hit breakpoint");
+                halt = true;
+                return;
+            }
         }
     }
 
-    was_in_delay_slot = in_delay_slot;
-    was_branch_taken = branch_taken;
-
-    in_delay_slot = false;
-    branch_taken = false;
+    UpdateDelaySlotState();
 
     // handle interrupts
     if ((cp.cause.IP & cp.sr.IM) && cp.sr.interrupt_enable) {
@@ -65,10 +81,38 @@ void CPU::Step() {
         Exception(ExceptionCode::Interrupt);
     }
 
-    instr.value = Load32(sp.pc);
+    // bios put_char calls
+    if (sp.pc == 0xA0 && Get(9) == 0x3C) BIOS::PutChar(static_cast<u8>(Get(4)));
+    if (sp.pc == 0xB0 && Get(9) == 0x3D) BIOS::PutChar(static_cast<u8>(Get(4)));
+
+    // blocks can't start in a delay slot, the debugger needs to see every instruction
+    if constexpr (!debug) {
+        if (recompiler_enabled && !was_in_delay_slot) [[likely]] {
+            if (ExecuteRecompiledBlock()) return;
+        }
+    }
+
+    // tick the components
+    if (ExecuteInstruction<debug>()) sys->AddCycles(CYCLES_PER_INSTRUCTION + std::exchange(stall_cycles, 0));
+}
 
-    halt = sys->debugger->single_step;
-    sys->debugger->StoreLastInstruction(sp.pc, instr.value);
+void CPU::UpdateDelaySlotState() {
+    was_in_delay_slot = in_delay_slot;
+    was_branch_taken = branch_taken;
+
+    in_delay_slot = false;
+    branch_taken = false;
+}
+
+template<bool debug>
+ALWAYS_INLINE bool CPU::ExecuteInstruction() {
+    const DecodedInstruction& decoded = FetchInstruction();
+    instr.value = decoded.value;
+
+    if constexpr (debug) {
+        halt = sys->debugger->single_step;
+        sys->debugger->StoreLastInstruction(sp.pc, instr.value);
+    }
 
 #ifndef NDEBUG
     if (TRACE_BIOS_CALLS && (sp.pc & 0x3FFFFFFF) <= 0xC0) {
@@ -84,10 +128,6 @@ void CPU::Step() {
     //instr_counter++;
 #endif
 
-    // bios put_char calls
-    if (sp.pc == 0xA0 && Get(9) == 0x3C) BIOS::PutChar(static_cast<u8>(Get(4)));
-    if (sp.pc == 0xB0 && Get(9) == 0x3D) BIOS::PutChar(static_cast<u8>(Get(4)));
-
     UpdatePC(next_pc);
     // at this point the pc contains the address of the delay slot instruction
     // next_pc points to the instruction right after the delay slot
@@ -96,495 +136,822 @@ void CPU::Step() {
     if (current_pc & 0x3) [[unlikely]] {
         LogCrit("Invalid pc address");
         Exception(ExceptionCode::LoadAddress);
+        return false;
+    }
+
+    decoded.handler(*this, decoded);
+
+    // update delay entries
+    gp.r[pending_delay_entry.reg] = pending_delay_entry.value;
+    pending_delay_entry = new_delay_entry;
+    new_delay_entry = {0, 0};
+
+    // first register always contains 0
+    gp.zero = 0;
+
+    return true;
+}
+
+template<bool debug>
+u32 CPU::Execute(u32 cycles_budget) {
+    const u64 start_ticks = sys->GetGlobalTicks();
+    // return to the caller once the next event ran, it might have been the vblank
+    const u64 end_ticks = std::min(start_ticks + cycles_budget, sys->GetNextEventTicks());
+
+    do {
+        Step<debug>();
+    } while (sys->GetGlobalTicks() < end_ticks && !halt);
+
+    return static_cast<u32>(sys->GetGlobalTicks() - start_ticks);
+}
+
+template u32 CPU::Execute<false>(u32 cycles_budget);
+template u32 CPU::Execute<true>(u32 cycles_budget);
+
+bool CPU::ExecuteRecompiledBlock() {
+#ifdef USE_RECOMPILER
+    // the lookup below can destroy retired blocks
+    current_block = nullptr;
+
+    CodeBlock* block = code_cache.GetBlock(sp.pc);
+    if (!block || block->recompile_failed) return false;
+
+    if (!block->host_code || block->host_code_address != sp.pc) {
+        bool success = recompiler.Compile(block, sp.pc);
+        if (!success && recompiler.CodeBufferFull()) {
+            // start over with an empty code buffer
+            code_cache.Flush();
+            recompiler.ResetCodeBuffer();
+            block = code_cache.GetBlock(sp.pc);
+            success = recompiler.Compile(block, sp.pc);
+        }
+        if (!success) {
+            block->recompile_failed = true;
+            return false;
+        }
+    }
+
+    exception_raised = false;
+    running_block = block;
+    const u32 cycles = differential_testing ? ExecuteDifferential(block) : block->host_code(this);
+    running_block = nullptr;
+    sys->AddCycles(cycles + std::exchange(stall_cycles, 0));
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+u32 CPU::ExecuteDifferential(CodeBlock* block) {
+    // the GTE state isn't part of the snapshot
+    const bool uses_gte = std::any_of(block->instructions.begin(), block->instructions.end(), [](const auto& i) {
+        const auto op = Instruction {i.value}.n.op.GetValue();
+        return op == PrimaryOpcode::cop2 || op == PrimaryOpcode::lwc2 || op == PrimaryOpcode::swc2;
+    });
+
+    const u32 block_address = sp.pc;
+    const GP_Registers gp_before = gp;
+    const SP_Registers sp_before = sp;
+    std::array<u32, COP_REG_COUNT> cp_before;
+    std::copy(std::begin(cp.cpr), std::end(cp.cpr), cp_before.begin());
+    const u32 next_pc_before = next_pc, current_pc_before = current_pc;
+    const bool in_delay_slot_before = in_delay_slot, was_in_delay_slot_before = was_in_delay_slot;
+    const bool branch_taken_before = branch_taken, was_branch_taken_before = was_branch_taken;
+    const LoadDelayEntry pending_before = pending_delay_entry, new_before = new_delay_entry;
+    const u32 instr_before = instr.value;
+
+    sys->bus->StartWriteJournal();
+    const u32 cycles = block->host_code(this);
+    // blocks that accessed IO ports can't be replayed without side effects
+    if (!sys->bus->StopWriteJournal() || uses_gte) return cycles;
+
+    const GP_Registers gp_recompiled = gp;
+    const SP_Registers sp_recompiled = sp;
+
+    // restore the state from before the block and run it again in the interpreter
+    sys->bus->RollbackWriteJournal();
+    gp = gp_before;
+    sp = sp_before;
+    std::copy(cp_before.begin(), cp_before.end(), std::begin(cp.cpr));
+    next_pc = next_pc_before, current_pc = current_pc_before;
+    in_delay_slot = in_delay_slot_before, was_in_delay_slot = was_in_delay_slot_before;
+    branch_taken = branch_taken_before, was_branch_taken = was_branch_taken_before;
+    pending_delay_entry = pending_before, new_delay_entry = new_before;
+    instr.value = instr_before;
+
+    const u32 instruction_count = cycles / CYCLES_PER_INSTRUCTION;
+    for (u32 n = 0; n < instruction_count; n++) {
+        if (n > 0) UpdateDelaySlotState();
+        ExecuteInstruction<false>();
+    }
+
+    bool match = true;
+    for (u32 r = 0; r < GP_REG_COUNT; r++) match &= gp.r[r] == gp_recompiled.r[r];
+    for (u32 r = 0; r < SP_REG_COUNT; r++) match &= sp.spr[r] == sp_recompiled.spr[r];
+
+    if (!match) [[unlikely]] {
+        differential_mismatch_count++;
+        LogWarn("Recompiler mismatch in block 0x{:08X} ({} instructions)", block_address, instruction_count);
+        for (u32 r = 0; r < GP_REG_COUNT; r++) {
+            if (gp.r[r] == gp_recompiled.r[r]) continue;
+            LogWarn("    ${}: recompiler=0x{:08X} interpreter=0x{:08X}", REG_NAMES[r], gp_recompiled.r[r], gp.r[r]);
+        }
+        for (u32 r = 0; r < SP_REG_COUNT; r++) {
+            if (sp.spr[r] == sp_recompiled.spr[r]) continue;
+            LogWarn("    {}: recompiler=0x{:08X} interpreter=0x{:08X}", SP_REG_NAMES[r], sp_recompiled.spr[r],
+                    sp.spr[r]);
+        }
+    }
+
+    // the interpreter result is the reference
+    return cycles;
+}
+
+const DecodedInstruction& CPU::FetchInstruction() {
+    if (code_cache_enabled) [[likely]] {
+        if (!current_block || !current_block->valid || sp.pc != current_block_pc ||
+            current_block_index >= current_block->instructions.size()) {
+            current_block = code_cache.GetBlock(sp.pc);
+            current_block_index = 0;
+            current_block_pc = sp.pc;
+        }
+
+        if (current_block) [[likely]] {
+            current_block_pc += 4;
+            return current_block->instructions[current_block_index++];
+        }
+    }
+
+    uncached_instruction = Decode(Load32(sp.pc));
+    return uncached_instruction;
+}
+
+void CPU::FlushCodeCache() {
+    current_block = nullptr;
+    code_cache.Flush();
+}
+
+std::string CPU::DisassembleInstruction(u32 address, u32 value) {
+    return disassembler.InstructionAt(address, value, false);
+}
+
+void CPU::SetCodeCacheEnabled(bool enabled) {
+    code_cache_enabled = enabled;
+    current_block = nullptr;
+    code_cache.Flush();
+
+    LogInfo("{} code cache", enabled ? "Enabled" : "Disabled");
+}
+
+void CPU::SetRecompilerEnabled(bool enabled) {
+    if (enabled && !RecompilerAvailable()) {
+        LogWarn("Recompiler is not available on this platform");
         return;
     }
+    recompiler_enabled = enabled;
+
+    LogInfo("{} recompiler", enabled ? "Enabled" : "Disabled");
+}
+
+void CPU::SetDifferentialTesting(bool enabled) {
+    differential_testing = enabled;
+    differential_mismatch_count = 0;
+
+    LogInfo("{} recompiler differential testing", enabled ? "Enabled" : "Disabled");
+}
+
+DecodedInstruction CPU::Decode(u32 value) {
+    Instruction instr {value};
+
+    DecodedInstruction i;
+    i.value = value;
+    i.rs = static_cast<u8>(instr.s.rs);
+    i.rt = static_cast<u8>(instr.s.rt);
+    i.rd = static_cast<u8>(instr.s.rd);
+    i.sa = static_cast<u8>(instr.s.sa);
+    i.imm = instr.imm_se();
+
+    const auto Branch = [&](InstructionHandler handler) {
+        i.handler = handler;
+        i.imm = instr.imm_se() << 2;
+        i.is_branch = true;
+    };
+    const auto ZeroExtended = [&](InstructionHandler handler) {
+        i.handler = handler;
+        i.imm = instr.n.imm;
+    };
 
     // clang-format off
 
     switch (instr.n.op) {
         case PrimaryOpcode::special:
             switch (instr.s.sop) {
-                case SecondaryOpcode::sll:
-                    Set(instr.s.rd, Get(instr.s.rt) << instr.s.sa);
-                    break;
-                case SecondaryOpcode::srl:
-                    Set(instr.s.rd, Get(instr.s.rt) >> instr.s.sa);
-                    break;
-                case SecondaryOpcode::sra:
-                    Set(instr.s.rd, static_cast<s32>(Get(instr.s.rt)) >> instr.s.sa);
-                    break;
-                case SecondaryOpcode::sllv:
-                    Set(instr.s.rd, Get(instr.s.rt) << (Get(instr.s.rs) & 0x1F));
-                    break;
-                case SecondaryOpcode::srlv:
-                    Set(instr.s.rd, Get(instr.s.rt) >> (Get(instr.s.rs) & 0x1F));
-                    break;
-                case SecondaryOpcode::srav:
-                    Set(instr.s.rd, static_cast<s32>(Get(instr.s.rt)) >> (Get(instr.s.rs) & 0x1F));
-                    break;
-                case SecondaryOpcode::jr:
-                {
-                    u32 jump_address = Get(instr.s.rs);
-                    in_delay_slot = true;
-                    if ((jump_address & 0x3) != 0) {
-                        Exception(ExceptionCode::StoreAddress);
-                        break;
-                    }
-                    next_pc = jump_address;
-                    branch_taken = true;
-                    break;
-                }
-                case SecondaryOpcode::jalr:
-                {
-                    u32 jump_address = Get(instr.s.rs);
-                    Set(instr.s.rd, next_pc);
-                    in_delay_slot = true;
-                    if ((jump_address & 0x3) != 0) {
-                        Exception(ExceptionCode::StoreAddress);
-                        break;
-                    }
-                    next_pc = jump_address;
-                    branch_taken = true;
-                    break;
-                }
-                case SecondaryOpcode::syscall:
-                    Exception(ExceptionCode::Syscall);
-                    break;
-                case SecondaryOpcode::breakpoint:
-                    Exception(ExceptionCode::Break);
-                    break;
-                case SecondaryOpcode::mfhi:
-                    Set(instr.s.rd, sp.hi);
-                    break;
-                case SecondaryOpcode::mthi:
-                    sp.hi = Get(instr.s.rs);
-                    break;
-                case SecondaryOpcode::mflo:
-                    Set(instr.s.rd, sp.lo);
-                    break;
-                case SecondaryOpcode::mtlo:
-                    sp.lo = Get(instr.s.rs);
-                    break;
-                case SecondaryOpcode::mult: {
-                    const s64 a = static_cast<s32>(Get(instr.s.rs));
-                    const s64 b = static_cast<s32>(Get(instr.s.rt));
-                    const u64 result = static_cast<u64>(a * b);
-
-                    sp.lo = result & 0xFFFFFFFF;
-                    sp.hi = result >> 32;
-                    break;
-                }
-                case SecondaryOpcode::multu:
-                {
-                    const u64 a = Get(instr.s.rs);
-                    const u64 b = Get(instr.s.rt);
-                    const u64 result = a * b;
-
-                    sp.lo = result & 0xFFFFFFFF;
-                    sp.hi = result >> 32;
-                    break;
-                }
-                case SecondaryOpcode::div:
-                {
-                    const s32 n = static_cast<s32>(Get(instr.s.rs));
-                    const s32 d = static_cast<s32>(Get(instr.s.rt));
-
-                    // check for special cases
-                    if (d == 0) {
-                        sp.hi = static_cast<u32>(n);
-                        sp.lo = (n >= 0) ? 0xFFFFFFFF : 0x1;
-                    } else if (static_cast<u32>(n) == 0x80000000 && d == -1) {
-                        sp.hi = 0x0;
-                        sp.lo = 0x80000000;
-                    } else {
-                        sp.hi = static_cast<u32>(n % d);
-                        sp.lo = static_cast<u32>(n / d);
-                    }
-                    break;
-                }
-                case SecondaryOpcode::divu:
-                {
-                    const u32 n = Get(instr.s.rs);
-                    const u32 d = Get(instr.s.rt);
-
-                    // check for special case
-                    if (d == 0) {
-                        sp.hi = n;
-                        sp.lo = 0xFFFFFFFF;
-                    } else {
-                        sp.hi = n % d;
-                        sp.lo = n / d;
-                    }
-                    break;
-                }
-                case SecondaryOpcode::add:
-                {
-                    const u32 a = Get(instr.s.rs);
-                    const u32 b = Get(instr.s.rt);
-                    const u32 result = a + b;
-                    if (!((a ^ b) & 0x80000000) && ((result ^ a) & 0x80000000))
-                        Exception(ExceptionCode::Overflow);
-                    else
-                        Set(instr.s.rd, result);
-                    break;
-                }
-                case SecondaryOpcode::addu:
-                    Set(instr.s.rd, Get(instr.s.rs) + Get(instr.s.rt));
-                    break;
-                case SecondaryOpcode::sub:
-                {
-                    const u32 a = Get(instr.s.rs);
-                    const u32 b = Get(instr.s.rt);
-                    const u32 result = a - b;
-                    if (((a ^ b) & 0x80000000) && ((result ^ a) & 0x80000000))
-                        Exception(ExceptionCode::Overflow);
-                    else
-                        Set(instr.s.rd, result);
-                    break;
-                }
-                case SecondaryOpcode::subu:
-                    Set(instr.s.rd, Get(instr.s.rs) - Get(instr.s.rt));
-                    break;
-                case SecondaryOpcode::andr:
-                    Set(instr.s.rd, Get(instr.s.rs) & Get(instr.s.rt));
-                    break;
-                case SecondaryOpcode::orr:
-                    Set(instr.s.rd, Get(instr.s.rs) | Get(instr.s.rt));
-                    break;
-                case SecondaryOpcode::xorr:
-                    Set(instr.s.rd, Get(instr.s.rs) ^ Get(instr.s.rt));
-                    break;
-                case SecondaryOpcode::nor:
-                    Set(instr.s.rd, ~(Get(instr.s.rs) | Get(instr.s.rt)));
-                    break;
-                case SecondaryOpcode::slt:
-                    Set(instr.s.rd, (static_cast<s32>(Get(instr.s.rs)) < static_cast<s32>(Get(instr.s.rt))) ? 1 : 0);
-                    break;
-                case SecondaryOpcode::sltu:
-                    Set(instr.s.rd, (Get(instr.s.rs) < Get(instr.s.rt)) ? 1 : 0);
-                    break;
-                default:
-                    LogCrit("Invalid special opcode 0x%02X [0x%08X]\n", (u32)instr.s.sop.GetValue(), instr.value);
-                    Exception(ExceptionCode::ReservedInstr);
-            }
-            break;
-        case PrimaryOpcode::bxxx:
-        {
-            const bool is_bgez = (instr.n.rt & 0x01) != 0;
-            const bool is_link = (instr.n.rt & 0x1E) == 0x10;
-
-            // check if lz
-            bool test = static_cast<s32>(Get(instr.n.rs)) < 0;
-            // flip check for gez
-            test ^= is_bgez;
-
-            in_delay_slot = true;
-            if (is_link) Set(GP_Registers::RA, next_pc);
-            if (test) {
-                next_pc = sp.pc + (instr.imm_se() << 2);
-                branch_taken = true;
+                case SecondaryOpcode::sll: i.handler = &Dispatch<&CPU::OpSLL>; break;
+                case SecondaryOpcode::srl: i.handler = &Dispatch<&CPU::OpSRL>; break;
+                case SecondaryOpcode::sra: i.handler = &Dispatch<&CPU::OpSRA>; break;
+                case SecondaryOpcode::sllv: i.handler = &Dispatch<&CPU::OpSLLV>; break;
+                case SecondaryOpcode::srlv: i.handler = &Dispatch<&CPU::OpSRLV>; break;
+                case SecondaryOpcode::srav: i.handler = &Dispatch<&CPU::OpSRAV>; break;
+                case SecondaryOpcode::jr: i.handler = &Dispatch<&CPU::OpJR>; i.is_branch = true; break;
+                case SecondaryOpcode::jalr: i.handler = &Dispatch<&CPU::OpJALR>; i.is_branch = true; break;
+                case SecondaryOpcode::syscall: i.handler = &Dispatch<&CPU::OpSYSCALL>; break;
+                case SecondaryOpcode::breakpoint: i.handler = &Dispatch<&CPU::OpBREAK>; break;
+                case SecondaryOpcode::mfhi: i.handler = &Dispatch<&CPU::OpMFHI>; break;
+                case SecondaryOpcode::mthi: i.handler = &Dispatch<&CPU::OpMTHI>; break;
+                case SecondaryOpcode::mflo: i.handler = &Dispatch<&CPU::OpMFLO>; break;
+                case SecondaryOpcode::mtlo: i.handler = &Dispatch<&CPU::OpMTLO>; break;
+                case SecondaryOpcode::mult: i.handler = &Dispatch<&CPU::OpMULT>; break;
+                case SecondaryOpcode::multu: i.handler = &Dispatch<&CPU::OpMULTU>; break;
+                case SecondaryOpcode::div: i.handler = &Dispatch<&CPU::OpDIV>; break;
+                case SecondaryOpcode::divu: i.handler = &Dispatch<&CPU::OpDIVU>; break;
+                case SecondaryOpcode::add: i.handler = &Dispatch<&CPU::OpADD>; break;
+                case SecondaryOpcode::addu: i.handler = &Dispatch<&CPU::OpADDU>; break;
+                case SecondaryOpcode::sub: i.handler = &Dispatch<&CPU::OpSUB>; break;
+                case SecondaryOpcode::subu: i.handler = &Dispatch<&CPU::OpSUBU>; break;
+                case SecondaryOpcode::andr: i.handler = &Dispatch<&CPU::OpAND>; break;
+                case SecondaryOpcode::orr: i.handler = &Dispatch<&CPU::OpOR>; break;
+                case SecondaryOpcode::xorr: i.handler = &Dispatch<&CPU::OpXOR>; break;
+                case SecondaryOpcode::nor: i.handler = &Dispatch<&CPU::OpNOR>; break;
+                case SecondaryOpcode::slt: i.handler = &Dispatch<&CPU::OpSLT>; break;
+                case SecondaryOpcode::sltu: i.handler = &Dispatch<&CPU::OpSLTU>; break;
+                default: i.handler = &Dispatch<&CPU::OpInvalidSpecial>; break;
             }
             break;
-        }
+        case PrimaryOpcode::bxxx: Branch(&Dispatch<&CPU::OpBXX>); break;
         case PrimaryOpcode::jmp:
-            next_pc &= 0xF0000000;
-            next_pc |= instr.jump_target << 2;
-            in_delay_slot = true;
-            branch_taken = true;
+            i.handler = &Dispatch<&CPU::OpJ>;
+            i.imm = instr.jump_target << 2;
+            i.is_branch = true;
             break;
         case PrimaryOpcode::jal:
-            Set(GP_Registers::RA, next_pc);
-            next_pc &= 0xF0000000;
-            next_pc |= instr.jump_target << 2;
-            in_delay_slot = true;
-            branch_taken = true;
-            break;
-        case PrimaryOpcode::beq:
-            in_delay_slot = true;
-            if (Get(instr.n.rs) == Get(instr.n.rt)) {
-                next_pc = sp.pc + (instr.imm_se() << 2);
-                branch_taken = true;
-            }
-            break;
-        case PrimaryOpcode::bne:
-            in_delay_slot = true;
-            if (Get(instr.n.rs) != Get(instr.n.rt)) {
-                next_pc = sp.pc + (instr.imm_se() << 2);
-                branch_taken = true;
-            }
-            break;
-        case PrimaryOpcode::blez:
-            in_delay_slot = true;
-            if (static_cast<s32>(Get(instr.n.rs)) <= 0) {
-                next_pc = sp.pc + (instr.imm_se() << 2);
-                branch_taken = true;
-            }
-            break;
-        case PrimaryOpcode::bgtz:
-            in_delay_slot = true;
-            if (static_cast<s32>(Get(instr.n.rs)) > 0) {
-                next_pc = sp.pc + (instr.imm_se() << 2);
-                branch_taken = true;
-            }
-            break;
-        case PrimaryOpcode::addi:
-        {
-            const u32 old = Get(instr.n.rs);
-            const u32 add = instr.imm_se();
-            const u32 result = old + add;
-            if (!((old ^ add) & 0x80000000) && ((result ^ old) & 0x80000000))
-                Exception(ExceptionCode::Overflow);
-            else
-                Set(instr.n.rt, result);
-            break;
-        }
-        case PrimaryOpcode::addiu: Set(instr.n.rt, Get(instr.n.rs) + instr.imm_se()); break;
-        case PrimaryOpcode::slti:
-            Set(instr.n.rt, (static_cast<s32>(Get(instr.n.rs)) < static_cast<s32>(instr.imm_se())) ? 1 : 0);
-            break;
-        case PrimaryOpcode::sltiu:
-            Set(instr.n.rt, (Get(instr.n.rs) < instr.imm_se()) ? 1 : 0);
-            break;
-        case PrimaryOpcode::andi:
-            Set(instr.n.rt, Get(instr.n.rs) & instr.n.imm);
-            break;
-        case PrimaryOpcode::ori:
-            Set(instr.n.rt, Get(instr.n.rs) | instr.n.imm);
-            break;
-        case PrimaryOpcode::xori:
-            Set(instr.n.rt, Get(instr.n.rs) ^ instr.n.imm);
+            i.handler = &Dispatch<&CPU::OpJAL>;
+            i.imm = instr.jump_target << 2;
+            i.is_branch = true;
             break;
+        case PrimaryOpcode::beq: Branch(&Dispatch<&CPU::OpBEQ>); break;
+        case PrimaryOpcode::bne: Branch(&Dispatch<&CPU::OpBNE>); break;
+        case PrimaryOpcode::blez: Branch(&Dispatch<&CPU::OpBLEZ>); break;
+        case PrimaryOpcode::bgtz: Branch(&Dispatch<&CPU::OpBGTZ>); break;
+        case PrimaryOpcode::addi: i.handler = &Dispatch<&CPU::OpADDI>; break;
+        case PrimaryOpcode::addiu: i.handler = &Dispatch<&CPU::OpADDIU>; break;
+        case PrimaryOpcode::slti: i.handler = &Dispatch<&CPU::OpSLTI>; break;
+        case PrimaryOpcode::sltiu: i.handler = &Dispatch<&CPU::OpSLTIU>; break;
+        case PrimaryOpcode::andi: ZeroExtended(&Dispatch<&CPU::OpANDI>); break;
+        case PrimaryOpcode::ori: ZeroExtended(&Dispatch<&CPU::OpORI>); break;
+        case PrimaryOpcode::xori: ZeroExtended(&Dispatch<&CPU::OpXORI>); break;
         case PrimaryOpcode::lui:
-            Set(instr.n.rt, instr.n.imm << 16);
+            i.handler = &Dispatch<&CPU::OpLUI>;
+            i.imm = instr.n.imm << 16;
             break;
         case PrimaryOpcode::cop0:
             switch (instr.cop.cop_op) {
-                case CoprocessorOpcode::mf:
-                    SetDelayEntry(instr.cop.rt, GetCP0(instr.cop.rd));
-                    break;
-                case CoprocessorOpcode::mt:
-                    //LOG_DEBUG << fmt::format("MTC: Set Register {} to 0x{:08X}", instr.cop.rd, Get(instr.cop.rt));
-                    SetCP0(instr.cop.rd, Get(instr.cop.rt));
-                    break;
-                case CoprocessorOpcode::rfe:
-                {
-                    if ((instr.value & 0x3F) != 0b010000) Panic("Invalid CP0 instruction 0x{:08X}!", instr.value);
-                    // restore the interrupt/user pairs that we changed before jumping into the exception handler
-                    const u32 mode = cp.sr.value & 0x3C;
-                    cp.sr.value &= ~0xFu;    // bits 4-5 are left unchanged
-                    cp.sr.value |= (mode >> 2);
-                    break;
-                }
-                default:
-                    Panic("Invalid coprocessor opcode 0x{:02X}!", (u32) instr.cop.cop_op.GetValue());
+                case CoprocessorOpcode::mf: i.handler = &Dispatch<&CPU::OpMFC0>; break;
+                case CoprocessorOpcode::mt: i.handler = &Dispatch<&CPU::OpMTC0>; break;
+                case CoprocessorOpcode::rfe: i.handler = &Dispatch<&CPU::OpRFE>; break;
+                // don't panic during decoding, the instruction might never get executed
+                default: i.handler = &Dispatch<&CPU::OpInvalidCOP0>; break;
             }
             break;
         case PrimaryOpcode::cop2:
-            if ((instr.value >> 25) == COP2_IMM_OPCODE) {
-                gte.ExecuteCommand(instr.value);
+            if ((value >> 25) == COP2_IMM_OPCODE) {
+                i.handler = &Dispatch<&CPU::OpCOP2>;
                 break;
             }
             switch (instr.cop.cop_op) {
-                case CoprocessorOpcode::mf:
-                    Set(instr.cop.rt, gte.GetReg(instr.cop.rd));
-                    break;
-                case CoprocessorOpcode::mcf:
-                    Set(instr.cop.rt, gte.GetReg(instr.cop.rd + 32));
-                    break;
-                case CoprocessorOpcode::mt:
-                    gte.SetReg(instr.cop.rd, Get(instr.cop.rt));
-                    break;
-                case CoprocessorOpcode::mct:
-                    gte.SetReg(instr.cop.rd + 32, Get(instr.cop.rt));
-                    break;
-                default:
-                    Panic("Invalid GTE coprocessor opcode 0x{:02X}!", (u32) instr.cop.cop_op.GetValue());
+                case CoprocessorOpcode::mf: i.handler = &Dispatch<&CPU::OpMFC2>; break;
+                case CoprocessorOpcode::mcf: i.handler = &Dispatch<&CPU::OpCFC2>; break;
+                case CoprocessorOpcode::mt: i.handler = &Dispatch<&CPU::OpMTC2>; break;
+                case CoprocessorOpcode::mct: i.handler = &Dispatch<&CPU::OpCTC2>; break;
+                default: i.handler = &Dispatch<&CPU::OpInvalidCOP2>; break;
             }
             break;
         case PrimaryOpcode::cop1:
         case PrimaryOpcode::cop3:
-            Exception(ExceptionCode::CopError);
-            break;
-        case PrimaryOpcode::lb:
-        {
-            u32 address = Get(instr.n.rs) + instr.imm_se();
-            u32 value = static_cast<s8>(Load8(address));
-            SetDelayEntry(instr.n.rt, value);
-            break;
-        }
-        case PrimaryOpcode::lh:
-        {
-            u32 address = Get(instr.n.rs) + instr.imm_se();
-            u32 value = static_cast<s16>(Load16(address));
-            if (address & 0x1)
-                Exception(ExceptionCode::LoadAddress);
-            else
-                SetDelayEntry(instr.n.rt, value);
-            break;
-        }
-        case PrimaryOpcode::lwl:
-        {
-            if (cp.sr.isolate_cache) Panic("Load with isolated cache");
-            u32 address = Get(instr.n.rs) + instr.imm_se();
-
-            u32 aligned_value = Load32(address & ~0x3);
-            u32 old_value = (pending_delay_entry.reg == instr.n.rt) ? pending_delay_entry.value : Get(instr.n.rt);
-
-            u32 new_value = 0;
-            switch (address & 0x3) {
-                case 0: new_value = (old_value & 0x00FFFFFF) | (aligned_value << 24); break;
-                case 1: new_value = (old_value & 0x0000FFFF) | (aligned_value << 16); break;
-                case 2: new_value = (old_value & 0x000000FF) | (aligned_value << 8); break;
-                case 3: new_value = aligned_value; break;
-            }
-            SetDelayEntry(instr.n.rt, new_value);
-            break;
-        }
-        case PrimaryOpcode::lw:
-        {
-            if (cp.sr.isolate_cache) Panic("Load with isolated cache");
-            u32 address = Get(instr.n.rs) + instr.imm_se();
-            if (address & 0x3)
-                Exception(ExceptionCode::LoadAddress);
-            else
-                SetDelayEntry(instr.n.rt, Load32(address));
-            break;
-        }
-        case PrimaryOpcode::lbu:
-        {
-            u32 address = Get(instr.n.rs) + instr.imm_se();
-            SetDelayEntry(instr.n.rt, Load8(address));
-            break;
-        }
-        case PrimaryOpcode::lhu:
-        {
-            u32 address = Get(instr.n.rs) + instr.imm_se();
-            if (address & 0x1)
-                Exception(ExceptionCode::LoadAddress);
-            else
-                SetDelayEntry(instr.n.rt, Load16(address));
-            break;
-        }
-        case PrimaryOpcode::lwr:
-        {
-            if (cp.sr.isolate_cache) Panic("Load with isolated cache");
-            u32 address = Get(instr.n.rs) + instr.imm_se();
-
-            u32 aligned_value = Load32(address & ~0x3);
-            u32 old_value = (pending_delay_entry.reg == instr.n.rt) ? pending_delay_entry.value : Get(instr.n.rt);
-
-            u32 new_value = 0;
-            switch (address & 0x3) {
-                case 0: new_value = aligned_value; break;
-                case 1: new_value = (old_value & 0xFF000000) | (aligned_value >> 8); break;
-                case 2: new_value = (old_value & 0xFFFF0000) | (aligned_value >> 16); break;
-                case 3: new_value = (old_value & 0xFFFFFF00) | (aligned_value >> 24); break;
-            }
-            SetDelayEntry(instr.n.rt, new_value);
-            break;
-        }
-        case PrimaryOpcode::sb:
-        {
-            u32 address = Get(instr.n.rs) + instr.imm_se();
-            u8 byte = static_cast<u8>(Get(instr.n.rt) & 0xFF);
-            Store8(address, byte);
-            break;
-        }
-        case PrimaryOpcode::sh:
-        {
-            u32 address = Get(instr.n.rs) + instr.imm_se();
-            u16 halfword = static_cast<u16>(Get(instr.n.rt) & 0xFFFF);
-            if (address & 0x1)
-                Exception(ExceptionCode::StoreAddress);
-            else
-                Store16(address, halfword);
+            i.handler = &Dispatch<&CPU::OpCopError>;
             break;
-        }
-        case PrimaryOpcode::swl:
-        {
-            u32 address = Get(instr.n.rs) + instr.imm_se();
-            u32 aligned_value = Load32(address & ~0x3);
-            u32 old_value = Get(instr.n.rt);
-
-            u32 new_value = 0;
-            switch (address & 0x3) {
-                case 0: new_value = (aligned_value & 0xFFFFFF00) | (old_value >> 24); break;
-                case 1: new_value = (aligned_value & 0xFFFF0000) | (old_value >> 16); break;
-                case 2: new_value = (aligned_value & 0xFF000000) | (old_value >> 8); break;
-                case 3: new_value = old_value; break;
-            }
-            Store32(address & ~0x3, new_value);
-            break;
-        }
-        case PrimaryOpcode::sw:
-        {
-            u32 address = Get(instr.n.rs) + instr.imm_se();
-            if (address & 0x3)
-                Exception(ExceptionCode::StoreAddress);
-            else
-                Store32(address, Get(instr.n.rt));
-            break;
-        }
-        case PrimaryOpcode::swr:
-        {
-            u32 address = Get(instr.n.rs) + instr.imm_se();
-            u32 aligned_value = Load32(address & ~0x3);
-            u32 old_value = Get(instr.n.rt);
-
-            u32 new_value = 0;
-            switch (address & 0x3) {
-                case 0: new_value = old_value; break;
-                case 1: new_value = (aligned_value & 0x000000FF) | (old_value << 8); break;
-                case 2: new_value = (aligned_value & 0x0000FFFF) | (old_value << 16); break;
-                case 3: new_value = (aligned_value & 0x00FFFFFF) | (old_value << 24); break;
-            }
-            Store32(address & ~0x3, new_value);
-            break;
-        }
-        case PrimaryOpcode::lwc2:
-        {
-            u32 address = Get(instr.n.rs) + instr.imm_se();
-            u32 value = Load32(address);
-
-            // TODO: wait until last GTE command is done before writing to the register
-            gte.SetReg(instr.n.rt, value);
-
-            break;
-        }
-        case PrimaryOpcode::swc2:
-        {
-            u32 address = Get(instr.n.rs) + instr.imm_se();
-
-            // TODO: wait until last GTE command is done before reading from the register
-            u32 value = gte.GetReg(instr.n.rt);
-            Store32(address, value);
-
-            break;
-        }
+        case PrimaryOpcode::lb: i.handler = &Dispatch<&CPU::OpLB>; break;
+        case PrimaryOpcode::lh: i.handler = &Dispatch<&CPU::OpLH>; break;
+        case PrimaryOpcode::lwl: i.handler = &Dispatch<&CPU::OpLWL>; break;
+        case PrimaryOpcode::lw: i.handler = &Dispatch<&CPU::OpLW>; break;
+        case PrimaryOpcode::lbu: i.handler = &Dispatch<&CPU::OpLBU>; break;
+        case PrimaryOpcode::lhu: i.handler = &Dispatch<&CPU::OpLHU>; break;
+        case PrimaryOpcode::lwr: i.handler = &Dispatch<&CPU::OpLWR>; break;
+        case PrimaryOpcode::sb: i.handler = &Dispatch<&CPU::OpSB>; break;
+        case PrimaryOpcode::sh: i.handler = &Dispatch<&CPU::OpSH>; break;
+        case PrimaryOpcode::swl: i.handler = &Dispatch<&CPU::OpSWL>; break;
+        case PrimaryOpcode::sw: i.handler = &Dispatch<&CPU::OpSW>; break;
+        case PrimaryOpcode::swr: i.handler = &Dispatch<&CPU::OpSWR>; break;
+        case PrimaryOpcode::lwc2: i.handler = &Dispatch<&CPU::OpLWC2>; break;
+        case PrimaryOpcode::swc2: i.handler = &Dispatch<&CPU::OpSWC2>; break;
         case PrimaryOpcode::lwc0:
         case PrimaryOpcode::lwc1:
         case PrimaryOpcode::lwc3:
         case PrimaryOpcode::swc0:
         case PrimaryOpcode::swc1:
-            Exception(ExceptionCode::CopError);
+            i.handler = &Dispatch<&CPU::OpCopError>;
             break;
-        default:
-            LogCrit("Invalid opcode 0x{:02X} [0x{:08X}]", (u32)instr.n.op.GetValue(), instr.value);
-            Exception(ExceptionCode::ReservedInstr);
+        default: i.handler = &Dispatch<&CPU::OpInvalid>; break;
     }
 
     // clang-format on
 
-    // update delay entries
-    gp.r[pending_delay_entry.reg] = pending_delay_entry.value;
-    pending_delay_entry = new_delay_entry;
-    new_delay_entry = {0, 0};
+    return i;
+}
 
-    // first register always contains 0
-    gp.zero = 0;
+void CPU::OpSLL(const DecodedInstruction& i) {
+    Set(i.rd, Get(i.rt) << i.sa);
+}
+
+void CPU::OpSRL(const DecodedInstruction& i) {
+    Set(i.rd, Get(i.rt) >> i.sa);
+}
+
+void CPU::OpSRA(const DecodedInstruction& i) {
+    Set(i.rd, static_cast<s32>(Get(i.rt)) >> i.sa);
+}
+
+void CPU::OpSLLV(const DecodedInstruction& i) {
+    Set(i.rd, Get(i.rt) << (Get(i.rs) & 0x1F));
+}
+
+void CPU::OpSRLV(const DecodedInstruction& i) {
+    Set(i.rd, Get(i.rt) >> (Get(i.rs) & 0x1F));
+}
+
+void CPU::OpSRAV(const DecodedInstruction& i) {
+    Set(i.rd, static_cast<s32>(Get(i.rt)) >> (Get(i.rs) & 0x1F));
+}
+
+void CPU::OpJR(const DecodedInstruction& i) {
+    u32 jump_address = Get(i.rs);
+    in_delay_slot = true;
+    if ((jump_address & 0x3) != 0) {
+        Exception(ExceptionCode::StoreAddress);
+        return;
+    }
+    next_pc = jump_address;
+    branch_taken = true;
+}
+
+void CPU::OpJALR(const DecodedInstruction& i) {
+    u32 jump_address = Get(i.rs);
+    Set(i.rd, next_pc);
+    in_delay_slot = true;
+    if ((jump_address & 0x3) != 0) {
+        Exception(ExceptionCode::StoreAddress);
+        return;
+    }
+    next_pc = jump_address;
+    branch_taken = true;
+}
+
+void CPU::OpSYSCALL(const DecodedInstruction&) {
+    Exception(ExceptionCode::Syscall);
+}
+
+void CPU::OpBREAK(const DecodedInstruction&) {
+    Exception(ExceptionCode::Break);
+}
+
+void CPU::OpMFHI(const DecodedInstruction& i) {
+    Set(i.rd, sp.hi);
+}
+
+void CPU::OpMTHI(const DecodedInstruction& i) {
+    sp.hi = Get(i.rs);
+}
+
+void CPU::OpMFLO(const DecodedInstruction& i) {
+    Set(i.rd, sp.lo);
+}
+
+void CPU::OpMTLO(const DecodedInstruction& i) {
+    sp.lo = Get(i.rs);
+}
+
+void CPU::OpMULT(const DecodedInstruction& i) {
+    const s64 a = static_cast<s32>(Get(i.rs));
+    const s64 b = static_cast<s32>(Get(i.rt));
+    const u64 result = static_cast<u64>(a * b);
+
+    sp.lo = result & 0xFFFFFFFF;
+    sp.hi = result >> 32;
+}
+
+void CPU::OpMULTU(const DecodedInstruction& i) {
+    const u64 a = Get(i.rs);
+    const u64 b = Get(i.rt);
+    const u64 result = a * b;
+
+    sp.lo = result & 0xFFFFFFFF;
+    sp.hi = result >> 32;
+}
+
+void CPU::OpDIV(const DecodedInstruction& i) {
+    const s32 n = static_cast<s32>(Get(i.rs));
+    const s32 d = static_cast<s32>(Get(i.rt));
+
+    // check for special cases
+    if (d == 0) {
+        sp.hi = static_cast<u32>(n);
+        sp.lo = (n >= 0) ? 0xFFFFFFFF : 0x1;
+    } else if (static_cast<u32>(n) == 0x80000000 && d == -1) {
+        sp.hi = 0x0;
+        sp.lo = 0x80000000;
+    } else {
+        sp.hi = static_cast<u32>(n % d);
+        sp.lo = static_cast<u32>(n / d);
+    }
+}
+
+void CPU::OpDIVU(const DecodedInstruction& i) {
+    const u32 n = Get(i.rs);
+    const u32 d = Get(i.rt);
+
+    // check for special case
+    if (d == 0) {
+        sp.hi = n;
+        sp.lo = 0xFFFFFFFF;
+    } else {
+        sp.hi = n % d;
+        sp.lo = n / d;
+    }
+}
+
+void CPU::OpADD(const DecodedInstruction& i) {
+    const u32 a = Get(i.rs);
+    const u32 b = Get(i.rt);
+    const u32 result = a + b;
+    if (!((a ^ b) & 0x80000000) && ((result ^ a) & 0x80000000))
+        Exception(ExceptionCode::Overflow);
+    else
+        Set(i.rd, result);
+}
+
+void CPU::OpADDU(const DecodedInstruction& i) {
+    Set(i.rd, Get(i.rs) + Get(i.rt));
+}
+
+void CPU::OpSUB(const DecodedInstruction& i) {
+    const u32 a = Get(i.rs);
+    const u32 b = Get(i.rt);
+    const u32 result = a - b;
+    if (((a ^ b) & 0x80000000) && ((result ^ a) & 0x80000000))
+        Exception(ExceptionCode::Overflow);
+    else
+        Set(i.rd, result);
+}
+
+void CPU::OpSUBU(const DecodedInstruction& i) {
+    Set(i.rd, Get(i.rs) - Get(i.rt));
+}
+
+void CPU::OpAND(const DecodedInstruction& i) {
+    Set(i.rd, Get(i.rs) & Get(i.rt));
+}
+
+void CPU::OpOR(const DecodedInstruction& i) {
+    Set(i.rd, Get(i.rs) | Get(i.rt));
+}
+
+void CPU::OpXOR(const DecodedInstruction& i) {
+    Set(i.rd, Get(i.rs) ^ Get(i.rt));
+}
+
+void CPU::OpNOR(const DecodedInstruction& i) {
+    Set(i.rd, ~(Get(i.rs) | Get(i.rt)));
+}
+
+void CPU::OpSLT(const DecodedInstruction& i) {
+    Set(i.rd, (static_cast<s32>(Get(i.rs)) < static_cast<s32>(Get(i.rt))) ? 1 : 0);
+}
+
+void CPU::OpSLTU(const DecodedInstruction& i) {
+    Set(i.rd, (Get(i.rs) < Get(i.rt)) ? 1 : 0);
+}
+
+void CPU::OpInvalidSpecial(const DecodedInstruction& i) {
+    Instruction instr {i.value};
+    LogCrit("Invalid special opcode 0x{:02X} [0x{:08X}]", (u32)instr.s.sop.GetValue(), i.value);
+    Exception(ExceptionCode::ReservedInstr);
+}
+
+void CPU::OpBXX(const DecodedInstruction& i) {
+    const bool is_bgez = (i.rt & 0x01) != 0;
+    const bool is_link = (i.rt & 0x1E) == 0x10;
+
+    // check if lz
+    bool test = static_cast<s32>(Get(i.rs)) < 0;
+    // flip check for gez
+    test ^= is_bgez;
+
+    in_delay_slot = true;
+    if (is_link) Set(GP_Registers::RA, next_pc);
+    if (test) {
+        next_pc = sp.pc + i.imm;
+        branch_taken = true;
+    }
+}
+
+void CPU::OpJ(const DecodedInstruction& i) {
+    next_pc &= 0xF0000000;
+    next_pc |= i.imm;
+    in_delay_slot = true;
+    branch_taken = true;
+}
+
+void CPU::OpJAL(const DecodedInstruction& i) {
+    Set(GP_Registers::RA, next_pc);
+    next_pc &= 0xF0000000;
+    next_pc |= i.imm;
+    in_delay_slot = true;
+    branch_taken = true;
+}
+
+void CPU::OpBEQ(const DecodedInstruction& i) {
+    in_delay_slot = true;
+    if (Get(i.rs) == Get(i.rt)) {
+        next_pc = sp.pc + i.imm;
+        branch_taken = true;
+    }
+}
+
+void CPU::OpBNE(const DecodedInstruction& i) {
+    in_delay_slot = true;
+    if (Get(i.rs) != Get(i.rt)) {
+        next_pc = sp.pc + i.imm;
+        branch_taken = true;
+    }
+}
+
+void CPU::OpBLEZ(const DecodedInstruction& i) {
+    in_delay_slot = true;
+    if (static_cast<s32>(Get(i.rs)) <= 0) {
+        next_pc = sp.pc + i.imm;
+        branch_taken = true;
+    }
+}
+
+void CPU::OpBGTZ(const DecodedInstruction& i) {
+    in_delay_slot = true;
+    if (static_cast<s32>(Get(i.rs)) > 0) {
+        next_pc = sp.pc + i.imm;
+        branch_taken = true;
+    }
+}
+
+void CPU::OpADDI(const DecodedInstruction& i) {
+    const u32 old = Get(i.rs);
+    const u32 add = i.imm;
+    const u32 result = old + add;
+    if (!((old ^ add) & 0x80000000) && ((result ^ old) & 0x80000000))
+        Exception(ExceptionCode::Overflow);
+    else
+        Set(i.rt, result);
+}
+
+void CPU::OpADDIU(const DecodedInstruction& i) {
+    Set(i.rt, Get(i.rs) + i.imm);
+}
+
+void CPU::OpSLTI(const DecodedInstruction& i) {
+    Set(i.rt, (static_cast<s32>(Get(i.rs)) < static_cast<s32>(i.imm)) ? 1 : 0);
+}
+
+void CPU::OpSLTIU(const DecodedInstruction& i) {
+    Set(i.rt, (Get(i.rs) < i.imm) ? 1 : 0);
+}
+
+void CPU::OpANDI(const DecodedInstruction& i) {
+    Set(i.rt, Get(i.rs) & i.imm);
+}
+
+void CPU::OpORI(const DecodedInstruction& i) {
+    Set(i.rt, Get(i.rs) | i.imm);
+}
 
-    // tick the components (2 is a bad approximation but seems to be better than 1 for now)
-    sys->AddCycles(2);
+void CPU::OpXORI(const DecodedInstruction& i) {
+    Set(i.rt, Get(i.rs) ^ i.imm);
+}
+
+void CPU::OpLUI(const DecodedInstruction& i) {
+    Set(i.rt, i.imm);
+}
+
+void CPU::OpMFC0(const DecodedInstruction& i) {
+    SetDelayEntry(i.rt, GetCP0(i.rd));
+}
+
+void CPU::OpMTC0(const DecodedInstruction& i) {
+    SetCP0(i.rd, Get(i.rt));
+}
+
+void CPU::OpRFE(const DecodedInstruction& i) {
+    if ((i.value & 0x3F) != 0b010000) Panic("Invalid CP0 instruction 0x{:08X}!", i.value);
+    // restore the interrupt/user pairs that we changed before jumping into the exception handler
+    const u32 mode = cp.sr.value & 0x3C;
+    cp.sr.value &= ~0xFu;    // bits 4-5 are left unchanged
+    cp.sr.value |= (mode >> 2);
+}
+
+void CPU::OpInvalidCOP0(const DecodedInstruction& i) {
+    Instruction instr {i.value};
+    Panic("Invalid coprocessor opcode 0x{:02X}!", (u32)instr.cop.cop_op.GetValue());
+}
+
+u64 CPU::WaitForGte(const DecodedInstruction& i) {
+    u64 now = sys->GetGlobalTicks() + stall_cycles;
+    // recompiled blocks only add their cycles once they are done
+    if (running_block) now += static_cast<u64>(&i - running_block->instructions.data()) * CYCLES_PER_INSTRUCTION;
+
+    if (now < gte_done_ticks) {
+        stall_cycles += static_cast<u32>(gte_done_ticks - now);
+        now = gte_done_ticks;
+    }
+    return now;
+}
+
+void CPU::OpCOP2(const DecodedInstruction& i) {
+    Profiler::Scope scope(*sys->profiler, Profiler::Category::GTE);
+    // the GTE runs one command at a time
+    const u64 now = WaitForGte(i);
+    gte_done_ticks = now + gte.ExecuteCommand(i.value);
+}
+
+void CPU::OpMFC2(const DecodedInstruction& i) {
+    WaitForGte(i);
+    Set(i.rt, gte.GetReg(i.rd));
+}
+
+void CPU::OpCFC2(const DecodedInstruction& i) {
+    WaitForGte(i);
+    Set(i.rt, gte.GetReg(i.rd + 32));
+}
+
+void CPU::OpMTC2(const DecodedInstruction& i) {
+    WaitForGte(i);
+    gte.SetReg(i.rd, Get(i.rt));
+}
+
+void CPU::OpCTC2(const DecodedInstruction& i) {
+    WaitForGte(i);
+    gte.SetReg(i.rd + 32, Get(i.rt));
+}
+
+void CPU::OpInvalidCOP2(const DecodedInstruction& i) {
+    Instruction instr {i.value};
+    Panic("Invalid GTE coprocessor opcode 0x{:02X}!", (u32)instr.cop.cop_op.GetValue());
+}
+
+void CPU::OpCopError(const DecodedInstruction&) {
+    Exception(ExceptionCode::CopError);
+}
+
+void CPU::OpLB(const DecodedInstruction& i) {
+    u32 address = Get(i.rs) + i.imm;
+    u32 value = static_cast<s8>(Load8(address));
+    SetDelayEntry(i.rt, value);
+}
+
+void CPU::OpLH(const DecodedInstruction& i) {
+    u32 address = Get(i.rs) + i.imm;
+    u32 value = static_cast<s16>(Load16(address));
+    if (address & 0x1)
+        Exception(ExceptionCode::LoadAddress);
+    else
+        SetDelayEntry(i.rt, value);
+}
+
+void CPU::OpLWL(const DecodedInstruction& i) {
+    if (cp.sr.isolate_cache) Panic("Load with isolated cache");
+    u32 address = Get(i.rs) + i.imm;
+
+    u32 aligned_value = Load32(address & ~0x3);
+    u32 old_value = (pending_delay_entry.reg == i.rt) ? pending_delay_entry.value : Get(i.rt);
+
+    u32 new_value = 0;
+    switch (address & 0x3) {
+        case 0: new_value = (old_value & 0x00FFFFFF) | (aligned_value << 24); break;
+        case 1: new_value = (old_value & 0x0000FFFF) | (aligned_value << 16); break;
+        case 2: new_value = (old_value & 0x000000FF) | (aligned_value << 8); break;
+        case 3: new_value = aligned_value; break;
+    }
+    SetDelayEntry(i.rt, new_value);
+}
+
+void CPU::OpLW(const DecodedInstruction& i) {
+    if (cp.sr.isolate_cache) Panic("Load with isolated cache");
+    u32 address = Get(i.rs) + i.imm;
+    if (address & 0x3)
+        Exception(ExceptionCode::LoadAddress);
+    else
+        SetDelayEntry(i.rt, Load32(address));
+}
+
+void CPU::OpLBU(const DecodedInstruction& i) {
+    u32 address = Get(i.rs) + i.imm;
+    SetDelayEntry(i.rt, Load8(address));
+}
+
+void CPU::OpLHU(const DecodedInstruction& i) {
+    u32 address = Get(i.rs) + i.imm;
+    if (address & 0x1)
+        Exception(ExceptionCode::LoadAddress);
+    else
+        SetDelayEntry(i.rt, Load16(address));
+}
+
+void CPU::OpLWR(const DecodedInstruction& i) {
+    if (cp.sr.isolate_cache) Panic("Load with isolated cache");
+    u32 address = Get(i.rs) + i.imm;
+
+    u32 aligned_value = Load32(address & ~0x3);
+    u32 old_value = (pending_delay_entry.reg == i.rt) ? pending_delay_entry.value : Get(i.rt);
+
+    u32 new_value = 0;
+    switch (address & 0x3) {
+        case 0: new_value = aligned_value; break;
+        case 1: new_value = (old_value & 0xFF000000) | (aligned_value >> 8); break;
+        case 2: new_value = (old_value & 0xFFFF0000) | (aligned_value >> 16); break;
+        case 3: new_value = (old_value & 0xFFFFFF00) | (aligned_value >> 24); break;
+    }
+    SetDelayEntry(i.rt, new_value);
+}
+
+void CPU::OpSB(const DecodedInstruction& i) {
+    u32 address = Get(i.rs) + i.imm;
+    u8 byte = static_cast<u8>(Get(i.rt) & 0xFF);
+    Store8(address, byte);
+}
+
+void CPU::OpSH(const DecodedInstruction& i) {
+    u32 address = Get(i.rs) + i.imm;
+    u16 halfword = static_cast<u16>(Get(i.rt) & 0xFFFF);
+    if (address & 0x1)
+        Exception(ExceptionCode::StoreAddress);
+    else
+        Store16(address, halfword);
+}
+
+void CPU::OpSWL(const DecodedInstruction& i) {
+    u32 address = Get(i.rs) + i.imm;
+    u32 aligned_value = Load32(address & ~0x3);
+    u32 old_value = Get(i.rt);
+
+    u32 new_value = 0;
+    switch (address & 0x3) {
+        case 0: new_value = (aligned_value & 0xFFFFFF00) | (old_value >> 24); break;
+        case 1: new_value = (aligned_value & 0xFFFF0000) | (old_value >> 16); break;
+        case 2: new_value = (aligned_value & 0xFF000000) | (old_value >> 8); break;
+        case 3: new_value = old_value; break;
+    }
+    Store32(address & ~0x3, new_value);
+}
+
+void CPU::OpSW(const DecodedInstruction& i) {
+    u32 address = Get(i.rs) + i.imm;
+    if (address & 0x3)
+        Exception(ExceptionCode::StoreAddress);
+    else
+        Store32(address, Get(i.rt));
+}
+
+void CPU::OpSWR(const DecodedInstruction& i) {
+    u32 address = Get(i.rs) + i.imm;
+    u32 aligned_value = Load32(address & ~0x3);
+    u32 old_value = Get(i.rt);
+
+    u32 new_value = 0;
+    switch (address & 0x3) {
+        case 0: new_value = old_value; break;
+        case 1: new_value = (aligned_value & 0x000000FF) | (old_value << 8); break;
+        case 2: new_value = (aligned_value & 0x0000FFFF) | (old_value << 16); break;
+        case 3: new_value = (aligned_value & 0x00FFFFFF) | (old_value << 24); break;
+    }
+    Store32(address & ~0x3, new_value);
+}
+
+void CPU::OpLWC2(const DecodedInstruction& i) {
+    u32 address = Get(i.rs) + i.imm;
+    u32 value = Load32(address);
+
+    WaitForGte(i);
+    gte.SetReg(i.rt, value);
+}
+
+void CPU::OpSWC2(const DecodedInstruction& i) {
+    u32 address = Get(i.rs) + i.imm;
+
+    WaitForGte(i);
+    u32 value = gte.GetReg(i.rt);
+    Store32(address, value);
+}
+
+void CPU::OpInvalid(const DecodedInstruction& i) {
+    Instruction instr {i.value};
+    LogCrit("Invalid opcode 0x{:02X} [0x{:08X}]", (u32)instr.n.op.GetValue(), i.value);
+    Exception(ExceptionCode::ReservedInstr);
 }
 
 void CPU::Exception(ExceptionCode cause) {
@@ -632,6 +999,8 @@ void CPU::Exception(ExceptionCode cause) {
 
     sp.pc = handler;
     next_pc = handler + 4;
+
+    exception_raised = true;
 }
 
 u32 CPU::Load32(u32 address) {
@@ -716,74 +1085,4 @@ void CPU::UpdatePC(u32 address) {
     next_pc = address + 4;
 }
 
-void CPU::DrawCpuState(bool* open) {
-    ImGui::Begin("CPU State", open);
-    ImGui::Separator();
-
-    if (ImGui::TreeNode("Edit")) {
-        static int curr_gp_reg = 0;
-        ImGui::Text("GP Registers ");
-        ImGui::SameLine();
-        ImGui::Combo("##gp_reg_list", &curr_gp_reg, REG_NAMES, GP_REG_COUNT, 10);
-        ImGui::SameLine();
-        ImGui::InputScalar("##gp_reg_edit", ImGuiDataType_U32, &gp.r[curr_gp_reg], nullptr, nullptr, "%08X",
-                           ImGuiInputTextFlags_CharsHexadecimal);
-
-        static int curr_sp_reg = 0;
-        ImGui::Text("SP Registers ");
-        ImGui::SameLine();
-        ImGui::Combo("##sp_reg_list", &curr_sp_reg, SP_REG_NAMES, SP_REG_COUNT);
-        ImGui::SameLine();
-        ImGui::InputScalar("##sp_reg_edit", ImGuiDataType_U32, &sp.spr[curr_sp_reg], nullptr, nullptr, "%08X",
-                           ImGuiInputTextFlags_CharsHexadecimal);
-
-        static int curr_cop_reg = 0;
-        ImGui::Text("COP0 Registers ");
-        ImGui::SameLine();
-        ImGui::Combo("##cop_reg_list", &curr_cop_reg, COP0_REG_NAMES, COP_REG_COUNT, 10);
-        ImGui::SameLine();
-        ImGui::InputScalar("##cop_reg_edit", ImGuiDataType_U32, &cp.cpr[curr_cop_reg], nullptr, nullptr, "%08X",
-                           ImGuiInputTextFlags_CharsHexadecimal);
-
-        ImGui::TreePop();
-    }
-
-    ImGui::Separator();
-
-    ImGui::Text("GP Registers");
-    ImGui::Columns(4);
-    for (u32 col = 0; col < 4; col++) {
-        for (u32 row = 0; row < 8; row++) {
-            const u32 index = row + col * 8;
-            ImGui::Text(" $%-3s %08X", REG_NAMES[index], gp.r[row + col * 8]);
-        }
-        ImGui::NextColumn();
-    }
-    ImGui::Columns(1);
-
-    ImGui::Separator();
-    ImGui::Text("SP Registers");
-    ImGui::Columns(4);
-    ImGui::Text(" PC   %08X", sp.pc);
-    ImGui::NextColumn();
-    ImGui::Text(" HI   %08X", sp.hi);
-    ImGui::NextColumn();
-    ImGui::Text(" LO   %08X", sp.lo);
-    ImGui::Columns(1);
-
-    ImGui::Separator();
-    ImGui::Text("COP0 Registers");
-    ImGui::Columns(4);
-    for (u32 col = 0; col < 4; col++) {
-        for (u32 row = 0; row < 4; row++) {
-            const u32 index = row + col * 4;
-            ImGui::Text(" $%-10s %08X", COP0_REG_NAMES[index], cp.cpr[row + col * 4]);
-        }
-        ImGui::NextColumn();
-    }
-    ImGui::Columns(1);
-
-    ImGui::End();
-}
-
 }    // namespace CPU
\ No newline at end of file
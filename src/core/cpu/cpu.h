@@ -1,10 +1,15 @@
 #pragma once
 
+#include "code_cache.h"
 #include "cpu_common.h"
 #include "cpu_disasm.h"
 #include "debugger/debugger.h"
 #include "gte.h"
 
+#ifdef USE_RECOMPILER
+#include "recompiler/recompiler.h"
+#endif
+
 class BUS;
 class System;
 class Debugger;
@@ -14,6 +19,8 @@ namespace CPU {
 
 class CPU {
     friend class Disassembler;
+    friend class CodeCache;
+    friend class Recompiler;
     friend class ::Debugger;
     friend class ::BUS;
 
@@ -21,7 +28,12 @@ public:
     explicit CPU(System* system);
     void Reset();
 
-    void Step();
+    // runs until the cycle budget is used up, the next scheduled event was handled or the CPU got halted
+    // breakpoints and single stepping only work with debug enabled, which also disables the recompiler
+    // returns the number of executed cycles
+    template<bool debug>
+    u32 Execute(u32 cycles_budget);
+
     u32 Load32(u32 address);
     void Store32(u32 address, u32 value);
     u16 Load16(u32 address);
@@ -29,7 +41,23 @@ public:
     u8 Load8(u32 address);
     void Store8(u32 address, u8 value);
 
-    void DrawCpuState(bool* open);
+    // drops all cached and recompiled code, required after modifying memory without going through the BUS
+    void FlushCodeCache();
+
+    std::string DisassembleInstruction(u32 address, u32 value);
+
+    // the decode cache can be disabled at runtime, every instruction is then decoded on the fly
+    void SetCodeCacheEnabled(bool enabled);
+    bool CodeCacheEnabled() const { return code_cache_enabled; }
+
+    // the recompiler is only available on x86-64 hosts, the interpreter is used as fallback
+    static constexpr bool RecompilerAvailable();
+    void SetRecompilerEnabled(bool enabled);
+    bool RecompilerEnabled() const { return recompiler_enabled; }
+
+    // runs every recompiled block a second time in the interpreter and compares the registers
+    void SetDifferentialTesting(bool enabled);
+    u64 DifferentialMismatchCount() const { return differential_mismatch_count; }
 
     bool halt = false;
 
@@ -48,6 +76,97 @@ private:
 
     void Exception(ExceptionCode cause);
 
+    template<bool debug>
+    void Step();
+    void UpdateDelaySlotState();
+    template<bool debug>
+    bool ExecuteInstruction();
+    bool ExecuteRecompiledBlock();
+    u32 ExecuteDifferential(CodeBlock* block);
+
+    const DecodedInstruction& FetchInstruction();
+    static DecodedInstruction Decode(u32 value);
+
+    template<void (CPU::*Handler)(const DecodedInstruction&)>
+    static void Dispatch(CPU& cpu, const DecodedInstruction& i) {
+        (cpu.*Handler)(i);
+    }
+
+    // instruction handlers
+    void OpSLL(const DecodedInstruction& i);
+    void OpSRL(const DecodedInstruction& i);
+    void OpSRA(const DecodedInstruction& i);
+    void OpSLLV(const DecodedInstruction& i);
+    void OpSRLV(const DecodedInstruction& i);
+    void OpSRAV(const DecodedInstruction& i);
+    void OpJR(const DecodedInstruction& i);
+    void OpJALR(const DecodedInstruction& i);
+    void OpSYSCALL(const DecodedInstruction& i);
+    void OpBREAK(const DecodedInstruction& i);
+    void OpMFHI(const DecodedInstruction& i);
+    void OpMTHI(const DecodedInstruction& i);
+    void OpMFLO(const DecodedInstruction& i);
+    void OpMTLO(const DecodedInstruction& i);
+    void OpMULT(const DecodedInstruction& i);
+    void OpMULTU(const DecodedInstruction& i);
+    void OpDIV(const DecodedInstruction& i);
+    void OpDIVU(const DecodedInstruction& i);
+    void OpADD(const DecodedInstruction& i);
+    void OpADDU(const DecodedInstruction& i);
+    void OpSUB(const DecodedInstruction& i);
+    void OpSUBU(const DecodedInstruction& i);
+    void OpAND(const DecodedInstruction& i);
+    void OpOR(const DecodedInstruction& i);
+    void OpXOR(const DecodedInstruction& i);
+    void OpNOR(const DecodedInstruction& i);
+    void OpSLT(const DecodedInstruction& i);
+    void OpSLTU(const DecodedInstruction& i);
+    void OpInvalidSpecial(const DecodedInstruction& i);
+    void OpBXX(const DecodedInstruction& i);
+    void OpJ(const DecodedInstruction& i);
+    void OpJAL(const DecodedInstruction& i);
+    void OpBEQ(const DecodedInstruction& i);
+    void OpBNE(const DecodedInstruction& i);
+    void OpBLEZ(const DecodedInstruction& i);
+    void OpBGTZ(const DecodedInstruction& i);
+    void OpADDI(const DecodedInstruction& i);
+    void OpADDIU(const DecodedInstruction& i);
+    void OpSLTI(const DecodedInstruction& i);
+    void OpSLTIU(const DecodedInstruction& i);
+    void OpANDI(const DecodedInstruction& i);
+    void OpORI(const DecodedInstruction& i);
+    void OpXORI(const DecodedInstruction& i);
+    void OpLUI(const DecodedInstruction& i);
+    void OpMFC0(const DecodedInstruction& i);
+    void OpMTC0(const DecodedInstruction& i);
+    void OpRFE(const DecodedInstruction& i);
+    void OpInvalidCOP0(const DecodedInstruction& i);
+    void OpCOP2(const DecodedInstruction& i);
+    void OpMFC2(const DecodedInstruction& i);
+    void OpCFC2(const DecodedInstruction& i);
+    void OpMTC2(const DecodedInstruction& i);
+    void OpCTC2(const DecodedInstruction& i);
+    void OpInvalidCOP2(const DecodedInstruction& i);
+    void OpCopError(const DecodedInstruction& i);
+    void OpLB(const DecodedInstruction& i);
+    void OpLH(const DecodedInstruction& i);
+    void OpLWL(const DecodedInstruction& i);
+    void OpLW(const DecodedInstruction& i);
+    void OpLBU(const DecodedInstruction& i);
+    void OpLHU(const DecodedInstruction& i);
+    void OpLWR(const DecodedInstruction& i);
+    void OpSB(const DecodedInstruction& i);
+    void OpSH(const DecodedInstruction& i);
+    void OpSWL(const DecodedInstruction& i);
+    void OpSW(const DecodedInstruction& i);
+    void OpSWR(const DecodedInstruction& i);
+    void OpLWC2(const DecodedInstruction& i);
+    void OpSWC2(const DecodedInstruction& i);
+    void OpInvalid(const DecodedInstruction& i);
+
+    // stalls until the last GTE command is done, returns the current cycle including the stall
+    u64 WaitForGte(const DecodedInstruction& i);
+
     u32 next_pc = 0, current_pc = 0;
     bool branch_taken = false, was_branch_taken = false;
     bool in_delay_slot = false, was_in_delay_slot = false;
@@ -57,9 +176,40 @@ private:
 
     System* sys = nullptr;
 
+    CodeCache code_cache;
+    bool code_cache_enabled = true;
+    // block that contains the next instruction if execution continues sequentially
+    CodeBlock* current_block = nullptr;
+    u32 current_block_index = 0, current_block_pc = 0;
+    // only used if the instruction couldn't be fetched from the cache
+    DecodedInstruction uncached_instruction;
+
+    bool recompiler_enabled = false;
+    bool differential_testing = false;
+    u64 differential_mismatch_count = 0;
+    // set whenever an exception handler gets entered, recompiled blocks use this to exit early
+    bool exception_raised = false;
+#ifdef USE_RECOMPILER
+    Recompiler recompiler;
+#endif
+
     GTE gte;
+    // the GTE works in parallel to the CPU, any access before this cycle stalls the CPU
+    u64 gte_done_ticks = 0;
+    // stall of the current instruction (or recompiled block), added to its own cycles afterwards
+    u32 stall_cycles = 0;
+    // block the recompiler is executing, its cycles only get added at the end
+    CodeBlock* running_block = nullptr;
 
     Disassembler disassembler;
 };
 
+constexpr bool CPU::RecompilerAvailable() {
+#ifdef USE_RECOMPILER
+    return true;
+#else
+    return false;
+#endif
+}
+
 }    // namespace CPU
\ No newline at end of file
@@ -220,6 +220,9 @@ union Instruction {
 
 constexpr u32 COP2_IMM_OPCODE = 0b0100101;
 
+// 2 is a bad approximation but seems to be better than 1 for now
+constexpr u32 CYCLES_PER_INSTRUCTION = 2;
+
 struct LoadDelayEntry {
     u32 reg = 0;
     u32 value = 0;
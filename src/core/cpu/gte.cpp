@@ -1,13 +1,18 @@
 #include "gte.h"
 
+#include <algorithm>
 #include <bit>
 
 #include "common/asserts.h"
 #include "common/log.h"
+#include "gte_lanes.h"
 #include "util/type_util.h"
 
 LOG_CHANNEL(GTE);
 
+using GteLanes::LaneFlags;
+using GteLanes::Lanes;
+
 template<>
 void Vector3<s16>::SetXYFromU32(u32 value) {
     x = static_cast<s16>(value);
@@ -21,6 +26,55 @@ u32 Vector3<s16>::GetXYAsU32() {
     return (msbs << 16) | (lsbs & 0xFFFF);
 }
 
+// reciprocal table of the division unit, formula from https://problemkaputt.de/psx-spx.htm#gtedivisioninaccuracy
+// the extra entry 0x100 is used for divisors of 0xFFC0 and above
+static constexpr std::array<u8, 257> UNR_TABLE = [] {
+    std::array<u8, 257> table {};
+    for (u32 i = 0; i < table.size(); i++) {
+        table[i] = static_cast<u8>(std::max(0, (0x40000 / s32(i + 0x100) + 1) / 2 - 0x101));
+    }
+    return table;
+}();
+static_assert(UNR_TABLE[0x00] == 0xFF && UNR_TABLE[0x80] == 0x54 && UNR_TABLE[0xFE] == 0x00 && UNR_TABLE[0x100] == 0x00);
+
+// columns of the matrix, lane n holds the element of row n
+static ALWAYS_INLINE std::array<Lanes, 3> LoadColumns(const Matrix3x3& m) {
+    return {GteLanes::Set(m.elems[0][0], m.elems[1][0], m.elems[2][0]),
+            GteLanes::Set(m.elems[0][1], m.elems[1][1], m.elems[2][1]),
+            GteLanes::Set(m.elems[0][2], m.elems[1][2], m.elems[2][2])};
+}
+
+// True if 't << 12' plus three 16x16 bit products can't leave the 44bit MAC range, which makes the overflow checks
+// and sign extensions after every step no-ops. Only extreme translation or color vectors need the checked path.
+static ALWAYS_INLINE bool FitsMac(s32 t) {
+    static constexpr s64 LIMIT = (s64(1) << 31) - (s64(1) << 20);
+    return s64(t) > -LIMIT && s64(t) < LIMIT;
+}
+
+static ALWAYS_INLINE bool FitsMac(const Vector3<s32>& t) {
+    return FitsMac(t.x) && FitsMac(t.y) && FitsMac(t.z);
+}
+
+// mac + m * v with the same 44bit overflow checks after every step as MatrixMultiply, v has one component in all lanes
+template<bool checked>
+static ALWAYS_INLINE Lanes MultiplyLanes(const std::array<Lanes, 3>& columns, const Lanes& x, const Lanes& y,
+                                         const Lanes& z, const Lanes& mac, LaneFlags& mac_flags) {
+    if constexpr (checked) {
+        const Lanes sum_x = GteLanes::MulAdd(mac, columns[0], x, mac_flags);
+        const Lanes sum_y = GteLanes::MulAdd(sum_x, columns[1], y, mac_flags);
+        return GteLanes::MulAdd(sum_y, columns[2], z, mac_flags);
+    } else {
+        return GteLanes::MulAdd(GteLanes::MulAdd(GteLanes::MulAdd(mac, columns[0], x), columns[1], y), columns[2], z);
+    }
+}
+
+template<bool checked>
+static ALWAYS_INLINE Lanes MultiplyLanes(const std::array<Lanes, 3>& columns, const Vector3<s16>& v, const Lanes& mac,
+                                         LaneFlags& mac_flags) {
+    return MultiplyLanes<checked>(columns, GteLanes::Broadcast(v.x), GteLanes::Broadcast(v.y),
+                                  GteLanes::Broadcast(v.z), mac, mac_flags);
+}
+
 void GTE::SetReg(u32 index, u32 value) {
     DebugAssert(index < 64);
 
@@ -230,6 +284,7 @@ void GTE::SetReg(u32 index, u32 value) {
             z_scale_factor_4 = static_cast<s16>(value);
             break;
         case 63:
+            lane_flag_rows = 0;
             error_flags.bits = (error_flags.bits & 0x80000FFF) | (value & ~0x80000FFF);
             break;
         default:
@@ -442,6 +497,7 @@ u32 GTE::GetReg(u32 index) {
             value = SignExtend32(z_scale_factor_4);
             break;
         case 63:
+            ApplyLaneFlags();
             UpdateErrMasterFlag();
             value = error_flags.bits;
             break;
@@ -457,13 +513,8 @@ u32 GTE::GetReg(u32 index) {
 u32 GTE::CountLeadingBits() const {
     const u32 value = static_cast<u32>(leading_bit_source);
 
-    if (value >> 31) {
-        // count leading ones
-        return static_cast<u32>(std::countl_one(value));
-    } else {
-        // count leading zeros
-        return static_cast<u32>(std::countl_zero(value));
-    }
+    // leading ones of a negative value are the leading zeros of its complement, a single lzcnt/bsr
+    return static_cast<u32>(std::countl_zero(value ^ static_cast<u32>(leading_bit_source >> 31)));
 }
 
 template<u32 ir_id>
@@ -653,112 +704,57 @@ void GTE::InterpolateColor(s32 mac1, s32 mac2, s32 mac3, u8 shift, bool lm) {
     SetMacAndIR<3>(s64(ir_vec.ir3) * s64(ir0) + mac3, shift, lm);
 }
 
-void GTE::ExecuteCommand(u32 cmd_value) {
+u32 GTE::ExecuteCommand(u32 cmd_value) {
     //LogTrace("COMMAND 0x{:02X}", cmd_value);
 
-    ResetErrorFlag();
-
-    Command cmd { .value = cmd_value };
+    // indexed by the real opcode, cycle counts from https://problemkaputt.de/psx-spx.htm#gteoverview
+    static constexpr std::array<CommandInfo, 64> COMMANDS = [] {
+        std::array<CommandInfo, 64> table {};
+        table[0x01] = {&Dispatch<&GTE::RTPS>, 15};
+        table[0x06] = {&Dispatch<&GTE::NCLIP>, 8};
+        table[0x0C] = {&Dispatch<&GTE::OP>, 6};
+        table[0x10] = {&Dispatch<&GTE::DPCS>, 8};
+        table[0x11] = {&Dispatch<&GTE::INTPL>, 8};
+        table[0x12] = {&Dispatch<&GTE::MVMVA>, 8};
+        table[0x13] = {&Dispatch<&GTE::NCDS>, 19};
+        table[0x14] = {&Dispatch<&GTE::CDP>, 13};
+        table[0x16] = {&Dispatch<&GTE::NCDT>, 44};
+        table[0x1B] = {&Dispatch<&GTE::NCCS>, 17};
+        table[0x1C] = {&Dispatch<&GTE::CC>, 11};
+        table[0x1E] = {&Dispatch<&GTE::NCS>, 14};
+        table[0x20] = {&Dispatch<&GTE::NCT>, 30};
+        table[0x28] = {&Dispatch<&GTE::SQR>, 5};
+        table[0x29] = {&Dispatch<&GTE::DCPL>, 8};
+        table[0x2A] = {&Dispatch<&GTE::DPCT>, 17};
+        table[0x2D] = {&Dispatch<&GTE::AVSZ3>, 5};
+        table[0x2E] = {&Dispatch<&GTE::AVSZ4>, 6};
+        table[0x30] = {&Dispatch<&GTE::RTPT>, 23};
+        table[0x3D] = {&Dispatch<&GTE::GPF>, 5};
+        table[0x3E] = {&Dispatch<&GTE::GPL>, 5};
+        table[0x3F] = {&Dispatch<&GTE::NCCT>, 39};
+        return table;
+    }();
 
-    u8 shift = cmd.sf ? 12 : 0;
-    bool lm = cmd.lm;
+    ResetErrorFlag();
 
-    switch (cmd.real_opcode) {
-        case 0x01:
-            RTPS(vec0, shift, lm, true);
-            break;
-        case 0x06:
-            NCLIP();
-            break;
-        case 0x0C:
-            OP(shift, lm);
-            break;
-        case 0x10:
-            DPCS(shift, lm);
-            break;
-        case 0x11:
-            INTPL(shift, lm);
-            break;
-        case 0x12:
-            MVMVA(cmd);
-            break;
-        case 0x13:
-            NCDS(shift, lm);
-            break;
-        case 0x14:
-            CDP(shift, lm);
-            break;
-        case 0x16:
-            NCDT(shift, lm);
-            break;
-        case 0x1B:
-            NCCS(shift, lm);
-            break;
-        case 0x1C:
-            CC(shift, lm);
-            break;
-        case 0x1E:
-            NCS(shift, lm);
-            break;
-        case 0x20:
-            NCT(shift, lm);
-            break;
-        case 0x28:
-            SQR(shift, lm);
-            break;
-        case 0x29:
-            DCPL(shift, lm);
-            break;
-        case 0x2A:
-            DPCT(shift, lm);
-            break;
-        case 0x2D:
-            AVSZ3();
-            break;
-        case 0x2E:
-            AVSZ4();
-            break;
-        case 0x30:
-            RTPT(shift, lm);
-            break;
-        case 0x3D:
-            GPF(shift, lm);
-            break;
-        case 0x3E:
-            GPL(shift, lm);
-            break;
-        case 0x3F:
-            NCCT(shift, lm);
-            break;
-        default:
-            Panic("Invalid GTE Command: 0x{:02X}", cmd.real_opcode);
+    const Command cmd { .value = cmd_value };
+    const CommandInfo& info = COMMANDS[cmd.real_opcode];
+    if (!info.handler) [[unlikely]] {
+        Panic("Invalid GTE Command: 0x{:02X}", cmd.real_opcode);
     }
 
-    UpdateErrMasterFlag();
+    info.handler(*this, cmd);
+    return info.cycles;
 }
 
-void GTE::RTPS(const Vector3<s16>& v, u8 shift, bool lm, bool last_vertex) {
-    s64 z = RTPKernel(v, shift, lm);
-
-    PushScreenZ(static_cast<s32>(z >> 12));
-
-    s64 div_result = static_cast<s64>(UNRDivide(proj_plane_dist, screen_z[3]));
-
-    s32 screen_x = static_cast<s32>(SetMac0(div_result * ir_vec.ir1 + sof_x) >> 16); // SX = MAC0 / 0x10000
-    s32 screen_y = static_cast<s32>(SetMac0(div_result * ir_vec.ir2 + sof_y) >> 16); // SY = MAC0 / 0x10000
-    PushScreenX(screen_x);
-    PushScreenY(screen_y);
-    
-    if (last_vertex) {
-        s64 mac0_val = SetMac0(div_result * s64(depth_queue_param_A) + s64(depth_queue_param_B));
-        SetIR<0>(static_cast<s32>(mac0_val >> 12), lm);
-    }
+void GTE::RTPS(u8 shift, bool lm) {
+    if (FitsMac(tl_vec)) RTPKernel<1, false>(shift, lm);
+    else RTPKernel<1, true>(shift, lm);
 }
 
 void GTE::RTPT(u8 shift, bool lm) {
-    RTPS(vec0, shift, lm, false);
-    RTPS(vec1, shift, lm, false);
-    RTPS(vec2, shift, lm, true);
+    if (FitsMac(tl_vec)) RTPKernel<3, false>(shift, lm);
+    else RTPKernel<3, true>(shift, lm);
 }
 
 void GTE::NCLIP() {
@@ -854,73 +850,115 @@ void GTE::MVMVA(GTE::Command cmd) {
     bool lm = cmd.lm;
 
     if (cmd.mvmva_t_vec != 2) {
-        MatrixMultResult result = MatrixMultiply(m, v, t);
-        SetMacAndIR<1>(result.x, shift, lm);
-        SetMacAndIR<2>(result.y, shift, lm);
-        SetMacAndIR<3>(result.z, shift, lm);
+        const Lanes translation = GteLanes::ShiftLeft<12>(GteLanes::Set(t.x, t.y, t.z));
+
+        LaneFlags mac_flags;
+        u32 ir_mask = 0;
+        const Lanes product = FitsMac(t) ? MultiplyLanes<false>(LoadColumns(m), v, translation, mac_flags)
+                                         : MultiplyLanes<true>(LoadColumns(m), v, translation, mac_flags);
+        const Lanes mac = GteLanes::ShiftRight(product, shift);
+        const Lanes ir = GteLanes::Saturate(mac, lm ? 0 : -0x8000, 0x7FFF, ir_mask);
+        StoreLanes(mac, ir, mac_flags, ir_mask);
     } else {
         // bugged version if the far color vector was selected
         MVMVAKernelBugged(m, v, t, shift, cmd.lm);
     }
 }
 
-template<u32 type>
-void GTE::NCKernel(const Vector3<s16>& v, u8 shift, bool lm) {
-    const auto [x1, y1, z1] = MatrixMultiply(light_matrix, v);
-    SetMacAndIR<1>(x1, shift, lm);
-    SetMacAndIR<2>(y1, shift, lm);
-    SetMacAndIR<3>(z1, shift, lm);
+template<u32 type, u32 vertex_count>
+void GTE::RunNCKernel(u8 shift, bool lm) {
+    if (FitsMac(background_color) && (type != 2 || FitsMac(far_color))) NCKernel<type, vertex_count, false>(shift, lm);
+    else NCKernel<type, vertex_count, true>(shift, lm);
+}
+
+template<u32 type, u32 vertex_count, bool checked>
+void GTE::NCKernel(u8 shift, bool lm) {
+    const Vector3<s16>* vertices[3] = {&vec0, &vec1, &vec2};
+    const s32 ir_min = lm ? 0 : -0x8000;
+
+    const std::array<Lanes, 3> light = LoadColumns(light_matrix);
+    const std::array<Lanes, 3> color = LoadColumns(color_matrix);
+    const Lanes background =
+        GteLanes::ShiftLeft<12>(GteLanes::Set(background_color.r, background_color.g, background_color.b));
+    const Lanes far = GteLanes::ShiftLeft<12>(GteLanes::Set(far_color.r, far_color.g, far_color.b));
+    const Lanes rgb_code = GteLanes::Set(rgbc.r, rgbc.g, rgbc.b);
+
+    LaneFlags mac_flags;
+    u32 ir_mask = 0;
+
+    // every step runs for all vertices before the next one starts, so their dependency chains overlap
+    std::array<Lanes, vertex_count> mac, ir;
+    for (u32 i = 0; i < vertex_count; i++) {
+        // without a translation vector the light matrix product always fits
+        const Lanes product = MultiplyLanes<false>(light, *vertices[i], GteLanes::Broadcast(0), mac_flags);
+        ir[i] = GteLanes::Saturate(GteLanes::ShiftRight(product, shift), ir_min, 0x7FFF, ir_mask);
+    }
 
-    const auto [x2, y2, z2] = MatrixMultiply(color_matrix, ir_vec, background_color);
-    SetMacAndIR<1>(x2, shift, lm);
-    SetMacAndIR<2>(y2, shift, lm);
-    SetMacAndIR<3>(z2, shift, lm);
+    for (u32 i = 0; i < vertex_count; i++) {
+        const Lanes product = MultiplyLanes<checked>(color, GteLanes::Broadcast<0>(ir[i]),
+                                                     GteLanes::Broadcast<1>(ir[i]), GteLanes::Broadcast<2>(ir[i]),
+                                                     background, mac_flags);
+        mac[i] = GteLanes::ShiftRight(product, shift);
+        ir[i] = GteLanes::Saturate(mac[i], ir_min, 0x7FFF, ir_mask);
+    }
 
     if constexpr (type == 1) {
-        SetMacAndIR<1>((s64(rgbc.r) * s64(ir_vec.ir1)) << 4, shift, lm);
-        SetMacAndIR<2>((s64(rgbc.g) * s64(ir_vec.ir2)) << 4, shift, lm);
-        SetMacAndIR<3>((s64(rgbc.b) * s64(ir_vec.ir3)) << 4, shift, lm);
+        // 'RGBC * IR << 4' cannot overflow the 44bit MAC, so no need to check
+        for (u32 i = 0; i < vertex_count; i++) {
+            mac[i] = GteLanes::ShiftRight(GteLanes::ShiftLeft<4>(GteLanes::Multiply(rgb_code, ir[i])), shift);
+            ir[i] = GteLanes::Saturate(mac[i], ir_min, 0x7FFF, ir_mask);
+        }
     }
 
     if constexpr (type == 2) {
-        s32 mac1 = (s32(rgbc.r) * s32(ir_vec.ir1)) << 4;
-        s32 mac2 = (s32(rgbc.g) * s32(ir_vec.ir2)) << 4;
-        s32 mac3 = (s32(rgbc.b) * s32(ir_vec.ir3)) << 4;
+        // same as InterpolateColor
+        std::array<Lanes, vertex_count> mac_color;
+        for (u32 i = 0; i < vertex_count; i++) {
+            mac_color[i] = GteLanes::ShiftLeft<4>(GteLanes::Multiply(rgb_code, ir[i]));
+
+            const Lanes difference = GteLanes::Sub(far, mac_color[i]);
+            if constexpr (checked) GteLanes::Check44(difference, mac_flags);
+            ir[i] = GteLanes::Saturate(GteLanes::ShiftRight(difference, shift), -0x8000, 0x7FFF, ir_mask);
+        }
 
-        InterpolateColor(mac1, mac2, mac3, shift, lm);
+        // 'IR * IR0 + color' cannot overflow the 44bit MAC, so no need to check
+        for (u32 i = 0; i < vertex_count; i++) {
+            mac[i] = GteLanes::ShiftRight(GteLanes::MulAdd(mac_color[i], ir[i], GteLanes::Broadcast(ir0)), shift);
+            ir[i] = GteLanes::Saturate(mac[i], ir_min, 0x7FFF, ir_mask);
+        }
     }
 
-    PushColorFromMac();
+    for (u32 i = 0; i < vertex_count; i++) {
+        s64 values[4];
+        GteLanes::Store(mac[i], values);
+        PushColor(s32(values[0]) / 0x10, s32(values[1]) / 0x10, s32(values[2]) / 0x10);
+    }
+
+    StoreLanes(mac[vertex_count - 1], ir[vertex_count - 1], mac_flags, ir_mask);
 }
 
 void GTE::NCS(u8 shift, bool lm) {
-    NCKernel<0>(vec0, shift, lm);
+    RunNCKernel<0, 1>(shift, lm);
 }
 
 void GTE::NCT(u8 shift, bool lm) {
-    NCKernel<0>(vec0, shift, lm);
-    NCKernel<0>(vec1, shift, lm);
-    NCKernel<0>(vec2, shift, lm);
+    RunNCKernel<0, 3>(shift, lm);
 }
 
 void GTE::NCCS(u8 shift, bool lm) {
-    NCKernel<1>(vec0, shift, lm);
+    RunNCKernel<1, 1>(shift, lm);
 }
 
 void GTE::NCCT(u8 shift, bool lm) {
-    NCKernel<1>(vec0, shift, lm);
-    NCKernel<1>(vec1, shift, lm);
-    NCKernel<1>(vec2, shift, lm);
+    RunNCKernel<1, 3>(shift, lm);
 }
 
 void GTE::NCDS(u8 shift, bool lm) {
-    NCKernel<2>(vec0, shift, lm);
+    RunNCKernel<2, 1>(shift, lm);
 }
 
 void GTE::NCDT(u8 shift, bool lm) {
-    NCKernel<2>(vec0, shift, lm);
-    NCKernel<2>(vec1, shift, lm);
-    NCKernel<2>(vec2, shift, lm);
+    RunNCKernel<2, 3>(shift, lm);
 }
 
 void GTE::CC(u8 shift, bool lm) {
@@ -1001,14 +1039,6 @@ void GTE::GPL(u8 shift, bool lm) {
 #define CMASE2(val) CheckMacAndSignExtend<2>(val)
 #define CMASE3(val) CheckMacAndSignExtend<3>(val)
 
-GTE::MatrixMultResult GTE::MatrixMultiply(const Matrix3x3& m, const Vector3<s16>& v) {
-    s64 x = CMASE1(CMASE1(CMASE1(s64(m.elems[0][0]) * s64(v.x)) + s64(m.elems[0][1]) * s64(v.y)) + s64(m.elems[0][2]) * s64(v.z));
-    s64 y = CMASE2(CMASE2(CMASE2(s64(m.elems[1][0]) * s64(v.x)) + s64(m.elems[1][1]) * s64(v.y)) + s64(m.elems[1][2]) * s64(v.z));
-    s64 z = CMASE3(CMASE3(CMASE3(s64(m.elems[2][0]) * s64(v.x)) + s64(m.elems[2][1]) * s64(v.y)) + s64(m.elems[2][2]) * s64(v.z));
-
-    return {.x = x, .y = y, .z = z};
-}
-
 GTE::MatrixMultResult GTE::MatrixMultiply(const Matrix3x3& m, const Vector3<s16>& v, const Vector3<s32>& t) {
     s64 x = CMASE1(CMASE1(CMASE1((s64(t.x) << 12) + s64(m.elems[0][0]) * s64(v.x)) + s64(m.elems[0][1]) * s64(v.y)) + s64(m.elems[0][2]) * s64(v.z));
     s64 y = CMASE2(CMASE2(CMASE2((s64(t.y) << 12) + s64(m.elems[1][0]) * s64(v.x)) + s64(m.elems[1][1]) * s64(v.y)) + s64(m.elems[1][2]) * s64(v.z));
@@ -1037,45 +1067,79 @@ void GTE::MVMVAKernelBugged(const Matrix3x3& m, const Vector3<s16>& v, const Vec
 #undef CMASE2
 #undef CMASE3
 
-s64 GTE::RTPKernel(const Vector3<s16>& v, u8 shift, bool lm) {
-    MatrixMultResult rtp_vec = MatrixMultiply(rot_matrix, v, tl_vec);
+template<u32 vertex_count, bool checked>
+void GTE::RTPKernel(u8 shift, bool lm) {
+    const Vector3<s16>* vertices[3] = {&vec0, &vec1, &vec2};
+    const s32 ir_min = lm ? 0 : -0x8000;
+
+    const std::array<Lanes, 3> rotation = LoadColumns(rot_matrix);
+    const Lanes translation = GteLanes::ShiftLeft<12>(GteLanes::Set(tl_vec.x, tl_vec.y, tl_vec.z));
+
+    LaneFlags mac_flags;
+    u32 ir_mask = 0;
+
+    // the matrix products of all vertices are independent, only the perspective division runs vertex by vertex
+    std::array<Lanes, vertex_count> mac, ir;
+    s64 z[vertex_count][4], ir_values[vertex_count][4];
+    for (u32 i = 0; i < vertex_count; i++) {
+        const Lanes rtp_vec = MultiplyLanes<checked>(rotation, *vertices[i], translation, mac_flags);
+
+        // TODO: should lm bit be ignored for IR saturation?
+
+        // the actual IR3 register is saturated if 'MAC3' exceeds -8000h..+7FFFh
+        u32 ir_rows = 0;
+        mac[i] = GteLanes::ShiftRight(rtp_vec, shift);
+        ir[i] = GteLanes::Saturate(mac[i], ir_min, 0x7FFF, ir_rows);
+
+        GteLanes::Store(rtp_vec, z[i]);
+        GteLanes::Store(ir[i], ir_values[i]);
+
+        // while the IR3 saturation flag triggers if 'MAC3 SAR 12' exceeds -8000h..+7FFFh, regardless of sf value
+        const s32 ir3 = s32(z[i][2]) >> 12;
+        ir_mask |= (ir_rows & 0b011) | (u32(ir3 < ir_min || ir3 > 0x7FFF) << 2);
+    }
+
+    for (u32 i = 0; i < vertex_count; i++) {
+        PushScreenZ(static_cast<s32>(z[i][2] >> 12));
 
-    // TODO: should lm bit be ignored for IR saturation?
+        s64 div_result = static_cast<s64>(UNRDivide(proj_plane_dist, screen_z[3]));
 
-    SetMacAndIR<1>(rtp_vec.x, shift, lm);
-    SetMacAndIR<2>(rtp_vec.y, shift, lm);
-    SetMac<3>(rtp_vec.z, shift);
+        const s64 ir1 = s16(ir_values[i][0]), ir2 = s16(ir_values[i][1]);
+        s32 screen_x = static_cast<s32>(SetMac0(div_result * ir1 + sof_x) >> 16); // SX = MAC0 / 0x10000
+        s32 screen_y = static_cast<s32>(SetMac0(div_result * ir2 + sof_y) >> 16); // SY = MAC0 / 0x10000
+        PushScreenX(screen_x);
+        PushScreenY(screen_y);
 
-    // IR3 saturation flag triggers if 'MAC3 SAR 12' exceeds -8000h..+7FFFh, regardless of sf value
-    SaturateIR<3>(s32(rtp_vec.z) >> 12, lm); // ignore the saturated output
-    // while the actual IR3 register is saturated if 'MAC3' exceeds -8000h..+7FFFh
-    ir_vec.ir3 = static_cast<s16>(std::clamp<s32>(mac_vec.mac3, lm ? 0 : -0x8000, 0x7FFF));
+        if (i == vertex_count - 1) {
+            s64 mac0_val = SetMac0(div_result * s64(depth_queue_param_A) + s64(depth_queue_param_B));
+            SetIR<0>(static_cast<s32>(mac0_val >> 12), lm);
+        }
+    }
 
-    return rtp_vec.z;
+    StoreLanes(mac[vertex_count - 1], ir[vertex_count - 1], mac_flags, ir_mask);
 }
 
-u32 GTE::UNRDivide(u32 lhs, u32 rhs) {
-    // table from https://problemkaputt.de/psx-spx.htm#gtedivisioninaccuracy
-    static const std::array<u8, 257> UNRTable {
-        0xFF,0xFD,0xFB,0xF9,0xF7,0xF5,0xF3,0xF1,0xEF,0xEE,0xEC,0xEA,0xE8,0xE6,0xE4,0xE3,
-        0xE1,0xDF,0xDD,0xDC,0xDA,0xD8,0xD6,0xD5,0xD3,0xD1,0xD0,0xCE,0xCD,0xCB,0xC9,0xC8,
-        0xC6,0xC5,0xC3,0xC1,0xC0,0xBE,0xBD,0xBB,0xBA,0xB8,0xB7,0xB5,0xB4,0xB2,0xB1,0xB0,
-        0xAE,0xAD,0xAB,0xAA,0xA9,0xA7,0xA6,0xA4,0xA3,0xA2,0xA0,0x9F,0x9E,0x9C,0x9B,0x9A, // 0x00..0x3F
-        0x99,0x97,0x96,0x95,0x94,0x92,0x91,0x90,0x8F,0x8D,0x8C,0x8B,0x8A,0x89,0x87,0x86,
-        0x85,0x84,0x83,0x82,0x81,0x7F,0x7E,0x7D,0x7C,0x7B,0x7A,0x79,0x78,0x77,0x75,0x74,
-        0x73,0x72,0x71,0x70,0x6F,0x6E,0x6D,0x6C,0x6B,0x6A,0x69,0x68,0x67,0x66,0x65,0x64,
-        0x63,0x62,0x61,0x60,0x5F,0x5E,0x5D,0x5D,0x5C,0x5B,0x5A,0x59,0x58,0x57,0x56,0x55, // 0x40..0x7F
-        0x54,0x53,0x53,0x52,0x51,0x50,0x4F,0x4E,0x4D,0x4D,0x4C,0x4B,0x4A,0x49,0x48,0x48,
-        0x47,0x46,0x45,0x44,0x43,0x43,0x42,0x41,0x40,0x3F,0x3F,0x3E,0x3D,0x3C,0x3C,0x3B,
-        0x3A,0x39,0x39,0x38,0x37,0x36,0x36,0x35,0x34,0x33,0x33,0x32,0x31,0x31,0x30,0x2F,
-        0x2E,0x2E,0x2D,0x2C,0x2C,0x2B,0x2A,0x2A,0x29,0x28,0x28,0x27,0x26,0x26,0x25,0x24, // 0x80..0xBF
-        0x24,0x23,0x22,0x22,0x21,0x20,0x20,0x1F,0x1E,0x1E,0x1D,0x1D,0x1C,0x1B,0x1B,0x1A,
-        0x19,0x19,0x18,0x18,0x17,0x16,0x16,0x15,0x15,0x14,0x14,0x13,0x12,0x12,0x11,0x11,
-        0x10,0x0F,0x0F,0x0E,0x0E,0x0D,0x0D,0x0C,0x0C,0x0B,0x0A,0x0A,0x09,0x09,0x08,0x08,
-        0x07,0x07,0x06,0x06,0x05,0x05,0x04,0x04,0x03,0x03,0x02,0x02,0x01,0x01,0x00,0x00, // 0xC0..0xFF
-        0x00 // < --one extra table entry( for "(d-7FC0h)/80h" = 100h ); -100h
-    };
+void GTE::StoreLanes(const Lanes& mac, const Lanes& ir, const LaneFlags& mac_flags, u32 ir_mask) {
+    s64 mac_values[4], ir_values[4];
+    GteLanes::Store(mac, mac_values);
+    GteLanes::Store(ir, ir_values);
+
+    mac_vec = {.mac1 = s32(mac_values[0]), .mac2 = s32(mac_values[1]), .mac3 = s32(mac_values[2])};
+    ir_vec = {.ir1 = s16(ir_values[0]), .ir2 = s16(ir_values[1]), .ir3 = s16(ir_values[2])};
 
+    lane_flag_rows |= mac_flags.over | (mac_flags.under << 3) | (ir_mask << 6);
+}
+
+void GTE::ApplyLaneFlags() {
+    error_flags.bits |= GteLanes::FlagBits(lane_flag_rows & 0b111, 30) |
+                        GteLanes::FlagBits((lane_flag_rows >> 3) & 0b111, 27) |
+                        GteLanes::FlagBits(lane_flag_rows >> 6, 24);
+    lane_flag_rows = 0;
+}
+
+// division as done by the hardware: the table holds an 8-bit reciprocal estimate of the normalized divisor,
+// two Newton-Raphson steps refine it, which reproduces the hardware rounding without an integer division
+u32 GTE::UNRDivide(u32 lhs, u32 rhs) {
     u32 result = 0;
     if (lhs < rhs * 2) {
         const u32 z = std::countl_zero(static_cast<u16>(rhs));
@@ -1084,7 +1148,7 @@ u32 GTE::UNRDivide(u32 lhs, u32 rhs) {
         u32 d = rhs << z;
         const u32 index = (d - 0x7FC0) >> 7;
 
-        const u32 u = UNRTable[index] + 0x101;
+        const u32 u = UNR_TABLE[index] + 0x101;
         d = static_cast<u32>((0x2000080 - u64(d) * u64(u)) >> 8);
         d = static_cast<u32>((0x80 + u64(d) * u64(u)) >> 8);
         result = std::min<u32>(0x1FFFF, static_cast<u32>((u64(n) * u64(d) + 0x8000) >> 16));
@@ -1098,6 +1162,7 @@ u32 GTE::UNRDivide(u32 lhs, u32 rhs) {
 
 void GTE::Reset() {
     error_flags.bits = 0;
+    lane_flag_rows = 0;
 
     vec0 = {.x = 0, .y = 0, .z = 0};
     vec1 = {.x = 0, .y = 0, .z = 0};
@@ -1,14 +1,22 @@
 #pragma once
 
+#include <type_traits>
+
 #include "gte_types.h"
 #include "util/bitfield.h"
 #include "util/types.h"
 
+namespace GteLanes {
+struct Lanes;
+struct LaneFlags;
+} // namespace GteLanes
+
 class GTE {
 public:
     void Reset();
 
-    void ExecuteCommand(u32 cmd);
+    // returns the number of cycles until the results of the command are available
+    u32 ExecuteCommand(u32 cmd);
 
     void SetReg(u32 index, u32 value);
     u32 GetReg(u32 index);
@@ -50,6 +58,10 @@ private:
         u32 bits = 0;
     } error_flags;
 
+    // Rows the lane kernels flagged during the last command: MAC overflow in bits 0-2, MAC underflow in bits 3-5
+    // and IR saturation in bits 6-8. Games rarely read FLAG, so they only get mapped to its bits by GetReg.
+    u32 lane_flag_rows = 0;
+
     union Command {
         BitField<u32, u32, 0, 6> real_opcode;
         BitField<u32, bool, 10, 1> lm;
@@ -62,6 +74,25 @@ private:
         u32 value = 0;
     };
 
+    using CommandHandler = void (*)(GTE& gte, Command cmd);
+
+    struct CommandInfo {
+        CommandHandler handler = nullptr;
+        u32 cycles = 0;
+    };
+
+    // adapts the different command signatures to CommandHandler
+    template<auto Handler>
+    static void Dispatch(GTE& gte, Command cmd) {
+        if constexpr (std::is_invocable_v<decltype(Handler), GTE&, u8, bool>) {
+            (gte.*Handler)(cmd.sf ? 12 : 0, cmd.lm);
+        } else if constexpr (std::is_invocable_v<decltype(Handler), GTE&, Command>) {
+            (gte.*Handler)(cmd);
+        } else {
+            (gte.*Handler)();
+        }
+    }
+
     struct Color32 {
         u8 r, g, b, t;
     };
@@ -76,8 +107,11 @@ private:
 
     ALWAYS_INLINE void ResetErrorFlag() {
         error_flags.bits = 0;
+        lane_flag_rows = 0;
     }
 
+    void ApplyLaneFlags();
+
     ALWAYS_INLINE void UpdateErrMasterFlag() {
         error_flags.master_error = bool(error_flags.bits & 0x7F87E000);
     }
@@ -123,7 +157,7 @@ private:
 
     void InterpolateColor(s32 mac1, s32 mac2, s32 mac3, u8 shift, bool lm);
 
-    void RTPS(const Vector3<s16>& v, u8 shift, bool lm, bool last_vertex);
+    void RTPS(u8 shift, bool lm);
     void NCLIP();
     void OP(u8 shift, bool lm);
     void DPCS(u8 shift, bool lm);
@@ -146,15 +180,26 @@ private:
     void GPL(u8 shift, bool lm);
     void NCCT(u8 shift, bool lm);
 
-    template<u32 type>
-    void NCKernel(const Vector3<s16>& v, u8 shift, bool lm);
+    // vertex_count 1 for the single commands (vector 0), 3 for the triple ones (vectors 0, 1 and 2)
+    // checked selects the MAC overflow checks, only needed for extreme translation or color vectors
+    template<u32 vertex_count, bool checked>
+    void RTPKernel(u8 shift, bool lm);
+
+    template<u32 type, u32 vertex_count, bool checked>
+    void NCKernel(u8 shift, bool lm);
+
+    // picks the NCKernel variant for the current background and far color
+    template<u32 type, u32 vertex_count>
+    void RunNCKernel(u8 shift, bool lm);
+
+    // stores MAC1-3 and IR1-3 of the last vertex and records the flags collected for all of them
+    void StoreLanes(const GteLanes::Lanes& mac, const GteLanes::Lanes& ir, const GteLanes::LaneFlags& mac_flags,
+                    u32 ir_mask);
 
     void DPCKernel(const Color32& color, u8 shift, bool lm);
 
-    MatrixMultResult MatrixMultiply(const Matrix3x3& m, const Vector3<s16>& v);
     MatrixMultResult MatrixMultiply(const Matrix3x3& m, const Vector3<s16>& v, const Vector3<s32>& t);
     void MVMVAKernelBugged(const Matrix3x3& m, const Vector3<s16>& v, const Vector3<s32>& t, u8 shift, bool lm);
-    s64 RTPKernel(const Vector3<s16>& v, u8 shift, bool lm);
 
     u32 UNRDivide(u32 lhs, u32 rhs);
 
@@ -0,0 +1,231 @@
+#pragma once
+
+#include <array>
+
+#include "util/simd.h"
+#include "util/type_util.h"
+#include "util/types.h"
+
+// Lane-parallel building blocks for the matrix kernels of the GTE.
+// A Lanes value holds the three rows of a MAC calculation (MAC1, MAC2, MAC3) as 64-bit integers, so a
+// matrix-vector product takes three multiply-accumulate steps instead of nine. After ShiftRight and Saturate only the
+// low 32 bits of a lane are valid, which is all the MAC and IR registers and the 16-bit multiplies need.
+// Instead of touching the FLAG register on every step the operations collect one bit per row that hit a limit,
+// the kernels keep those masks and FLAG bits only get built from them when the register is read.
+// With SSE2 rows 1 and 2 share one register and row 3 sits in the low half of a second one,
+// otherwise the same operations run row by row.
+namespace GteLanes {
+
+// rows that exceeded the upper or lower limit, bit 0 is row 1
+struct LaneFlags {
+    u32 over = 0;
+    u32 under = 0;
+};
+
+#ifdef USE_SSE2
+struct Lanes {
+    __m128i xy;
+    __m128i z;
+};
+
+ALWAYS_INLINE Lanes Set(s64 x, s64 y, s64 z) {
+    return {_mm_set_epi64x(y, x), _mm_set_epi64x(0, z)};
+}
+
+ALWAYS_INLINE Lanes Broadcast(s64 value) {
+    const __m128i v = _mm_set1_epi64x(value);
+    return {v, v};
+}
+
+// copies one row into all lanes
+template<u32 row>
+ALWAYS_INLINE Lanes Broadcast(const Lanes& lanes) {
+    __m128i v;
+    if constexpr (row == 0) v = _mm_unpacklo_epi64(lanes.xy, lanes.xy);
+    if constexpr (row == 1) v = _mm_unpackhi_epi64(lanes.xy, lanes.xy);
+    if constexpr (row == 2) v = _mm_unpacklo_epi64(lanes.z, lanes.z);
+    return {v, v};
+}
+
+ALWAYS_INLINE void Store(const Lanes& lanes, s64 (&values)[4]) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(values), lanes.xy);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(values + 2), lanes.z);
+}
+
+namespace detail {
+// product of the low 16 bits of every lane, sign extended to 64 bits
+ALWAYS_INLINE __m128i Multiply16(__m128i a, __m128i b) {
+    // with the upper bits cleared madd leaves the 32-bit product in the low half of every lane
+    const __m128i low16 = _mm_set1_epi64x(0xFFFF);
+    const __m128i product = _mm_madd_epi16(_mm_and_si128(a, low16), _mm_and_si128(b, low16));
+    return _mm_or_si128(product, _mm_slli_epi64(_mm_srai_epi32(product, 31), 32));
+}
+
+// sign extends the low 44 bits, SSE2 has no 64-bit arithmetic shift
+ALWAYS_INLINE __m128i SignExtend44(__m128i value) {
+    const __m128i mask = _mm_set1_epi64x((s64(1) << 44) - 1);
+    const __m128i sign = _mm_set1_epi64x(s64(1) << 43);
+    return _mm_sub_epi64(_mm_xor_si128(_mm_and_si128(value, mask), sign), sign);
+}
+
+ALWAYS_INLINE void Check44(__m128i value, __m128i extended, u32 lanes, u32 first_row, LaneFlags& flags) {
+    const __m128i equal32 = _mm_cmpeq_epi32(value, extended);
+    const __m128i equal64 = _mm_and_si128(equal32, _mm_shuffle_epi32(equal32, _MM_SHUFFLE(2, 3, 0, 1)));
+    const u32 overflow = ~u32(_mm_movemask_pd(_mm_castsi128_pd(equal64))) & lanes;
+    const u32 negative = u32(_mm_movemask_pd(_mm_castsi128_pd(value)));
+    flags.over |= (overflow & ~negative) << first_row;
+    flags.under |= (overflow & negative) << first_row;
+}
+
+ALWAYS_INLINE __m128i Saturate(__m128i value, __m128i lower, __m128i upper, u32 lanes, u32 first_row, u32& mask) {
+    const __m128i below = _mm_cmplt_epi32(value, lower);
+    const __m128i above = _mm_cmpgt_epi32(value, upper);
+    const __m128i outside = _mm_or_si128(below, above);
+
+    // only the even 32-bit elements hold lane values
+    const u32 outside_mask = u32(_mm_movemask_ps(_mm_castsi128_ps(outside)));
+    mask |= (((outside_mask & 1) | ((outside_mask >> 1) & 2)) & lanes) << first_row;
+
+    return _mm_or_si128(_mm_andnot_si128(outside, value),
+                        _mm_or_si128(_mm_and_si128(below, lower), _mm_and_si128(above, upper)));
+}
+} // namespace detail
+
+ALWAYS_INLINE Lanes Add(const Lanes& a, const Lanes& b) {
+    return {_mm_add_epi64(a.xy, b.xy), _mm_add_epi64(a.z, b.z)};
+}
+
+ALWAYS_INLINE Lanes Sub(const Lanes& a, const Lanes& b) {
+    return {_mm_sub_epi64(a.xy, b.xy), _mm_sub_epi64(a.z, b.z)};
+}
+
+template<u32 shift>
+ALWAYS_INLINE Lanes ShiftLeft(const Lanes& value) {
+    return {_mm_slli_epi64(value.xy, shift), _mm_slli_epi64(value.z, shift)};
+}
+
+// a * b for 16-bit a and b
+ALWAYS_INLINE Lanes Multiply(const Lanes& a, const Lanes& b) {
+    return {detail::Multiply16(a.xy, b.xy), detail::Multiply16(a.z, b.z)};
+}
+
+// acc + a * b for 16-bit a and b
+ALWAYS_INLINE Lanes MulAdd(const Lanes& acc, const Lanes& a, const Lanes& b) {
+    return Add(acc, Multiply(a, b));
+}
+
+// SignExtend44(acc + a * b) for 16-bit a and b, flags rows where the sum leaves the 44-bit range
+ALWAYS_INLINE Lanes MulAdd(const Lanes& acc, const Lanes& a, const Lanes& b, LaneFlags& flags) {
+    const __m128i xy = _mm_add_epi64(acc.xy, detail::Multiply16(a.xy, b.xy));
+    const __m128i z = _mm_add_epi64(acc.z, detail::Multiply16(a.z, b.z));
+    const Lanes extended = {detail::SignExtend44(xy), detail::SignExtend44(z)};
+    detail::Check44(xy, extended.xy, 0b11, 0, flags);
+    detail::Check44(z, extended.z, 0b01, 2, flags);
+    return extended;
+}
+
+// flags rows outside the 44-bit range
+ALWAYS_INLINE void Check44(const Lanes& value, LaneFlags& flags) {
+    detail::Check44(value.xy, detail::SignExtend44(value.xy), 0b11, 0, flags);
+    detail::Check44(value.z, detail::SignExtend44(value.z), 0b01, 2, flags);
+}
+
+// arithmetic shift, only the low 32 bits (the MAC register value) of the result are valid
+ALWAYS_INLINE Lanes ShiftRight(const Lanes& value, u8 shift) {
+    // the shifts are at most 12 bits, so a logical shift produces the same low 32 bits
+    const __m128i count = _mm_cvtsi32_si128(shift);
+    return {_mm_srl_epi64(value.xy, count), _mm_srl_epi64(value.z, count)};
+}
+
+// clamps the low 32 bits of every lane to min..max and sets the bits of the rows that got clamped,
+// only the low 32 bits of the result are valid
+ALWAYS_INLINE Lanes Saturate(const Lanes& value, s32 min, s32 max, u32& mask) {
+    const __m128i lower = _mm_set1_epi32(min);
+    const __m128i upper = _mm_set1_epi32(max);
+    return {detail::Saturate(value.xy, lower, upper, 0b11, 0, mask),
+            detail::Saturate(value.z, lower, upper, 0b01, 2, mask)};
+}
+#else
+struct Lanes {
+    std::array<s64, 3> value;
+};
+
+ALWAYS_INLINE Lanes Set(s64 x, s64 y, s64 z) {
+    return {{x, y, z}};
+}
+
+ALWAYS_INLINE Lanes Broadcast(s64 value) {
+    return {{value, value, value}};
+}
+
+template<u32 row>
+ALWAYS_INLINE Lanes Broadcast(const Lanes& lanes) {
+    return Broadcast(lanes.value[row]);
+}
+
+ALWAYS_INLINE void Store(const Lanes& lanes, s64 (&values)[4]) {
+    for (u32 i = 0; i < 3; i++) values[i] = lanes.value[i];
+}
+
+ALWAYS_INLINE Lanes Add(const Lanes& a, const Lanes& b) {
+    return {{a.value[0] + b.value[0], a.value[1] + b.value[1], a.value[2] + b.value[2]}};
+}
+
+ALWAYS_INLINE Lanes Sub(const Lanes& a, const Lanes& b) {
+    return {{a.value[0] - b.value[0], a.value[1] - b.value[1], a.value[2] - b.value[2]}};
+}
+
+template<u32 shift>
+ALWAYS_INLINE Lanes ShiftLeft(const Lanes& value) {
+    return {{value.value[0] << shift, value.value[1] << shift, value.value[2] << shift}};
+}
+
+ALWAYS_INLINE Lanes Multiply(const Lanes& a, const Lanes& b) {
+    Lanes result;
+    for (u32 i = 0; i < 3; i++) result.value[i] = s64(s16(a.value[i])) * s64(s16(b.value[i]));
+    return result;
+}
+
+ALWAYS_INLINE void Check44(const Lanes& value, LaneFlags& flags) {
+    for (u32 i = 0; i < 3; i++) {
+        const u32 overflow = value.value[i] != SignExtendN<44>(value.value[i]);
+        const u32 negative = value.value[i] < 0;
+        flags.over |= (overflow & ~negative) << i;
+        flags.under |= (overflow & negative) << i;
+    }
+}
+
+ALWAYS_INLINE Lanes MulAdd(const Lanes& acc, const Lanes& a, const Lanes& b) {
+    return Add(acc, Multiply(a, b));
+}
+
+ALWAYS_INLINE Lanes MulAdd(const Lanes& acc, const Lanes& a, const Lanes& b, LaneFlags& flags) {
+    const Lanes sum = Add(acc, Multiply(a, b));
+    Check44(sum, flags);
+
+    Lanes extended;
+    for (u32 i = 0; i < 3; i++) extended.value[i] = SignExtendN<44>(sum.value[i]);
+    return extended;
+}
+
+ALWAYS_INLINE Lanes ShiftRight(const Lanes& value, u8 shift) {
+    return {{value.value[0] >> shift, value.value[1] >> shift, value.value[2] >> shift}};
+}
+
+ALWAYS_INLINE Lanes Saturate(const Lanes& value, s32 min, s32 max, u32& mask) {
+    Lanes result;
+    for (u32 i = 0; i < 3; i++) {
+        const s32 v = static_cast<s32>(value.value[i]);
+        mask |= u32(v < min || v > max) << i;
+        result.value[i] = v < min ? min : (v > max ? max : v);
+    }
+    return result;
+}
+#endif
+
+// maps a row mask to the FLAG bits, row 1 uses the highest bit (MAC1, IR1, ...)
+ALWAYS_INLINE constexpr u32 FlagBits(u32 rows, u32 row1_bit) {
+    return ((rows & 1) << row1_bit) | (((rows >> 1) & 1) << (row1_bit - 1)) | (((rows >> 2) & 1) << (row1_bit - 2));
+}
+
+} // namespace GteLanes
@@ -0,0 +1,643 @@
+#include "recompiler.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#include "common/asserts.h"
+#include "common/log.h"
+#include "cpu/cpu.h"
+
+LOG_CHANNEL(Recompiler);
+
+namespace CPU {
+
+using namespace X64;
+
+namespace {
+
+#ifdef _WIN32
+constexpr Reg ARG0 = Reg::RCX;
+constexpr Reg ARG1 = Reg::RDX;
+// 32 bytes of shadow space plus alignment
+constexpr s8 STACK_RESERVE = 40;
+#else
+constexpr Reg ARG0 = Reg::RDI;
+constexpr Reg ARG1 = Reg::RSI;
+constexpr s8 STACK_RESERVE = 8;
+#endif
+
+// callee-saved host registers that can hold guest registers
+constexpr Reg CACHE_REGS[] = {Reg::RBP, Reg::R12, Reg::R13, Reg::R14, Reg::R15};
+
+bool CreatesLoadDelay(u32 value) {
+    const Instruction instr {value};
+    switch (instr.n.op) {
+        case PrimaryOpcode::lb:
+        case PrimaryOpcode::lh:
+        case PrimaryOpcode::lwl:
+        case PrimaryOpcode::lw:
+        case PrimaryOpcode::lbu:
+        case PrimaryOpcode::lhu:
+        case PrimaryOpcode::lwr:
+            return true;
+        case PrimaryOpcode::cop0:
+            return instr.cop.cop_op == CoprocessorOpcode::mf;
+        default:
+            return false;
+    }
+}
+
+bool IsStore(u32 value) {
+    const Instruction instr {value};
+    switch (instr.n.op) {
+        case PrimaryOpcode::sb:
+        case PrimaryOpcode::sh:
+        case PrimaryOpcode::swl:
+        case PrimaryOpcode::sw:
+        case PrimaryOpcode::swr:
+        case PrimaryOpcode::swc2:
+            return true;
+        default:
+            return false;
+    }
+}
+
+}    // namespace
+
+Recompiler::Recompiler(CPU* cpu) : cpu(cpu) {
+    const auto Offset = [cpu](const void* member) {
+        return static_cast<usize>(static_cast<const u8*>(member) - reinterpret_cast<const u8*>(cpu));
+    };
+
+    gp_offset = Offset(&cpu->gp.r[0]);
+    hi_offset = Offset(&cpu->sp.hi);
+    lo_offset = Offset(&cpu->sp.lo);
+    pc_offset = Offset(&cpu->sp.pc);
+    next_pc_offset = Offset(&cpu->next_pc);
+    current_pc_offset = Offset(&cpu->current_pc);
+    in_delay_slot_offset = Offset(&cpu->in_delay_slot);
+    was_in_delay_slot_offset = Offset(&cpu->was_in_delay_slot);
+    branch_taken_offset = Offset(&cpu->branch_taken);
+    was_branch_taken_offset = Offset(&cpu->was_branch_taken);
+    pending_offset = Offset(&cpu->pending_delay_entry);
+    new_entry_offset = Offset(&cpu->new_delay_entry);
+    instr_offset = Offset(&cpu->instr.value);
+    exception_raised_offset = Offset(&cpu->exception_raised);
+
+    for (usize i = 0; i < cached_regs.size(); i++) cached_regs[i].host = CACHE_REGS[i];
+
+#ifdef _WIN32
+    code_buffer = static_cast<u8*>(
+        VirtualAlloc(nullptr, CODE_BUFFER_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE));
+#else
+    void* buffer = mmap(nullptr, CODE_BUFFER_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS,
+                        -1, 0);
+    code_buffer = (buffer != MAP_FAILED) ? static_cast<u8*>(buffer) : nullptr;
+#endif
+    if (!code_buffer) LogWarn("Failed to allocate the code buffer, falling back to the interpreter");
+}
+
+Recompiler::~Recompiler() {
+    if (!code_buffer) return;
+#ifdef _WIN32
+    VirtualFree(code_buffer, 0, MEM_RELEASE);
+#else
+    munmap(code_buffer, CODE_BUFFER_SIZE);
+#endif
+}
+
+void Recompiler::ResetCodeBuffer() {
+    code_buffer_used = 0;
+    code_buffer_full = false;
+
+    LogDebug("Reset code buffer");
+}
+
+bool Recompiler::Compile(CodeBlock* block, u32 address) {
+    if (!code_buffer) return false;
+
+    // blocks that were cut off before the delay slot of their branch can't be compiled
+    const auto& instructions = block->instructions;
+    if (instructions.empty() || instructions.back().is_branch) return false;
+
+    emit.Clear();
+    exit_stubs.clear();
+    epilogue = {};
+
+    AllocateRegisters(block);
+    pending_state = PendingLoad::Unknown;
+    pending_reg = 0;
+
+    EmitPrologue();
+
+    const u32 count = static_cast<u32>(instructions.size());
+    for (u32 index = 0; index < count; index++) {
+        const bool in_delay_slot = index > 0 && instructions[index - 1].is_branch;
+        EmitInstruction(block, index, address + index * 4, in_delay_slot);
+    }
+
+    // regular block exit
+    FlushDirty();
+    if (!pc_materialized) EmitMaterializePC(address + (count - 1) * 4);
+    emit.MovMI(CpuMem(instr_offset), instructions.back().value);
+    emit.MovRI(Reg::RAX, count * CYCLES_PER_INSTRUCTION);
+
+    emit.Bind(epilogue);
+    EmitEpilogue();
+    EmitExitStubs();
+
+    const usize size = emit.Size();
+    if (code_buffer_used + size > CODE_BUFFER_SIZE) {
+        code_buffer_full = true;
+        return false;
+    }
+
+    u8* host_code = code_buffer + code_buffer_used;
+    std::memcpy(host_code, emit.Code().data(), size);
+    code_buffer_used = (code_buffer_used + size + 15) & ~static_cast<usize>(15);
+
+    block->host_code = reinterpret_cast<HostCode>(host_code);
+    block->host_code_address = address;
+    return true;
+}
+
+void Recompiler::EmitPrologue() {
+    emit.Push(Reg::RBX);
+    emit.Push(Reg::RBP);
+    emit.Push(Reg::R12);
+    emit.Push(Reg::R13);
+    emit.Push(Reg::R14);
+    emit.Push(Reg::R15);
+    emit.SubRsp(STACK_RESERVE);
+
+    emit.Mov64RR(Reg::RBX, ARG0);
+}
+
+void Recompiler::EmitEpilogue() {
+    emit.AddRsp(STACK_RESERVE);
+    emit.Pop(Reg::R15);
+    emit.Pop(Reg::R14);
+    emit.Pop(Reg::R13);
+    emit.Pop(Reg::R12);
+    emit.Pop(Reg::RBP);
+    emit.Pop(Reg::RBX);
+    emit.Ret();
+}
+
+bool Recompiler::CanInline(const DecodedInstruction& i, bool in_delay_slot) const {
+    const Instruction instr {i.value};
+
+    // clang-format off
+
+    switch (instr.n.op) {
+        case PrimaryOpcode::special:
+            switch (instr.s.sop) {
+                case SecondaryOpcode::sll: case SecondaryOpcode::srl: case SecondaryOpcode::sra:
+                case SecondaryOpcode::sllv: case SecondaryOpcode::srlv: case SecondaryOpcode::srav:
+                case SecondaryOpcode::mfhi: case SecondaryOpcode::mthi:
+                case SecondaryOpcode::mflo: case SecondaryOpcode::mtlo:
+                case SecondaryOpcode::addu: case SecondaryOpcode::subu:
+                case SecondaryOpcode::andr: case SecondaryOpcode::orr:
+                case SecondaryOpcode::xorr: case SecondaryOpcode::nor:
+                case SecondaryOpcode::slt: case SecondaryOpcode::sltu:
+                    return true;
+                default:
+                    return false;
+            }
+        // branches in delay slots are rare, the handlers deal with them
+        case PrimaryOpcode::bxxx: case PrimaryOpcode::jmp: case PrimaryOpcode::jal:
+        case PrimaryOpcode::beq: case PrimaryOpcode::bne:
+        case PrimaryOpcode::blez: case PrimaryOpcode::bgtz:
+            return !in_delay_slot;
+        case PrimaryOpcode::addiu: case PrimaryOpcode::slti: case PrimaryOpcode::sltiu:
+        case PrimaryOpcode::andi: case PrimaryOpcode::ori: case PrimaryOpcode::xori:
+        case PrimaryOpcode::lui:
+            return true;
+        default:
+            return false;
+    }
+
+    // clang-format on
+}
+
+void Recompiler::AllocateRegisters(const CodeBlock* block) {
+    std::array<u32, GP_REG_COUNT> uses = {};
+
+    const auto& instructions = block->instructions;
+    for (usize index = 0; index < instructions.size(); index++) {
+        const DecodedInstruction& i = instructions[index];
+        if (!CanInline(i, index > 0 && instructions[index - 1].is_branch)) continue;
+        uses[i.rs]++;
+        uses[i.rt]++;
+        uses[i.rd]++;
+    }
+    uses[0] = 0;
+
+    std::array<u32, GP_REG_COUNT> order = {};
+    for (u32 r = 0; r < GP_REG_COUNT; r++) order[r] = r;
+    std::stable_sort(order.begin(), order.end(), [&](u32 a, u32 b) { return uses[a] > uses[b]; });
+
+    for (usize slot = 0; slot < cached_regs.size(); slot++) {
+        CachedReg& cached = cached_regs[slot];
+        // registers that are only accessed once don't benefit from caching
+        cached.allocated = uses[order[slot]] >= 2;
+        cached.guest = order[slot];
+        cached.loaded = false;
+        cached.dirty = false;
+    }
+}
+
+void Recompiler::EmitInstruction(const CodeBlock* block, u32 index, u32 pc, bool in_delay_slot) {
+    const DecodedInstruction& i = block->instructions[index];
+
+    pc_materialized = false;
+    if (in_delay_slot) EmitDelaySlotPrologue(pc);
+
+    if (CanInline(i, in_delay_slot))
+        EmitInline(i, pc);
+    else
+        EmitHandlerCall(block, index, pc, in_delay_slot);
+
+    EmitApplyPendingLoad(i);
+}
+
+void Recompiler::EmitInline(const DecodedInstruction& i, u32 pc) {
+    const Instruction instr {i.value};
+
+    const auto Shift = [&](ShiftOp op) {
+        if (i.rd == 0) return;
+        LoadGuest(Reg::RAX, i.rt);
+        if (i.sa != 0) emit.ShiftRI(op, Reg::RAX, i.sa);
+        SetGuest(i.rd, Reg::RAX);
+    };
+    const auto ShiftVariable = [&](ShiftOp op) {
+        if (i.rd == 0) return;
+        LoadGuest(Reg::RCX, i.rs);
+        LoadGuest(Reg::RAX, i.rt);
+        emit.ShiftRCL(op, Reg::RAX);
+        SetGuest(i.rd, Reg::RAX);
+    };
+    const auto Alu = [&](AluOp op, bool invert) {
+        if (i.rd == 0) return;
+        LoadGuest(Reg::RAX, i.rs);
+        AluWithOperand(op, Reg::RAX, GetGuest(i.rt));
+        if (invert) emit.Not(Reg::RAX);
+        SetGuest(i.rd, Reg::RAX);
+    };
+    const auto SetLess = [&](Cond cond) {
+        if (i.rd == 0) return;
+        LoadGuest(Reg::RAX, i.rs);
+        AluWithOperand(AluOp::CMP, Reg::RAX, GetGuest(i.rt));
+        emit.SetCC(cond, Reg::RAX);
+        emit.MovzxRR8(Reg::RAX, Reg::RAX);
+        SetGuest(i.rd, Reg::RAX);
+    };
+    const auto AluImmediate = [&](AluOp op) {
+        if (i.rt == 0) return;
+        LoadGuest(Reg::RAX, i.rs);
+        emit.AluRI(op, Reg::RAX, i.imm);
+        SetGuest(i.rt, Reg::RAX);
+    };
+    const auto SetLessImmediate = [&](Cond cond) {
+        if (i.rt == 0) return;
+        LoadGuest(Reg::RAX, i.rs);
+        emit.AluRI(AluOp::CMP, Reg::RAX, i.imm);
+        emit.SetCC(cond, Reg::RAX);
+        emit.MovzxRR8(Reg::RAX, Reg::RAX);
+        SetGuest(i.rt, Reg::RAX);
+    };
+    const auto MoveFrom = [&](usize offset) {
+        if (i.rd == 0) return;
+        emit.MovRM(Reg::RAX, CpuMem(offset));
+        SetGuest(i.rd, Reg::RAX);
+    };
+    const auto MoveTo = [&](usize offset) {
+        LoadGuest(Reg::RAX, i.rs);
+        emit.MovMR(CpuMem(offset), Reg::RAX);
+    };
+    // expects the flags of the branch condition to be set
+    const auto Branch = [&](Cond cond) {
+        emit.SetCC(cond, Reg::RDX);
+        emit.MovRI(Reg::RAX, pc + 8);
+        emit.MovRI(Reg::RCX, pc + 4 + i.imm);
+        emit.CmovRR(cond, Reg::RAX, Reg::RCX);
+        emit.MovMR(CpuMem(next_pc_offset), Reg::RAX);
+        emit.MovM8R(CpuMem(branch_taken_offset), Reg::RDX);
+        emit.MovM8I(CpuMem(in_delay_slot_offset), 1);
+    };
+    const auto Jump = [&]() {
+        emit.MovMI(CpuMem(next_pc_offset), ((pc + 8) & 0xF0000000) | i.imm);
+        emit.MovM8I(CpuMem(branch_taken_offset), 1);
+        emit.MovM8I(CpuMem(in_delay_slot_offset), 1);
+    };
+
+    // clang-format off
+
+    switch (instr.n.op) {
+        case PrimaryOpcode::special:
+            switch (instr.s.sop) {
+                case SecondaryOpcode::sll: Shift(ShiftOp::SHL); break;
+                case SecondaryOpcode::srl: Shift(ShiftOp::SHR); break;
+                case SecondaryOpcode::sra: Shift(ShiftOp::SAR); break;
+                case SecondaryOpcode::sllv: ShiftVariable(ShiftOp::SHL); break;
+                case SecondaryOpcode::srlv: ShiftVariable(ShiftOp::SHR); break;
+                case SecondaryOpcode::srav: ShiftVariable(ShiftOp::SAR); break;
+                case SecondaryOpcode::mfhi: MoveFrom(hi_offset); break;
+                case SecondaryOpcode::mthi: MoveTo(hi_offset); break;
+                case SecondaryOpcode::mflo: MoveFrom(lo_offset); break;
+                case SecondaryOpcode::mtlo: MoveTo(lo_offset); break;
+                case SecondaryOpcode::addu: Alu(AluOp::ADD, false); break;
+                case SecondaryOpcode::subu: Alu(AluOp::SUB, false); break;
+                case SecondaryOpcode::andr: Alu(AluOp::AND, false); break;
+                case SecondaryOpcode::orr: Alu(AluOp::OR, false); break;
+                case SecondaryOpcode::xorr: Alu(AluOp::XOR, false); break;
+                case SecondaryOpcode::nor: Alu(AluOp::OR, true); break;
+                case SecondaryOpcode::slt: SetLess(Cond::L); break;
+                case SecondaryOpcode::sltu: SetLess(Cond::B); break;
+                default: Panic("Instruction 0x{:08X} can't be inlined", i.value);
+            }
+            break;
+        case PrimaryOpcode::bxxx: {
+            const bool is_bgez = instr.n.rt & 0x1;
+            const bool is_link = (instr.n.rt & 0x1E) == 0x10;
+            LoadGuest(Reg::RAX, i.rs);
+            emit.AluRI(AluOp::CMP, Reg::RAX, 0);
+            Branch(is_bgez ? Cond::GE : Cond::L);
+            if (is_link) {
+                emit.MovRI(Reg::RAX, pc + 8);
+                SetGuest(GP_Registers::RA, Reg::RAX);
+            }
+            break;
+        }
+        case PrimaryOpcode::jmp: Jump(); break;
+        case PrimaryOpcode::jal:
+            emit.MovRI(Reg::RAX, pc + 8);
+            SetGuest(GP_Registers::RA, Reg::RAX);
+            Jump();
+            break;
+        case PrimaryOpcode::beq:
+            LoadGuest(Reg::RAX, i.rs);
+            AluWithOperand(AluOp::CMP, Reg::RAX, GetGuest(i.rt));
+            Branch(Cond::E);
+            break;
+        case PrimaryOpcode::bne:
+            LoadGuest(Reg::RAX, i.rs);
+            AluWithOperand(AluOp::CMP, Reg::RAX, GetGuest(i.rt));
+            Branch(Cond::NE);
+            break;
+        case PrimaryOpcode::blez:
+            LoadGuest(Reg::RAX, i.rs);
+            emit.AluRI(AluOp::CMP, Reg::RAX, 0);
+            Branch(Cond::LE);
+            break;
+        case PrimaryOpcode::bgtz:
+            LoadGuest(Reg::RAX, i.rs);
+            emit.AluRI(AluOp::CMP, Reg::RAX, 0);
+            Branch(Cond::G);
+            break;
+        case PrimaryOpcode::addiu: AluImmediate(AluOp::ADD); break;
+        case PrimaryOpcode::slti: SetLessImmediate(Cond::L); break;
+        case PrimaryOpcode::sltiu: SetLessImmediate(Cond::B); break;
+        case PrimaryOpcode::andi: AluImmediate(AluOp::AND); break;
+        case PrimaryOpcode::ori: AluImmediate(AluOp::OR); break;
+        case PrimaryOpcode::xori: AluImmediate(AluOp::XOR); break;
+        case PrimaryOpcode::lui:
+            if (i.rt == 0) break;
+            emit.MovRI(Reg::RAX, i.imm);
+            SetGuest(i.rt, Reg::RAX);
+            break;
+        default: Panic("Instruction 0x{:08X} can't be inlined", i.value);
+    }
+
+    // clang-format on
+}
+
+void Recompiler::EmitHandlerCall(const CodeBlock* block, u32 index, u32 pc, bool in_delay_slot) {
+    const DecodedInstruction& i = block->instructions[index];
+
+    // the handlers work directly on the CPU state
+    FlushDirty();
+    if (!in_delay_slot) {
+        EmitMaterializePC(pc);
+        pc_materialized = true;
+    }
+
+    emit.Mov64RR(ARG0, Reg::RBX);
+    emit.Mov64RI(ARG1, reinterpret_cast<u64>(&i));
+    emit.Mov64RI(Reg::RAX, reinterpret_cast<u64>(i.handler));
+    emit.CallRax();
+    InvalidateCached();
+
+    // handlers are allowed to write to the zero register
+    emit.MovMI(GuestMem(0), 0);
+
+    ExitStub& stub = exit_stubs.emplace_back();
+    stub.instruction_count = index + 1;
+    stub.instruction_value = i.value;
+
+    emit.CmpM8I(CpuMem(exception_raised_offset), 0);
+    emit.Jcc(Cond::NE, stub.label);
+
+    // stores can overwrite the code of the current block
+    if (IsStore(i.value)) {
+        emit.Mov64RI(Reg::RAX, reinterpret_cast<u64>(&block->valid));
+        emit.CmpM8I({Reg::RAX}, 0);
+        emit.Jcc(Cond::E, stub.label);
+    }
+}
+
+void Recompiler::EmitDelaySlotPrologue(u32 pc) {
+    // same as the start of CPU::Step, the pc values depend on the branch outcome
+    emit.MovM8I(CpuMem(was_in_delay_slot_offset), 1);
+    emit.MovzxRM8(Reg::RAX, CpuMem(branch_taken_offset));
+    emit.MovM8R(CpuMem(was_branch_taken_offset), Reg::RAX);
+    emit.MovM8I(CpuMem(in_delay_slot_offset), 0);
+    emit.MovM8I(CpuMem(branch_taken_offset), 0);
+
+    emit.MovMI(CpuMem(current_pc_offset), pc);
+    emit.MovRM(Reg::RAX, CpuMem(next_pc_offset));
+    emit.MovMR(CpuMem(pc_offset), Reg::RAX);
+    emit.AluRI(AluOp::ADD, Reg::RAX, 4);
+    emit.MovMR(CpuMem(next_pc_offset), Reg::RAX);
+
+    pc_materialized = true;
+}
+
+void Recompiler::EmitMaterializePC(u32 pc) {
+    emit.MovMI(CpuMem(current_pc_offset), pc);
+    emit.MovMI(CpuMem(pc_offset), pc + 4);
+    emit.MovMI(CpuMem(next_pc_offset), pc + 8);
+}
+
+void Recompiler::EmitApplyPendingLoad(const DecodedInstruction& i) {
+    const Mem pending_reg_mem = CpuMem(pending_offset);
+    const Mem pending_value_mem = CpuMem(pending_offset + 4);
+
+    switch (pending_state) {
+        case PendingLoad::None:
+            break;
+        case PendingLoad::Known: {
+            // the entry either targets pending_reg or was cancelled by a write to the same register
+            if (pending_reg == 0) break;
+
+            if (CachedReg* cached = FindCached(pending_reg)) {
+                if (!cached->loaded) {
+                    emit.MovRM(cached->host, GuestMem(pending_reg));
+                    cached->loaded = true;
+                }
+                emit.AluMI(AluOp::CMP, pending_reg_mem, pending_reg);
+                emit.CmovRM(Cond::E, cached->host, pending_value_mem);
+                cached->dirty = true;
+            } else {
+                Label skip;
+                emit.AluMI(AluOp::CMP, pending_reg_mem, pending_reg);
+                emit.Jcc(Cond::NE, skip);
+                emit.MovRM(Reg::RAX, pending_value_mem);
+                emit.MovMR(GuestMem(pending_reg), Reg::RAX);
+                emit.Bind(skip);
+            }
+            break;
+        }
+        case PendingLoad::Unknown:
+            FlushDirty();
+            EmitGenericApplyPendingLoad();
+            InvalidateCached();
+            break;
+    }
+
+    if (CreatesLoadDelay(i.value)) {
+        emit.Mov64RM(Reg::RAX, CpuMem(new_entry_offset));
+        emit.Mov64MR(CpuMem(pending_offset), Reg::RAX);
+        emit.Mov64MI(CpuMem(new_entry_offset), 0);
+        pending_state = PendingLoad::Known;
+        pending_reg = i.rt;
+    } else {
+        if (pending_state != PendingLoad::None) emit.Mov64MI(CpuMem(pending_offset), 0);
+        pending_state = PendingLoad::None;
+    }
+}
+
+void Recompiler::EmitGenericApplyPendingLoad() {
+    emit.MovRM(Reg::RAX, CpuMem(pending_offset));
+    emit.MovRM(Reg::RCX, CpuMem(pending_offset + 4));
+    emit.MovMR({Reg::RBX, static_cast<s32>(gp_offset), true, Reg::RAX}, Reg::RCX);
+    emit.MovMI(GuestMem(0), 0);
+}
+
+void Recompiler::EmitExitStubs() {
+    for (ExitStub& stub : exit_stubs) {
+        emit.Bind(stub.label);
+
+        // finish the delay entry update of the interrupted instruction
+        EmitGenericApplyPendingLoad();
+        emit.Mov64RM(Reg::RAX, CpuMem(new_entry_offset));
+        emit.Mov64MR(CpuMem(pending_offset), Reg::RAX);
+        emit.Mov64MI(CpuMem(new_entry_offset), 0);
+
+        emit.MovMI(CpuMem(instr_offset), stub.instruction_value);
+        emit.MovRI(Reg::RAX, stub.instruction_count * CYCLES_PER_INSTRUCTION);
+        emit.Jmp(epilogue);
+    }
+}
+
+Recompiler::CachedReg* Recompiler::FindCached(u32 guest) {
+    if (guest == 0) return nullptr;
+    for (auto& cached : cached_regs) {
+        if (cached.allocated && cached.guest == guest) return &cached;
+    }
+    return nullptr;
+}
+
+Recompiler::Operand Recompiler::GetGuest(u32 guest) {
+    if (guest == 0) return {Operand::Type::Zero};
+
+    if (CachedReg* cached = FindCached(guest)) {
+        if (!cached->loaded) {
+            emit.MovRM(cached->host, GuestMem(guest));
+            cached->loaded = true;
+        }
+        return {Operand::Type::Reg, cached->host};
+    }
+
+    return {Operand::Type::Mem, Reg::RAX, GuestMem(guest)};
+}
+
+void Recompiler::LoadGuest(Reg dst, u32 guest) {
+    const Operand operand = GetGuest(guest);
+    switch (operand.type) {
+        case Operand::Type::Zero: emit.MovRI(dst, 0); break;
+        case Operand::Type::Reg: emit.MovRR(dst, operand.reg); break;
+        case Operand::Type::Mem: emit.MovRM(dst, operand.mem); break;
+    }
+}
+
+void Recompiler::SetGuest(u32 guest, Reg src) {
+    if (guest == 0) return;
+
+    CancelPendingLoad(guest);
+
+    if (CachedReg* cached = FindCached(guest)) {
+        emit.MovRR(cached->host, src);
+        cached->loaded = true;
+        cached->dirty = true;
+    } else {
+        emit.MovMR(GuestMem(guest), src);
+    }
+}
+
+void Recompiler::CancelPendingLoad(u32 guest) {
+    // mirrors CPU::Set, doesn't touch the flags if the outcome is known at compile time
+    switch (pending_state) {
+        case PendingLoad::None:
+            break;
+        case PendingLoad::Known:
+            if (pending_reg == guest) {
+                emit.Mov64MI(CpuMem(pending_offset), 0);
+                pending_reg = 0;
+            }
+            break;
+        case PendingLoad::Unknown: {
+            Label skip;
+            emit.AluMI(AluOp::CMP, CpuMem(pending_offset), guest);
+            emit.Jcc(Cond::NE, skip);
+            emit.Mov64MI(CpuMem(pending_offset), 0);
+            emit.Bind(skip);
+            break;
+        }
+    }
+}
+
+void Recompiler::FlushDirty() {
+    for (auto& cached : cached_regs) {
+        if (!cached.dirty) continue;
+        emit.MovMR(GuestMem(cached.guest), cached.host);
+        cached.dirty = false;
+    }
+}
+
+void Recompiler::InvalidateCached() {
+    for (auto& cached : cached_regs) {
+        DebugAssert(!cached.dirty);
+        cached.loaded = false;
+    }
+}
+
+Mem Recompiler::GuestMem(u32 guest) const {
+    return CpuMem(gp_offset + guest * 4);
+}
+
+void Recompiler::AluWithOperand(AluOp op, Reg dst, const Operand& operand) {
+    switch (operand.type) {
+        case Operand::Type::Zero: emit.AluRI(op, dst, 0); break;
+        case Operand::Type::Reg: emit.AluRR(op, dst, operand.reg); break;
+        case Operand::Type::Mem: emit.AluRM(op, dst, operand.mem); break;
+    }
+}
+
+}    // namespace CPU
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include "cpu/code_cache.h"
+#include "util/types.h"
+#include "x64_emitter.h"
+
+namespace CPU {
+
+class CPU;
+
+// Translates decoded blocks into x86-64 code.
+// Simple ALU and branch instructions are emitted inline, everything else calls the interpreter handlers.
+// Frequently used guest registers are kept in callee-saved host registers for the duration of a block.
+class Recompiler {
+public:
+    explicit Recompiler(CPU* cpu);
+    ~Recompiler();
+
+    // compiles the block for the given virtual start address and stores the host code in the block
+    // returns false if the block can't be compiled or the code buffer is full
+    bool Compile(CodeBlock* block, u32 address);
+
+    // invalidates all previously compiled code, all blocks have to be flushed first
+    void ResetCodeBuffer();
+
+    bool CodeBufferFull() const { return code_buffer_full; }
+
+private:
+    // state of a host register that caches a guest register
+    struct CachedReg {
+        X64::Reg host;
+        u32 guest = 0;
+        bool allocated = false;
+        bool loaded = false;
+        bool dirty = false;
+    };
+
+    // what the compiler knows about the pending load delay entry at the start of an instruction
+    enum class PendingLoad {
+        None,       // no load in flight
+        Known,      // either the pending register or cancelled (reg 0)
+        Unknown,    // left over from the previous block
+    };
+
+    struct Operand {
+        enum class Type { Zero, Reg, Mem } type;
+        X64::Reg reg = X64::Reg::RAX;
+        X64::Mem mem = {X64::Reg::RBX};
+    };
+
+    void EmitPrologue();
+    void EmitEpilogue();
+
+    bool CanInline(const DecodedInstruction& i, bool in_delay_slot) const;
+    void AllocateRegisters(const CodeBlock* block);
+
+    void EmitInstruction(const CodeBlock* block, u32 index, u32 pc, bool in_delay_slot);
+    void EmitInline(const DecodedInstruction& i, u32 pc);
+    void EmitHandlerCall(const CodeBlock* block, u32 index, u32 pc, bool in_delay_slot);
+    void EmitDelaySlotPrologue(u32 pc);
+    void EmitMaterializePC(u32 pc);
+    void EmitApplyPendingLoad(const DecodedInstruction& i);
+    void EmitGenericApplyPendingLoad();
+    void EmitExitStubs();
+
+    // guest register access
+    CachedReg* FindCached(u32 guest);
+    Operand GetGuest(u32 guest);
+    void LoadGuest(X64::Reg dst, u32 guest);
+    void SetGuest(u32 guest, X64::Reg src);
+    void CancelPendingLoad(u32 guest);
+    void FlushDirty();
+    void InvalidateCached();
+
+    X64::Mem GuestMem(u32 guest) const;
+    X64::Mem CpuMem(usize offset) const { return {X64::Reg::RBX, static_cast<s32>(offset)}; }
+
+    void AluWithOperand(X64::AluOp op, X64::Reg dst, const Operand& operand);
+
+    CPU* cpu = nullptr;
+    X64::Emitter emit;
+
+    std::array<CachedReg, 5> cached_regs = {};
+
+    PendingLoad pending_state = PendingLoad::Unknown;
+    u32 pending_reg = 0;
+    bool pc_materialized = false;
+
+    // exit paths taken after an instruction raised an exception or invalidated the current block
+    struct ExitStub {
+        X64::Label label;
+        u32 instruction_count = 0;
+        u32 instruction_value = 0;
+    };
+    std::vector<ExitStub> exit_stubs;
+    X64::Label epilogue;
+
+    // offsets of the CPU members accessed by the generated code
+    usize gp_offset = 0, hi_offset = 0, lo_offset = 0, pc_offset = 0;
+    usize next_pc_offset = 0, current_pc_offset = 0;
+    usize in_delay_slot_offset = 0, was_in_delay_slot_offset = 0;
+    usize branch_taken_offset = 0, was_branch_taken_offset = 0;
+    usize pending_offset = 0, new_entry_offset = 0;
+    usize instr_offset = 0, exception_raised_offset = 0;
+
+    u8* code_buffer = nullptr;
+    usize code_buffer_used = 0;
+    bool code_buffer_full = false;
+
+    static constexpr usize CODE_BUFFER_SIZE = 32 * 1024 * 1024;
+};
+
+}    // namespace CPU
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <vector>
+
+#include "util/types.h"
+
+namespace CPU::X64 {
+
+// clang-format off
+enum class Reg : u8 {
+    RAX = 0, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+    R8, R9, R10, R11, R12, R13, R14, R15,
+};
+
+enum class Cond : u8 {
+    O = 0x0, NO = 0x1, B = 0x2, AE = 0x3, E = 0x4, NE = 0x5, BE = 0x6, A = 0x7,
+    S = 0x8, NS = 0x9, L = 0xC, GE = 0xD, LE = 0xE, G = 0xF,
+};
+
+enum class AluOp : u8 {
+    ADD = 0, OR = 1, AND = 4, SUB = 5, XOR = 6, CMP = 7,
+};
+
+enum class ShiftOp : u8 {
+    SHL = 4, SHR = 5, SAR = 7,
+};
+// clang-format on
+
+// [base + index * 4 + disp]
+struct Mem {
+    Reg base;
+    s32 disp = 0;
+    bool has_index = false;
+    Reg index = Reg::RAX;
+};
+
+struct Label {
+    s64 position = -1;
+    std::vector<usize> patch_sites;
+};
+
+// Minimal x86-64 machine code emitter, only supports the instruction forms used by the recompiler.
+// Unless the name says otherwise all register operands are 32 bit.
+class Emitter {
+public:
+    const std::vector<u8>& Code() const { return code; }
+    usize Size() const { return code.size(); }
+    void Clear() { code.clear(); }
+
+    void MovRR(Reg dst, Reg src) { Rex(false, src, dst); Byte(0x89); ModRM(src, dst); }
+    void MovRM(Reg dst, Mem mem) { Rex(false, dst, mem); Byte(0x8B); ModRM(dst, mem); }
+    void MovMR(Mem mem, Reg src) { Rex(false, src, mem); Byte(0x89); ModRM(src, mem); }
+    void MovRI(Reg dst, u32 imm) { Rex(false, Reg::RAX, dst); Byte(0xB8 + (Idx(dst) & 7)); Dword(imm); }
+    void MovMI(Mem mem, u32 imm) { Rex(false, Reg::RAX, mem); Byte(0xC7); ModRM(0, mem); Dword(imm); }
+    void MovM8I(Mem mem, u8 imm) { Rex(false, Reg::RAX, mem); Byte(0xC6); ModRM(0, mem); Byte(imm); }
+    // only supports AL, CL, DL and BL as source
+    void MovM8R(Mem mem, Reg src) { Rex(false, src, mem); Byte(0x88); ModRM(src, mem); }
+    void MovzxRM8(Reg dst, Mem mem) { Rex(false, dst, mem); Byte(0x0F); Byte(0xB6); ModRM(dst, mem); }
+    // only supports AL, CL, DL and BL as source
+    void MovzxRR8(Reg dst, Reg src) { Rex(false, dst, src); Byte(0x0F); Byte(0xB6); ModRM(dst, src); }
+
+    void Mov64RR(Reg dst, Reg src) { Rex(true, src, dst); Byte(0x89); ModRM(src, dst); }
+    void Mov64RM(Reg dst, Mem mem) { Rex(true, dst, mem); Byte(0x8B); ModRM(dst, mem); }
+    void Mov64MR(Mem mem, Reg src) { Rex(true, src, mem); Byte(0x89); ModRM(src, mem); }
+    void Mov64MI(Mem mem, s32 imm) { Rex(true, Reg::RAX, mem); Byte(0xC7); ModRM(0, mem); Dword(static_cast<u32>(imm)); }
+    void Mov64RI(Reg dst, u64 imm) { Rex(true, Reg::RAX, dst); Byte(0xB8 + (Idx(dst) & 7)); Qword(imm); }
+
+    void AluRR(AluOp op, Reg dst, Reg src) { Rex(false, src, dst); Byte(Op(op) * 8 + 0x01); ModRM(src, dst); }
+    void AluRM(AluOp op, Reg dst, Mem mem) { Rex(false, dst, mem); Byte(Op(op) * 8 + 0x03); ModRM(dst, mem); }
+    void AluRI(AluOp op, Reg dst, u32 imm) { Rex(false, Reg::RAX, dst); Byte(0x81); ModRM(Op(op), dst); Dword(imm); }
+    void AluMI(AluOp op, Mem mem, u32 imm) { Rex(false, Reg::RAX, mem); Byte(0x81); ModRM(Op(op), mem); Dword(imm); }
+    void CmpM8I(Mem mem, u8 imm) { Rex(false, Reg::RAX, mem); Byte(0x80); ModRM(7, mem); Byte(imm); }
+    void TestRR(Reg a, Reg b) { Rex(false, b, a); Byte(0x85); ModRM(b, a); }
+    void Not(Reg reg) { Rex(false, Reg::RAX, reg); Byte(0xF7); ModRM(2, reg); }
+
+    void ShiftRI(ShiftOp op, Reg reg, u8 amount) {
+        Rex(false, Reg::RAX, reg);
+        Byte(0xC1);
+        ModRM(static_cast<u8>(op), reg);
+        Byte(amount);
+    }
+    void ShiftRCL(ShiftOp op, Reg reg) { Rex(false, Reg::RAX, reg); Byte(0xD3); ModRM(static_cast<u8>(op), reg); }
+
+    // only supports AL, CL, DL and BL as destination
+    void SetCC(Cond cond, Reg dst) { Rex(false, Reg::RAX, dst); Byte(0x0F); Byte(0x90 + Cc(cond)); ModRM(0, dst); }
+    void CmovRR(Cond cond, Reg dst, Reg src) { Rex(false, dst, src); Byte(0x0F); Byte(0x40 + Cc(cond)); ModRM(dst, src); }
+    void CmovRM(Cond cond, Reg dst, Mem mem) { Rex(false, dst, mem); Byte(0x0F); Byte(0x40 + Cc(cond)); ModRM(dst, mem); }
+
+    void Push(Reg reg) { if (Idx(reg) >= 8) Byte(0x41); Byte(0x50 + (Idx(reg) & 7)); }
+    void Pop(Reg reg) { if (Idx(reg) >= 8) Byte(0x41); Byte(0x58 + (Idx(reg) & 7)); }
+    void AddRsp(s8 imm) { Byte(0x48); Byte(0x83); Byte(0xC4); Byte(static_cast<u8>(imm)); }
+    void SubRsp(s8 imm) { Byte(0x48); Byte(0x83); Byte(0xEC); Byte(static_cast<u8>(imm)); }
+    void CallRax() { Byte(0xFF); Byte(0xD0); }
+    void Ret() { Byte(0xC3); }
+
+    void Jcc(Cond cond, Label& label) { Byte(0x0F); Byte(0x80 + Cc(cond)); LabelRef(label); }
+    void Jmp(Label& label) { Byte(0xE9); LabelRef(label); }
+
+    void Bind(Label& label) {
+        label.position = static_cast<s64>(code.size());
+        for (usize site : label.patch_sites) PatchRel32(site, label.position);
+        label.patch_sites.clear();
+    }
+
+private:
+    static u8 Idx(Reg reg) { return static_cast<u8>(reg); }
+    static u8 Op(AluOp op) { return static_cast<u8>(op); }
+    static u8 Cc(Cond cond) { return static_cast<u8>(cond); }
+
+    void Byte(u8 value) { code.push_back(value); }
+    void Dword(u32 value) {
+        for (u32 i = 0; i < 4; i++) Byte(static_cast<u8>(value >> (i * 8)));
+    }
+    void Qword(u64 value) {
+        for (u32 i = 0; i < 8; i++) Byte(static_cast<u8>(value >> (i * 8)));
+    }
+
+    void Rex(bool w, Reg reg, Reg rm) {
+        const u8 rex = 0x40 | (w << 3) | ((Idx(reg) >> 3) << 2) | (Idx(rm) >> 3);
+        if (rex != 0x40) Byte(rex);
+    }
+    void Rex(bool w, Reg reg, const Mem& mem) {
+        const u8 x = mem.has_index ? (Idx(mem.index) >> 3) : 0;
+        const u8 rex = 0x40 | (w << 3) | ((Idx(reg) >> 3) << 2) | (x << 1) | (Idx(mem.base) >> 3);
+        if (rex != 0x40) Byte(rex);
+    }
+
+    void ModRM(Reg reg, Reg rm) { ModRM(Idx(reg), rm); }
+    void ModRM(u8 reg, Reg rm) { Byte(0xC0 | ((reg & 7) << 3) | (Idx(rm) & 7)); }
+    void ModRM(Reg reg, const Mem& mem) { ModRM(Idx(reg), mem); }
+    void ModRM(u8 reg, const Mem& mem) {
+        // always use a 32 bit displacement, keeps the encoding simple
+        if (mem.has_index) {
+            Byte(0x80 | ((reg & 7) << 3) | 0x4);
+            Byte((2 << 6) | ((Idx(mem.index) & 7) << 3) | (Idx(mem.base) & 7));
+        } else {
+            Byte(0x80 | ((reg & 7) << 3) | (Idx(mem.base) & 7));
+            // RSP and R12 as base register require a SIB byte
+            if ((Idx(mem.base) & 7) == 4) Byte(0x24);
+        }
+        Dword(static_cast<u32>(mem.disp));
+    }
+
+    void LabelRef(Label& label) {
+        const usize site = code.size();
+        Dword(0);
+        if (label.position >= 0)
+            PatchRel32(site, label.position);
+        else
+            label.patch_sites.push_back(site);
+    }
+
+    void PatchRel32(usize site, s64 target) {
+        const u32 rel = static_cast<u32>(static_cast<s32>(target - static_cast<s64>(site + 4)));
+        for (u32 i = 0; i < 4; i++) code[site + i] = static_cast<u8>(rel >> (i * 8));
+    }
+
+    std::vector<u8> code;
+};
+
+}    // namespace CPU::X64
@@ -2,6 +2,7 @@
 
 #include <array>
 #include <unordered_map>
+#include <vector>
 
 #include "util/types.h"
 
@@ -9,6 +10,25 @@ class System;
 
 class Debugger {
 public:
+    struct Breakpoint {
+        bool enabled = true;
+    };
+    struct Watchpoint {
+        enum Type { ENABLED, ONLY_LOAD, ONLY_STORE, DISABLED };
+        Type type = ENABLED;
+        const char* TypeToString() const {
+            switch (type) {
+                case ENABLED: return "ENABLED";
+                case ONLY_LOAD: return "ON_LOAD";
+                case ONLY_STORE: return "ON_STORE";
+                case DISABLED: return "DISABLED";
+            }
+            return "XXX";
+        }
+
+        Watchpoint(Type type) : type(type) {}
+    };
+
     ALWAYS_INLINE bool IsBreakpoint(u32 address) {
         if (!breakpoints.empty() && breakpoints.count(address)) [[unlikely]] return true;
         else return false;
@@ -16,6 +36,8 @@ public:
 
     ALWAYS_INLINE bool IsBreakpointEnabled(u32 address) { return breakpoints.find(address)->second.enabled; }
 
+    ALWAYS_INLINE bool HasBreakpoints() const { return !breakpoints.empty(); }
+
     ALWAYS_INLINE bool IsWatchpoint(u32 address) {
         if (!watchpoints.empty() && watchpoints.count(address)) [[unlikely]] return true;
         else return false;
@@ -37,13 +59,21 @@ public:
     }
 
     Debugger(System* system);
-    void DrawDebugger(bool* open);
     void Reset();
 
     void AddBreakpoint(u32 address);
     void RemoveBreakpoint(u32 address);
     void ToggleBreakpoint(u32 address);
 
+    void AddWatchpoint(u32 address, Watchpoint::Type type);
+    void RemoveWatchpoint(u32 address);
+
+    const std::unordered_map<u32, Breakpoint>& GetBreakpoints() const { return breakpoints; }
+    const std::unordered_map<u32, Watchpoint>& GetWatchpoints() const { return watchpoints; }
+
+    // (address, value) pairs of the most recently executed instructions, oldest first
+    std::vector<std::pair<u32, u32>> GetLastInstructions() const;
+
     void SetPausedState(bool paused, bool single_step);
 
     System* GetContext();
@@ -54,26 +84,7 @@ public:
     bool show_disasm_view = false;
 
 private:
-    struct Breakpoint {
-        bool enabled = true;
-    };
     std::unordered_map<u32, Breakpoint> breakpoints;
-
-    struct Watchpoint {
-        enum Type { ENABLED, ONLY_LOAD, ONLY_STORE, DISABLED };
-        Type type = ENABLED;
-        const char* TypeToString() {
-            switch (type) {
-                case ENABLED: return "ENABLED";
-                case ONLY_LOAD: return "ON_LOAD";
-                case ONLY_STORE: return "ON_STORE";
-                case DISABLED: return "DISABLED";
-            }
-            return "XXX";
-        }
-
-        Watchpoint(Type type) : type(type) {}
-    };
     std::unordered_map<u32, Watchpoint> watchpoints;
 
     static constexpr u32 BUFFER_SIZE = 128;
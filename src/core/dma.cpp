@@ -1,5 +1,7 @@
 #include "dma.h"
 
+#include <algorithm>
+
 #include "bus.h"
 #include "common/asserts.h"
 #include "common/log.h"
@@ -9,7 +11,9 @@
 
 LOG_CHANNEL(DMA);
 
-DMA::DMA(System* system) : sys(system) {}
+DMA::DMA(System* system) : sys(system) {
+    cycles_until_next_chunk = MaxCycles;
+}
 
 u32 DMA::Load(u32 address) {
 #if 0
@@ -43,7 +47,10 @@ void DMA::Store(u32 address, u32 value) {
 #endif
 
     if (address == 0x70) {
+        sys->ForceUpdateComponents();
         control.value = value;
+        // a channel might have been waiting for its enable bit
+        UpdateTransfers();
         return;
     }
     if (address == 0x74) {
@@ -66,29 +73,124 @@ void DMA::Store(u32 address, u32 value) {
         return;
     }
     if (channel_address == 0x8) {
-        channel[channel_index].control.value = value;
-        if (channel[channel_index].ready()) StartTransfer(channel_index);
+        sys->ForceUpdateComponents();
+
+        auto& ch = channel[channel_index];
+        ch.control.value = value;
+        // clearing the busy bit stops a running transfer
+        if (!ch.control.start_busy) ch.running = false;
+        else if (ch.ready() && !ch.running) StartTransfer(channel_index);
+
+        UpdateTransfers();
         return;
     }
 
     Panic("Invalid DMA register");
 }
 
+void DMA::Step(u32 cycles) {
+    if (cycles_until_next_chunk == MaxCycles) return;
+
+    DebugAssert(cycles_until_next_chunk >= cycles);
+    cycles_until_next_chunk -= cycles;
+
+    if (cycles_until_next_chunk == 0) sys->StallCpu(RunTransfers());
+}
+
+u32 DMA::CyclesUntilNextEvent() const {
+    return cycles_until_next_chunk;
+}
+
 void DMA::StartTransfer(u32 index) {
-    //auto dir = static_cast<Direction>(channel[index].control.transfer_direction);
-    // TODO: write a better log message
-    //LOG_DEBUG << fmt::format("Starting DMA transfer to {} on channel {} in mode {} starting at address 0x{:08X}",
-    //       (dir == Direction::ToRAM) ? "RAM" : "device", index,
-    //       (u32)channel[index].control.sync_mode.GetValue(), channel[index].base_address);
-    // TODO: chopping and priority handling
+    auto& ch = channel[index];
+    auto channel_type = static_cast<DMA_Channel>(index);
+
+    ch.running = true;
+    // the trigger only starts the transfer, the busy bit stays set until it is done
+    ch.control.start_trigger = false;
+    ch.address = ch.base_address;
 
-    switch (channel[index].control.sync_mode) {
-        case SyncMode::LinkedList: TransferLinkedList(index); break;
-        case SyncMode::Manual:
-        case SyncMode::Request: TransferBlock(index); break;
+    switch (ch.control.sync_mode) {
+        case SyncMode::Manual: ch.words_left = (ch.bcr.word_count == 0) ? 0x10000 : ch.bcr.word_count; break;
+        case SyncMode::Request:
+            ch.words_left = ch.bcr.block_count * ch.bcr.block_size;
+            if (channel_type == DMA_Channel::GPU && ch.control.transfer_direction == Direction::ToDevice)
+                LogDebug("Possible start of CopyImageToVRAM with size {}", ch.words_left);
+            break;
+        case SyncMode::LinkedList:
+            if (channel_type != DMA_Channel::GPU || ch.control.transfer_direction == Direction::ToRAM)
+                Panic("DMA linked list mode only available for GPU channel in ToDevice mode");
+            break;
     }
+}
+
+void DMA::UpdateTransfers() {
+    if (cycles_until_next_chunk != MaxCycles) return;
+
+    const u32 stall_cycles = RunTransfers();
+    sys->Schedule(System::TimedEvent::DMA, CyclesUntilNextEvent());
+    sys->StallCpu(stall_cycles);
+}
+
+u32 DMA::NextChannel() const {
+    u32 next = CHANNEL_COUNT;
+    u32 next_priority = 0;
+
+    for (u32 index = 0; index < CHANNEL_COUNT; index++) {
+        // every channel has 3 priority bits and an enable bit in the control register
+        const u32 bits = (control.value >> (index * 4)) & 0xF;
+        if (!channel[index].running || !(bits & 0x8)) continue;
+
+        // lower values win, on a tie the higher channel wins
+        if (next == CHANNEL_COUNT || (bits & 0x7) <= next_priority) {
+            next = index;
+            next_priority = bits & 0x7;
+        }
+    }
+    return next;
+}
+
+static u32 CyclesForTransfer(u32 channel_index, u32 count) {
+    // https://psx-spx.consoledev.net/dmachannels/#dma-transfer-rates
+    switch (channel_index) {
+        case 3: return (count * 0x2800) / 0x100;
+        case 4: return (count * 0x0420) / 0x100;
+        default: return (count * 0x0110) / 0x100;
+    }
+}
+
+u32 DMA::RunTransfers() {
+    Profiler::Scope scope(*sys->profiler, Profiler::Category::DMA);
+
+    // the transfer is over once the time for its last chunk has passed
+    if (chunk_finishes_transfer && channel[chunk_channel].running) FinishTransfer(chunk_channel);
+
+    chunk_channel = NextChannel();
+    chunk_finishes_transfer = false;
+    if (chunk_channel == CHANNEL_COUNT) {
+        cycles_until_next_chunk = MaxCycles;
+        return 0;
+    }
+
+    auto& ch = channel[chunk_channel];
+    const u32 words =
+        (ch.control.sync_mode == SyncMode::LinkedList) ? TransferLinkedList(chunk_channel) : TransferBlock(chunk_channel);
+
+    const u32 cycles = std::max(CyclesForTransfer(chunk_channel, words), 1u);
+    cycles_until_next_chunk = cycles;
+
+    // with chopping the CPU gets the bus back for a while after every chunk
+    if (ch.control.chopping_enable && ch.control.sync_mode == SyncMode::Manual && !chunk_finishes_transfer)
+        cycles_until_next_chunk += 1u << ch.control.chopping_cpu_win_size;
+
+    return cycles;
+}
+
+void DMA::FinishTransfer(u32 index) {
+    auto& ch = channel[index];
+    ch.running = false;
+    ch.control.start_busy = false;
 
-    // transfer is over
     // set corresponding irq flag if enabled
     if (interrupt.irq_master_enable && (interrupt.irq_enable & (1u << index))) {
         interrupt.irq_flag |= 1u << index;
@@ -98,44 +200,52 @@ void DMA::StartTransfer(u32 index) {
     bool previous_state = interrupt.irq_master_flag;
     UpdateMasterFlag();
     if (interrupt.irq_master_flag && !previous_state) {
-        // TODO: don't do this immediately?
         sys->interrupt->Request(IRQ::DMA);
     }
 }
 
-static u32 CyclesForTransfer(u32 channel_index, u32 count) {
-    // https://psx-spx.consoledev.net/dmachannels/#dma-transfer-rates
-    switch (channel_index) {
-        case 3: return (count * 0x2800) / 0x100;
-        case 4: return (count * 0x0420) / 0x100;
-        default: return (count * 0x0110) / 0x100;
+u32 DMA::TransferBlock(u32 index) {
+    auto& ch = channel[index];
+    const u32 block_size = ch.bcr.block_size;
+
+    u32 count = std::min(ch.words_left, CHUNK_WORDS);
+    if (ch.control.sync_mode == SyncMode::Manual && ch.control.chopping_enable) {
+        count = std::min(ch.words_left, 1u << ch.control.chopping_dma_win_size);
+    } else if (ch.control.sync_mode == SyncMode::Request && block_size != 0) {
+        // request mode only moves whole blocks
+        count = std::min(ch.words_left, std::max(CHUNK_WORDS / block_size, 1u) * block_size);
     }
-}
 
-void DMA::TransferBlock(u32 index) {
-    auto& ch = channel[index];
-    auto channel_type = static_cast<DMA_Channel>(index);
-    s32 step = (ch.control.mem_address_step == Step::Inc) ? 4 : -4;
+    TransferWords(index, ch.address, count, ch.words_left);
 
-    u32 transfer_count = 0;
-    switch (ch.control.sync_mode) {
-        case SyncMode::Manual: transfer_count = (ch.bcr.word_count == 0) ? 0x10000 : ch.bcr.word_count; break;
-        case SyncMode::Request:
-            transfer_count = ch.bcr.block_count * ch.bcr.block_size;
-            if (index == 2 && ch.control.transfer_direction == Direction::ToDevice)
-                LogDebug("Possible start of CopyImageToVRAM with size {}", transfer_count);
-            break;
-        case SyncMode::LinkedList: Panic("This should never be reached");
+    const s32 step = (ch.control.mem_address_step == AddressStep::Inc) ? 4 : -4;
+    ch.address += step * s32(count);
+    ch.words_left -= count;
+
+    // unlike manual mode request mode keeps the registers up to date
+    if (ch.control.sync_mode == SyncMode::Request && block_size != 0) {
+        ch.base_address = ch.address & 0xFF'FFFF;
+        ch.bcr.block_count = ch.words_left / block_size;
     }
 
-    const u32 total_word_count = transfer_count;
+    chunk_finishes_transfer = ch.words_left == 0;
+    return count;
+}
 
-    // TODO: decrement block_count
-    // TODO: decrement MADR in Request and LinkedList mode
-    u32 addr = ch.base_address;
+void DMA::TransferWords(u32 index, u32 addr, u32 count, u32 words_left) {
+    auto& ch = channel[index];
+    auto channel_type = static_cast<DMA_Channel>(index);
+    s32 step = (ch.control.mem_address_step == AddressStep::Inc) ? 4 : -4;
     u32 data = 0;
 
-    while (transfer_count > 0) {
+    // GPU uploads are handed over straight from RAM, only the rare decrementing transfers go word by word
+    if (channel_type == DMA_Channel::GPU && ch.control.transfer_direction == Direction::ToDevice &&
+        ch.control.mem_address_step == AddressStep::Inc) {
+        SendToGpu(addr & ADDR_MASK, count);
+        return;
+    }
+
+    for (u32 i = 0; i < count; i++) {
         // align and wrap the address
         u32 curr_addr = addr & ADDR_MASK;
 
@@ -153,7 +263,7 @@ void DMA::TransferBlock(u32 index) {
                         // read next 32-bit packet
                         data = sys->gpu->gpu_read;
                         break;
-                    case DMA_Channel::OTC: data = (transfer_count == 1) ? 0xFFFFFF : ((addr - 4) & 0x1FFFFF); break;
+                    case DMA_Channel::OTC: data = (words_left - i == 1) ? 0xFFFFFF : ((addr - 4) & 0x1FFFFF); break;
                 }
                 sys->bus->Store<u32>(curr_addr, data);
                 break;
@@ -171,51 +281,47 @@ void DMA::TransferBlock(u32 index) {
         }
 
         addr += step;
-        transfer_count--;
     }
-    // TODO: reset start_trigger at DMA start
-    // TODO: reset other values (interrupts?)
-    ch.control.start_busy = false;
-    ch.control.start_trigger = false;
-
-    sys->AddCycles(CyclesForTransfer(index, total_word_count));
 }
 
-void DMA::TransferLinkedList(u32 index) {
+u32 DMA::TransferLinkedList(u32 index) {
     auto& ch = channel[index];
-    auto channel_type = static_cast<DMA_Channel>(index);
-
-    if (channel_type != DMA_Channel::GPU || ch.control.transfer_direction == Direction::ToRAM)
-        Panic("DMA linked list mode only available for GPU channel in ToDevice mode");
-
-    // align and wrap the address
-    u32 addr = ch.base_address & ADDR_MASK;
+    const u32* ram = reinterpret_cast<const u32*>(sys->bus->Memory().RAM());
 
-    u32 total_transfer_count = 0;
-
-    for (;;) {
-        u32 header = sys->bus->Load<u32>(addr);
-        u32 transfer_size = header >> 24;
-
-        while (transfer_size > 0) {
-            addr = (addr + 4) & ADDR_MASK;
-            u32 cmd = sys->bus->Load<u32>(addr);
-            sys->gpu->SendGP0Cmd(cmd);
-            transfer_size--;
+    // the nodes are small, a chunk takes as many of them as fit, headers included
+    u32 words = 0;
+    while (words < CHUNK_WORDS) {
+        // align and wrap the address
+        const u32 addr = ch.address & ADDR_MASK;
+        const u32 header = ram[addr / 4];
+        const u32 transfer_size = header >> 24;
+
+        // the packet follows the header, it gets parsed in place
+        SendToGpu((addr + 4) & ADDR_MASK, transfer_size);
+        words += 1 + transfer_size;
+
+        // the address register follows the list and ends up holding the end marker
+        ch.address = header & 0xFF'FFFF;
+        if ((header & 0x800000) != 0) {
+            chunk_finishes_transfer = true;
+            break;
         }
+    }
+    ch.base_address = ch.address;
 
-        total_transfer_count += transfer_size;
+    return words;
+}
 
-        if ((header & 0x800000) != 0) break;
+void DMA::SendToGpu(u32 addr, u32 count) {
+    const u32* ram = reinterpret_cast<const u32*>(sys->bus->Memory().RAM());
 
-        addr = header & ADDR_MASK;
+    // split the words where the address wraps around the end of RAM
+    while (count > 0) {
+        const u32 words = std::min(count, (GuestMemory::RAM_SIZE - addr) / 4);
+        sys->gpu->SendGP0Words(ram + addr / 4, words);
+        addr = (addr + words * 4) & ADDR_MASK;
+        count -= words;
     }
-    // TODO: reset start_trigger at DMA start
-    // TODO: reset other values (interrupts?)
-    ch.control.start_busy = false;
-    ch.control.start_trigger = false;
-
-    sys->AddCycles(CyclesForTransfer(index, total_transfer_count));
 }
 
 void DMA::UpdateMasterFlag() {
@@ -247,7 +353,14 @@ void DMA::Reset() {
         c.base_address = 0;
         c.bcr.value = 0;
         c.control.value = 0;
+        c.address = 0;
+        c.words_left = 0;
+        c.running = false;
     }
     control.value = 0x07654321;
     interrupt.value = 0;
+
+    chunk_channel = CHANNEL_COUNT;
+    chunk_finishes_transfer = false;
+    cycles_until_next_chunk = MaxCycles;
 }
@@ -14,13 +14,33 @@ public:
     u32 Peek(u32 address);
     void Store(u32 address, u32 value);
 
+    // transfers run in chunks, the CPU has no bus access while a chunk is moved
+    void Step(u32 cycles);
+    u32 CyclesUntilNextEvent() const;
+
 private:
     void UpdateMasterFlag();
     void StartTransfer(u32 channel);
-    void TransferBlock(u32 channel);
-    void TransferLinkedList(u32 channel);
+    // hands the bus to the next channel after a register write, unless a chunk is still being moved
+    void UpdateTransfers();
+    // the enabled channel with the highest priority that still has words to move, CHANNEL_COUNT if there is none
+    u32 NextChannel() const;
+    // completes the transfer of the last chunk and moves the next one,
+    // returns the number of cycles the CPU has to wait for it
+    u32 RunTransfers();
+    void FinishTransfer(u32 channel);
+    // both return the number of moved words
+    u32 TransferBlock(u32 channel);
+    u32 TransferLinkedList(u32 channel);
+    // moves count words between RAM and the device, words_left counts the rest of the transfer
+    void TransferWords(u32 channel, u32 addr, u32 count, u32 words_left);
+    // passes words from RAM to GP0 without copying them, the address wraps at the end of RAM
+    void SendToGpu(u32 addr, u32 count);
 
     static constexpr u32 ADDR_MASK = 0x1F'FFFC;
+    static constexpr u32 CHANNEL_COUNT = 7;
+    // chunk size of transfers without chopping, small enough to let the other components run in between
+    static constexpr u32 CHUNK_WORDS = 0x400;
     enum class DMA_Channel : u32 {
         MDECin = 0,
         MDECout = 1,
@@ -42,7 +62,7 @@ private:
         ToDevice = 1,
     };
 
-    enum class Step : u32 {
+    enum class AddressStep : u32 {
         Inc = 0,
         Dec = 1,
     };
@@ -64,7 +84,7 @@ private:
             u32 value;
 
             BitField<u32, Direction, 0, 1> transfer_direction;
-            BitField<u32, Step, 1, 1> mem_address_step;
+            BitField<u32, AddressStep, 1, 1> mem_address_step;
             BitField<u32, bool, 8, 1> chopping_enable;
             BitField<u32, SyncMode, 9, 2> sync_mode;
             BitField<u32, u32, 16, 3> chopping_dma_win_size;
@@ -74,12 +94,17 @@ private:
             BitField<u32, bool, 29, 1> pause;
         } control;
 
+        // progress of a started block transfer
+        u32 address;
+        u32 words_left;
+        bool running;
+
         bool ready() {
             bool trigger = control.sync_mode != SyncMode::Manual || control.start_trigger;
             return control.start_busy && trigger;
         }
     };
-    Channel channel[7] = {};
+    Channel channel[CHANNEL_COUNT] = {};
 
     union {
         u32 value = 0x07654321;
@@ -116,5 +141,10 @@ private:
         BitField<u32, bool, 31, 1> irq_master_flag;
     } interrupt;
 
+    // channel of the chunk that is currently moved and the number of cycles until the next one can start
+    u32 chunk_channel = CHANNEL_COUNT;
+    bool chunk_finishes_transfer = false;
+    u32 cycles_until_next_chunk = 0;
+
     System* sys = nullptr;
 };
\ No newline at end of file
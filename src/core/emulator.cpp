@@ -7,7 +7,6 @@
 #include "debugger/gdb_stub.h"
 #include "gpu.h"
 #include "peripherals.h"
-#include "timer/timers.h"
 
 LOG_CHANNEL(Emulator);
 
@@ -19,8 +18,15 @@ bool Emulator::LoadPsExe() {
     return sys.bus->LoadPsExe();
 }
 
-void Emulator::Tick() {
-    sys.cpu->Step();
+void Emulator::RunFrame() {
+    while (!sys.gpu->draw_frame && !sys.cpu->halt) {
+        // the debugger hooks are only compiled into the slower loop
+        if (sys.debugger->single_step || sys.debugger->HasBreakpoints()) [[unlikely]] {
+            sys.cpu->Execute<true>(MaxCycles);
+        } else {
+            sys.cpu->Execute<false>(MaxCycles);
+        }
+    }
 }
 
 bool Emulator::DrawNextFrame() {
@@ -45,10 +51,43 @@ void Emulator::Reset() {
     sys.Reset();
 }
 
+void Emulator::SetCodeCacheEnabled(bool enabled) {
+    Config::cpu_code_cache.Set(enabled);
+    sys.cpu->SetCodeCacheEnabled(enabled);
+}
+
+void Emulator::SetRecompilerEnabled(bool enabled) {
+    Config::cpu_recompiler.Set(enabled);
+    sys.cpu->SetRecompilerEnabled(enabled);
+}
+
+void Emulator::SetRecompilerDifferentialTesting(bool enabled) {
+    Config::recompiler_differential_testing = enabled;
+    sys.cpu->SetDifferentialTesting(enabled);
+}
+
+void Emulator::SetMultithreadedRendererEnabled(bool enabled) {
+    Config::gpu_multithreaded_renderer.Set(enabled);
+    sys.gpu->SetMultithreadedRenderer(enabled);
+}
+
+void Emulator::SetGpuThreadEnabled(bool enabled) {
+    Config::gpu_thread.Set(enabled);
+    sys.gpu->SetGpuThread(enabled);
+}
+
 std::tuple<u32, u32, bool> Emulator::DisplayInfo() {
     return {sys.gpu->HorizontalRes(), sys.gpu->VerticalRes(), sys.gpu->In24BPPMode()};
 }
 
+GPU::DisplayArea Emulator::GetDisplayArea() {
+    return sys.gpu->GetDisplayArea();
+}
+
+void Emulator::AddBreakpoint(u32 address) {
+    sys.debugger->AddBreakpoint(address);
+}
+
 bool Emulator::IsPaused() {
     return sys.cpu->halt;
 }
@@ -66,6 +105,10 @@ u16* Emulator::GetVRAM() {
     return sys.gpu->GetVRAM();
 }
 
+GPU::VramRows Emulator::TakeDirtyVramRows() {
+    return sys.gpu->TakeDirtyVramRows();
+}
+
 Controller& Emulator::GetMainController() {
     return sys.peripherals->GetController1();
 }
@@ -82,12 +125,3 @@ void Emulator::HandleGDBClientRequest() {
 
     GDB::HandleClientRequest();
 }
-
-void Emulator::DrawDebugWindows() {
-    if (Config::draw_mem_viewer) sys.bus->DrawMemEditor(&Config::draw_mem_viewer);
-    if (Config::draw_cpu_state) sys.cpu->DrawCpuState(&Config::draw_cpu_state);
-    if (Config::draw_gpu_state) sys.gpu->DrawGpuState(&Config::draw_gpu_state);
-    if (Config::draw_renderer_state) sys.gpu->DrawRendererState(&Config::draw_renderer_state);
-    if (Config::draw_debugger) sys.debugger->DrawDebugger(&Config::draw_debugger);
-    if (Config::draw_timer_state) sys.timers->DrawTimerState(&Config::draw_timer_state);
-}
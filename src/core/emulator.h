@@ -4,6 +4,7 @@
 
 #include "common/config.h"
 #include "controller.h"
+#include "gpu.h"
 #include "system.h"
 #include "util/types.h"
 
@@ -12,22 +13,36 @@ public:
     bool LoadBIOS();
     bool LoadPsExe();
 
-    void Tick();
+    // runs the CPU until the next vblank, returns early if the CPU got halted (e.g. by a breakpoint)
+    void RunFrame();
     bool DrawNextFrame();
     void ResetDrawFrame();
 
+    // execution halts once the CPU reaches the address
+    void AddBreakpoint(u32 address);
+
     bool IsPaused();
     void SetPaused(bool halt);
     void Reset();
 
+    void SetCodeCacheEnabled(bool enabled);
+    void SetRecompilerEnabled(bool enabled);
+    void SetRecompilerDifferentialTesting(bool enabled);
+    void SetMultithreadedRendererEnabled(bool enabled);
+    void SetGpuThreadEnabled(bool enabled);
+
     std::tuple<u32, u32, bool> DisplayInfo();
+    GPU::DisplayArea GetDisplayArea();
     u8* GetVideoOutput();
 
     u16* GetVRAM();
+    // rows of VRAM written since the last call
+    GPU::VramRows TakeDirtyVramRows();
 
     Controller& GetMainController();
 
-    void DrawDebugWindows();
+    // used by the debug views
+    System& GetSystem() { return sys; }
     void StartGDBServer();
     void HandleGDBClientRequest();
 
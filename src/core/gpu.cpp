@@ -1,10 +1,14 @@
 #include "gpu.h"
 
-#include "imgui.h"
+#include <algorithm>
+#include <cstring>
 
+#include "common/config.h"
 #include "common/log.h"
 #include "common/asserts.h"
+#include "renderer/renderer_mt.h"
 #include "renderer/renderer_sw.h"
+#include "renderer/renderer_threaded.h"
 #include "interrupt.h"
 #include "system.h"
 #include "timer/timers.h"
@@ -19,11 +23,39 @@ GPU::GPU(System* system) : sys(system), vram(VRAM_SIZE, 0), output(VRAM_SIZE * 2
     status.can_receive_dma_block = true;
 
     // load default renderer backend
-    renderer = std::make_unique<Renderer_SW>(this);
+    multithreaded_renderer = Config::gpu_multithreaded_renderer.Get();
+    gpu_thread = Config::gpu_thread.Get();
+    CreateRenderer();
+}
+
+void GPU::SetMultithreadedRenderer(bool enabled) {
+    multithreaded_renderer = enabled;
+    CreateRenderer();
+}
+
+void GPU::SetGpuThread(bool enabled) {
+    gpu_thread = enabled;
+    CreateRenderer();
+}
+
+void GPU::CreateRenderer() {
+    // the old backend finishes all pending commands when it gets destroyed
+    renderer.reset();
+
+    std::unique_ptr<Renderer> backend;
+    if (multithreaded_renderer) {
+        backend = std::make_unique<Renderer_MT>(vram.data());
+    } else {
+        backend = std::make_unique<Renderer_SW>(vram.data());
+    }
+    if (gpu_thread) backend = std::make_unique<Renderer_Threaded>(std::move(backend));
+
+    renderer = std::move(backend);
+    LogInfo("Graphics backend: {}", renderer->Name());
+}
 
-    // register timed event
-    sys->RegisterEvent(
-        System::TimedEvent::GPU, [this](u32 cycles) { Step(cycles); }, [this]() { return CyclesUntilNextEvent(); });
+const char* GPU::RendererName() const {
+    return renderer->Name();
 }
 
 void GPU::Step(u32 cpu_cycles) {
@@ -132,13 +164,15 @@ u32 GPU::CyclesUntilNextEvent() {
 }
 
 void GPU::SendGP0Cmd(u32 cmd) {
+    Profiler::Scope scope(*sys->profiler, Profiler::Category::GPU);
+
     // move all this logic into dma.cpp
     if (mode == Mode::DataToCPU || mode == Mode::DataFromCPU) {
         if (words_remaining == 0) {
             mode = Mode::Command;
             command_counter = 0;
         } else {
-            if (mode == Mode::DataFromCPU) CopyRectCpuToVram(cmd);
+            if (mode == Mode::DataFromCPU) CopyRectCpuToVram(&cmd, 1);
             if (mode == Mode::DataToCPU) CopyRectVramToCpu();
             words_remaining--;
             // no reason to continue
@@ -292,6 +326,24 @@ void GPU::SendGP0Cmd(u32 cmd) {
     // clang-format on
 }
 
+void GPU::SendGP0Words(const u32* words, size_t count) {
+    Profiler::Scope scope(*sys->profiler, Profiler::Category::GPU);
+
+    while (count > 0) {
+        // the image data of a CPU to VRAM copy can be written in one go, everything else is parsed word by word
+        if (mode == Mode::DataFromCPU && words_remaining > 0) {
+            const u32 image_words = static_cast<u32>(std::min<size_t>(count, words_remaining));
+            CopyRectCpuToVram(words, image_words);
+            words_remaining -= image_words;
+            words += image_words;
+            count -= image_words;
+        } else {
+            SendGP0Cmd(*words++);
+            count--;
+        }
+    }
+}
+
 void GPU::SendGP1Cmd(u32 cmd) {
     //LOG_DEBUG << fmt::format("GPU received GP1 command 0x{:08X}", cmd);
     command.value = cmd;
@@ -344,7 +396,7 @@ void GPU::SendGP1Cmd(u32 cmd) {
             if (new_status.value != status.value) {
                 sys->ForceUpdateComponents();
                 status.value = new_status.value;
-                sys->RecalculateCyclesUntilNextEvent();
+                sys->Schedule(System::TimedEvent::GPU, CyclesUntilNextEvent());
             }
 
             break;
@@ -380,7 +432,7 @@ void GPU::DrawPolygonMono() {
         vertices[i].c.SetColor(command_buffer[0]);
         vertices[i].SetTextPoint(0);
     }
-    renderer->Draw(command_buffer[0]);
+    SubmitDraw();
 }
 
 template<GPU::PolygonType type>
@@ -394,7 +446,7 @@ void GPU::DrawPolygonShaded() {
         vertices[i].c.SetColor(command_buffer[(i * 2)]);
         vertices[i].SetTextPoint(0);
     }
-    renderer->Draw(command_buffer[0]);
+    SubmitDraw();
 }
 
 template<GPU::PolygonType type>
@@ -419,7 +471,7 @@ void GPU::DrawPolygonTextured() {
         vertices[i].SetTextPoint(command_buffer[(i * 2) + 2]);
     }
 
-    renderer->Draw(command_buffer[0]);
+    SubmitDraw();
 }
 
 template<GPU::PolygonType type>
@@ -444,7 +496,7 @@ void GPU::DrawPolygonTexturedShaded() {
         vertices[i].SetTextPoint(command_buffer[(i * 3) + 2]);
     }
 
-    renderer->Draw(command_buffer[0]);
+    SubmitDraw();
 }
 
 //              //
@@ -458,7 +510,7 @@ void GPU::DrawRectangleMono() {
     rectangle.SetStart(command_buffer[1]);
     rectangle.SetSize(command_buffer[2]);
 
-    renderer->Draw(command_buffer[0]);
+    SubmitDraw();
 }
 
 void GPU::DrawRectangleTextured() {
@@ -472,7 +524,7 @@ void GPU::DrawRectangleTextured() {
     // Texpage gets set up separately via GP0(0xE1)
     clut = command_buffer[2] >> 16;
 
-    renderer->Draw(command_buffer[0]);
+    SubmitDraw();
 }
 
 //              //
@@ -495,7 +547,7 @@ void GPU::DrawLineMono(bool is_poly_line) {
         line_buffer.emplace_back(p);
     }
 
-    renderer->Draw(command_buffer[0]);
+    SubmitLines();
 }
 
 void GPU::DrawLineShaded(bool is_poly_line) {
@@ -514,97 +566,161 @@ void GPU::DrawLineShaded(bool is_poly_line) {
         line_buffer.emplace_back(p);
     }
 
-    renderer->Draw(command_buffer[0]);
+    SubmitLines();
 }
 
-void GPU::CopyRectCpuToVram(u32 data /* = 0 */) {
-    static u32 x_pos_max = 0;
-    static u32 x_pos = 0;
-    static u32 y_pos = 0;
+void GPU::SubmitDraw() {
+    const DrawCommand draw_command = CaptureDrawState();
 
-    if (mode == Mode::Command) {
-        const u32 pos = command_buffer[1];
-        x_pos = pos & 0x3FF;
-        y_pos = (pos >> 16) & 0x1FF;
+    if (draw_command.cmd >> 29 == 1) {
+        // 4-point polygons get split into two triangles
+        sys->stats->frame_triangle_draw_count += (draw_command.cmd & (1u << 27)) ? 2 : 1;
+    } else {
+        sys->stats->frame_rectangle_draw_count++;
+    }
 
-        const u32 resolution = command_buffer[2];
-        const u32 width = resolution & 0x3FF;
-        const u32 height = (resolution >> 16) & 0x1FF;
-        u32 img_size = width * height;
-        // round up
-        img_size = (img_size + 1) & ~0x1;
-        // the GPU uses 16-bit pixels but receives them in 32-bit packets
-        words_remaining = img_size / 2;
+    renderer->Draw(draw_command);
+    MarkVramDirty(Renderer_SW::DrawBounds(draw_command));
+}
 
-        // determine the length of a line (can overflow VRAM_WIDTH in which case x_pos must wrap around)
-        x_pos_max = x_pos + width;
-
-        mode = Mode::DataFromCPU;
-        //LogDebug("CopyCPUtoVram: {} words from (x={}, y={}) to (x={}, y={})",
-        //                         words_remaining, x_pos, y_pos, x_pos + width - 1, y_pos + height - 1);
-    } else if (mode == Mode::DataFromCPU) {
-        // first halfword
-        vram[(x_pos % VRAM_WIDTH) + VRAM_WIDTH * y_pos] = data & 0xFFFF;
-        // increment and check for overflow
-        auto Increment = [&] {
-            x_pos++;
-            if (x_pos >= x_pos_max) {
-                y_pos = (y_pos + 1) % 512;
-                x_pos = command_buffer[1] & 0x3FF;
-            }
-        };
-        Increment();
+void GPU::SubmitLines() {
+    if (line_buffer.size() < 2) {
+        LogWarn("Trying to draw a line without at least 2 points");
+        return;
+    }
 
-        // second halfword
-        vram[(x_pos % VRAM_WIDTH) + VRAM_WIDTH * y_pos] = data >> 16;
-        Increment();
-    } else {
-        Panic("Invalid GPU transfer mode during CopyRectCpuToVram");
+    // the renderer draws one segment at a time
+    DrawCommand draw_command = CaptureDrawState();
+    for (usize i = 0; i < line_buffer.size() - 1; i++) {
+        draw_command.vertices[0] = line_buffer[i];
+        draw_command.vertices[1] = line_buffer[i + 1];
+        renderer->Draw(draw_command);
+        MarkVramDirty(Renderer_SW::DrawBounds(draw_command));
+    }
+
+    sys->stats->frame_line_draw_count++;
+}
+
+DrawCommand GPU::CaptureDrawState() const {
+    DrawCommand draw_command;
+    draw_command.cmd = command_buffer[0];
+    draw_command.vertices = vertices;
+    draw_command.rectangle = rectangle;
+
+    draw_command.tex_page_x_base = static_cast<u8>(status.tex_page_x_base);
+    draw_command.tex_page_y_base = static_cast<u8>(status.tex_page_y_base);
+    draw_command.tex_page_colors = static_cast<u8>(status.tex_page_colors);
+    draw_command.semi_transparency = static_cast<u8>(status.semi_transparency);
+    draw_command.tex_rectangle_xflip = tex_rectangle_xflip;
+    draw_command.tex_rectangle_yflip = tex_rectangle_yflip;
+    draw_command.clut = clut;
+
+    draw_command.tex_window_x_mask = tex_window_x_mask;
+    draw_command.tex_window_y_mask = tex_window_y_mask;
+    draw_command.tex_window_x_offset = tex_window_x_offset;
+    draw_command.tex_window_y_offset = tex_window_y_offset;
+
+    draw_command.drawing_area_left = drawing_area_left;
+    draw_command.drawing_area_top = drawing_area_top;
+    draw_command.drawing_area_right = drawing_area_right;
+    draw_command.drawing_area_bottom = drawing_area_bottom;
+    draw_command.drawing_x_offset = drawing_x_offset;
+    draw_command.drawing_y_offset = drawing_y_offset;
+    return draw_command;
+}
+
+void GPU::CopyRectCpuToVram() {
+    // sync point, the upload must not overtake earlier draws
+    renderer->Sync();
+
+    const u32 pos = command_buffer[1];
+    const u32 resolution = command_buffer[2];
+    const u32 width = resolution & 0x3FF;
+    const u32 height = (resolution >> 16) & 0x1FF;
+    vram_transfer = {.x = pos & 0x3FF, .y = (pos >> 16) & 0x1FF, .width = width, .height = height};
+
+    u32 img_size = width * height;
+    // round up
+    img_size = (img_size + 1) & ~0x1;
+    // the GPU uses 16-bit pixels but receives them in 32-bit packets
+    words_remaining = img_size / 2;
+
+    // nothing gets drawn until the upload is done
+    InvalidateVram(vram_transfer.x, vram_transfer.y, width, height);
+
+    mode = Mode::DataFromCPU;
+    //LogDebug("CopyCPUtoVram: {} words from (x={}, y={}) to (x={}, y={})",
+    //         words_remaining, vram_transfer.x, vram_transfer.y, vram_transfer.x + width - 1,
+    //         vram_transfer.y + height - 1);
+}
+
+void GPU::CopyRectCpuToVram(const u32* data, u32 count) {
+    DebugAssert(mode == Mode::DataFromCPU && count <= words_remaining);
+
+    auto& transfer = vram_transfer;
+    // two halfwords per word, the host has the same byte order as the PS1
+    const u16* src = reinterpret_cast<const u16*>(data);
+    u32 halfwords = count * 2;
+
+    // copy the image row by row, the rows wrap around the edges of VRAM
+    // an odd pixel count pads the last word with a halfword that gets dropped
+    while (halfwords > 0 && transfer.row < transfer.height) {
+        const u32 x = (transfer.x + transfer.column) & 0x3FF;
+        const u32 y = (transfer.y + transfer.row) & 0x1FF;
+        u16* row = &vram[VRAM_WIDTH * y];
+        // the upload can be interrupted by a frame being displayed, so rows are marked as they get written
+        MarkVramDirty({0, s32(y), 0, s32(y)});
+
+        const u32 span = std::min(halfwords, transfer.width - transfer.column);
+        const u32 first = std::min(span, VRAM_WIDTH - x);
+        std::memcpy(row + x, src, first * sizeof(u16));
+        std::memcpy(row, src + first, (span - first) * sizeof(u16));
+
+        src += span;
+        halfwords -= span;
+        transfer.column += span;
+        if (transfer.column == transfer.width) {
+            transfer.column = 0;
+            transfer.row++;
+        }
     }
 }
 
 void GPU::CopyRectVramToCpu() {
-    static u32 x_pos_max = 0;
-    static u32 x_pos = 0;
-    static u32 y_pos = 0;
+    auto& transfer = vram_transfer;
 
     if (mode == Mode::Command) {
-        const u32 pos = command_buffer[1];
-        x_pos = pos & 0x3FF;
-        y_pos = (pos >> 16) & 0x1FF;
+        // sync point, the CPU has to see the result of all earlier draws
+        renderer->Sync();
 
+        const u32 pos = command_buffer[1];
         const u32 resolution = command_buffer[2];
         const u32 width = resolution & 0x3FF;
         const u32 height = (resolution >> 16) & 0x1FF;
+        transfer = {.x = pos & 0x3FF, .y = (pos >> 16) & 0x1FF, .width = width, .height = height};
+
         u32 img_size = width * height;
         // round up
         img_size = (img_size + 1) & ~0x1;
         // the GPU uses 16-bit pixels but sends them in 32-bit packets
         words_remaining = img_size / 2;
 
-        // determine the length of a line (can overflow VRAM_WIDTH in which case x_pos must wrap around)
-        x_pos_max = x_pos + width;
-
         mode = Mode::DataToCPU;
-        //LogDebug("CopyVramToCPU: {} words from (x={}, y={}) to (x={}, y={})", words_remaining, x_pos,
-        //                         y_pos, x_pos + width - 1, y_pos + height - 1);
+        //LogDebug("CopyVramToCPU: {} words from (x={}, y={}) to (x={}, y={})", words_remaining, transfer.x,
+        //         transfer.y, transfer.x + width - 1, transfer.y + height - 1);
     } else if (mode == Mode::DataToCPU) {
-        // first halfword
-        u32 word1 = vram[(x_pos % VRAM_WIDTH) + VRAM_WIDTH * y_pos];
-        // increment and check for overflow
-        auto Increment = [&] {
-            x_pos++;
-            if (x_pos >= x_pos_max) {
-                y_pos = (y_pos + 1) % 512;
-                x_pos = command_buffer[1] & 0x3FF;
+        auto ReadHalfword = [&]() -> u32 {
+            const u32 x = (transfer.x + transfer.column) & 0x3FF;
+            const u32 y = (transfer.y + transfer.row) & 0x1FF;
+            if (++transfer.column == transfer.width) {
+                transfer.column = 0;
+                transfer.row++;
             }
+            return vram[x + VRAM_WIDTH * y];
         };
-        Increment();
-
-        // second halfword
-        u32 word2 = vram[(x_pos % VRAM_WIDTH) + VRAM_WIDTH * y_pos];
-        Increment();
 
+        const u32 word1 = ReadHalfword();
+        const u32 word2 = ReadHalfword();
         gpu_read = (word2 << 16) | word1;
     } else {
         Panic("Invalid GPU transfer mode during CopyRectVramToCpu");
@@ -612,6 +728,9 @@ void GPU::CopyRectVramToCpu() {
 }
 
 void GPU::CopyRectVramToVram() {
+    // sync point, source and destination can both have pending draws
+    renderer->Sync();
+
     const u32 src_coords = command_buffer[1];
     const u32 src_start_x = src_coords & 0x3FF;
     const u32 src_start_y = (src_coords >> 16) & 0x1FF;
@@ -626,15 +745,37 @@ void GPU::CopyRectVramToVram() {
     u32 size_y = (size >> 16) & 0x1FF;
     size_y = size_y == 0 ? 0x200 : ((size_y - 1) & 0x1FF) + 1;
 
-    for (u32 src_y = src_start_y, dst_y = dst_start_y; src_y < src_start_y + size_y; src_y++, dst_y++) {
-        src_y &= 0x1FF;
-        dst_y &= 0x1FF;
-        for (u32 src_x = src_start_x, dst_x = dst_start_x; src_x < src_start_x + size_x; src_x++, dst_x++) {
-            src_x &= 0x3FF;
-            dst_x &= 0x3FF;
-            vram[dst_y * VRAM_WIDTH + dst_x] = vram[src_y * VRAM_WIDTH + src_x];
+    // rows get copied from top to bottom, but every row is copied as a whole (like the hardware does),
+    // so an overlapping copy to the right does not repeat the source pixels
+    std::array<u16, VRAM_WIDTH> row_buffer;
+    const bool wraps = src_start_x + size_x > VRAM_WIDTH || dst_start_x + size_x > VRAM_WIDTH;
+
+    for (u32 row = 0; row < size_y; row++) {
+        const u16* src = &vram[VRAM_WIDTH * ((src_start_y + row) & 0x1FF)];
+        u16* dst = &vram[VRAM_WIDTH * ((dst_start_y + row) & 0x1FF)];
+
+        if (!wraps) {
+            std::memmove(dst + dst_start_x, src + src_start_x, size_x * sizeof(u16));
+            continue;
+        }
+
+        // a row that wraps around the right edge of VRAM is split into spans, with source and destination
+        // overlapping an earlier span could overwrite pixels a later one still reads, so the row is read first
+        for (u32 column = 0; column < size_x;) {
+            const u32 src_x = (src_start_x + column) & 0x3FF;
+            const u32 span = std::min(size_x - column, VRAM_WIDTH - src_x);
+            std::memcpy(row_buffer.data() + column, src + src_x, span * sizeof(u16));
+            column += span;
+        }
+        for (u32 column = 0; column < size_x;) {
+            const u32 dst_x = (dst_start_x + column) & 0x3FF;
+            const u32 span = std::min(size_x - column, VRAM_WIDTH - dst_x);
+            std::memcpy(dst + dst_x, row_buffer.data() + column, span * sizeof(u16));
+            column += span;
         }
     }
+
+    InvalidateVram(dst_start_x, dst_start_y, size_x, size_y);
 }
 
 void GPU::FillVram() {
@@ -648,6 +789,8 @@ void GPU::FillVram() {
 
     if (size_x == 0 || size_y == 0) return;
 
+    renderer->Sync();
+
     Color c = {};
     c.SetColor(command_buffer[0]);
     const u16 color_15bit = c.To5551();
@@ -655,13 +798,30 @@ void GPU::FillVram() {
     //LogDebug("FillRectVram: start_x={}, start_y={}, size_x={}, size_y={}, color=0x{:08x}", start_x, start_y, size_x, size_y,
     //         command_buffer[0] & 0x00FFFFFF);
 
-    for (u32 y = start_y; y < start_y + size_y; y++) {
-        y &= 0x1FF;
-        for (u32 x = start_x; x < start_x + size_x; x++) {
-            x &= 0x3FF;
-            vram[y * VRAM_WIDTH + x] = color_15bit;
-        }
+    // both the start and the size are multiples of 16, so a row wraps around the right edge at most once
+    const u32 first = std::min(size_x, VRAM_WIDTH - start_x);
+    for (u32 row = 0; row < size_y; row++) {
+        u16* dst = &vram[VRAM_WIDTH * ((start_y + row) & 0x1FF)];
+        std::fill_n(dst + start_x, first, color_15bit);
+        std::fill_n(dst, size_x - first, color_15bit);
     }
+
+    InvalidateVram(start_x, start_y, size_x, size_y);
+}
+
+void GPU::InvalidateVram(u32 x, u32 y, u32 width, u32 height) {
+    // wrapping areas invalidate the whole width or height of VRAM
+    VramRect area = {s32(x), s32(y), s32(x + width) - 1, s32(y + height) - 1};
+    if (x + width > VRAM_WIDTH) area.left = 0, area.right = VRAM_WIDTH - 1;
+    if (y + height > VRAM_HEIGHT) area.top = 0, area.bottom = VRAM_HEIGHT - 1;
+    renderer->InvalidateVram(area);
+    MarkVramDirty(area);
+}
+
+void GPU::MarkVramDirty(const VramRect& area) {
+    if (area.Empty()) return;
+    output_dirty_rows.Set(u32(area.top), u32(area.bottom));
+    host_dirty_rows.Set(u32(area.top), u32(area.bottom));
 }
 
 void GPU::ResetCommand() {
@@ -713,10 +873,11 @@ void GPU::ResetCommand() {
 u32 GPU::ReadStat() {
     // the even_odd_bit might flip again between now and the next timed event (e.g. a timer reaching its target)
     // TODO: make this a config? performance vs accuracy...
-    const auto dots_until_next_event = accumulated_dots + sys->GetCyclesUntilNextEvent() * DotsPerGpuCycle();
+    const auto dots_until_next_event =
+        accumulated_dots + sys->GetCyclesUntilNextEvent(System::TimedEvent::GPU) * DotsPerGpuCycle();
     if (dots_until_next_event >= DotsPerScanline()) {
         sys->ForceUpdateComponents();
-        sys->RecalculateCyclesUntilNextEvent();
+        sys->Schedule(System::TimedEvent::GPU, CyclesUntilNextEvent());
     }
 
     // even_odd_bit is always 0 during vblank
@@ -724,13 +885,42 @@ u32 GPU::ReadStat() {
 }
 
 u16* GPU::GetVRAM() {
+    renderer->Sync();
     return vram.data();
 }
 
+void GPU::InvalidateVram() {
+    renderer->Sync();
+    renderer->InvalidateVram({0, 0, VRAM_WIDTH - 1, VRAM_HEIGHT - 1});
+    output_dirty_rows.SetAll();
+    host_dirty_rows.SetAll();
+}
+
+GPU::VramRows GPU::TakeDirtyVramRows() {
+    const VramRows rows = host_dirty_rows;
+    host_dirty_rows.Clear();
+    return rows;
+}
+
+GPU::DisplayArea GPU::GetDisplayArea() const {
+    return {
+        .x = display_vram_x_start,
+        .y = display_vram_y_start,
+        .width = HorizontalRes(),
+        .height = VerticalRes(),
+        .is_24bpp = In24BPPMode(),
+        .interlaced = VerticalRes() == 480,
+        .field = status.interlace_even_or_odd_line,
+    };
+}
+
 u8* GPU::GetVideoOutput() {
+    renderer->Sync();
+
     const u32 hres = HorizontalRes();
     const u32 vres = VerticalRes();
-    const usize size = HorizontalRes() * VerticalRes();
+    const u32 row_bytes = status.display_area_color_depth ? (hres * 3) : (hres * 2);
+    const usize size = usize(row_bytes) * vres;
 
     if (output.size() != size) {
         LogDebug("Changing display size to {}x{}", hres, vres);
@@ -744,13 +934,19 @@ u8* GPU::GetVideoOutput() {
 
     // VRAM data is indexed as halfwords (u16)
     const u32 start_x = display_vram_x_start;
-    const u32 row_bytes = status.display_area_color_depth ? (hres * 3) : (hres * 2);
     DebugAssert(start_x * 2 + row_bytes < 2048);
 
+    // a different display area has to be copied completely, otherwise only the rows that got written
+    const OutputArea area = {.x = start_x, .y = start_y, .row_bytes = row_bytes, .height = vres};
+    const bool full_copy = area != output_area;
+    output_area = area;
+
     // copy display area from vram to output
     for (u32 y = start_y, dest_i = 0; y < end_y; y++, dest_i++) {
+        if (!full_copy && !output_dirty_rows.Test(y)) continue;
         std::memcpy(output.data() + row_bytes * dest_i, (u8*)(vram.data() + VRAM_WIDTH * y + start_x), row_bytes);
     }
+    output_dirty_rows.Clear();
 
     return output.data();
 }
@@ -780,6 +976,7 @@ void GPU::Reset() {
     for (auto& c : command_buffer) c = 0;
     mode = Mode::Command;
     words_remaining = 0;
+    vram_transfer = {};
 
     gpu_clock = 0;
     scanline = 0;
@@ -789,8 +986,14 @@ void GPU::Reset() {
 
     was_in_hblank = was_in_vblank = false;
 
+    // pending draws must not end up in the cleared VRAM
+    renderer->Sync();
     std::fill(vram.begin(), vram.end(), 0);
+    renderer->InvalidateVram({0, 0, VRAM_WIDTH - 1, VRAM_HEIGHT - 1});
     std::fill(output.begin(), output.end(), 0);
+    output_area = {};
+    output_dirty_rows.SetAll();
+    host_dirty_rows.SetAll();
 
     for (auto& v : vertices) v.Reset();
 
@@ -799,69 +1002,25 @@ void GPU::Reset() {
     clut = 0;
 }
 
-void GPU::DrawGpuState(bool* open) {
-    ImGui::Begin("GPU State", open);
-
-    ImGui::Columns(2);
-    ImGui::Text("Command buffer");
-    ImGui::Separator();
-    const ImVec4 white(1.0, 1.0, 1.0, 1.0);
-    const ImVec4 grey(0.5, 0.5, 0.5, 1.0);
-    for (u32 i = 0; i < 12; i++) {
-        ImGui::TextColored((i > command_counter) ? grey : white, " %-2d  %08X", i, command_buffer[i]);
-        if (i == command_counter) {
-            ImGui::SameLine();
-            ImGui::Text("  <--- cmd end");
-        }
-    }
-    ImGui::NextColumn();
-    if (ImGui::TreeNode("__gpustat_node", "GPUSTAT   0x%08X", status.value)) {
-        ImGui::Text("Tex page base: x=%u, y=%u", status.tex_page_x_base * 64, status.tex_page_y_base * 256);
-        ImGui::Text("Semi transparency: %u", status.semi_transparency.GetValue());
-        static const char* const formats[4] = {"4bit", "8bit", "15bit", "Invalid"};
-        ImGui::Text("Tex page format: %s", formats[status.tex_page_colors]);
-        ImGui::Text("Dithering: %s", status.dither ? "Enabled" : "Off");
-        ImGui::Text("Draw to display area: %s", status.draw_enable ? "Allowed" : "Prohibited");
-        ImGui::Text("Mask bit enabled: %s", status.mask_enable ? "Yes" : "No");
-        ImGui::Text("Draw to masked areas: %s", status.draw_pixels ? "No" : "Yes");
-        ImGui::Text("Interlace field: %u", status.interlace_field.GetValue());
-        ImGui::Text("Reverse flag: %u", status.reverse.GetValue());
-        ImGui::Text("Textures enabled: %s", status.tex_disable ? "No" : "Yes");
-        ImGui::Text("Vertical interlace: %u", status.vertical_interlace.GetValue());
-        ImGui::Text("Display enabled: %s", status.display_disabled ? "No" : "Yes");
-        ImGui::Text("Interrupt Request: %s", status.interrupt_request ? "IRQ1" : "Off");
-        ImGui::Text("DMA / Data Request: %u", status.dma_data_stat.GetValue());
-        ImGui::Text("Ready to receive command: %u", status.can_receive_cmd_word.GetValue());
-        ImGui::Text("Ready to send VRAM: %u", status.can_send_vram_to_cpu.GetValue());
-        ImGui::Text("Ready to receive DMA block: %u", status.can_receive_dma_block.GetValue());
-        ImGui::Text("DMA direction: %u", static_cast<u32>(status.dma_direction.GetValue()));
-        ImGui::Text("Interlace line: %s", status.interlace_even_or_odd_line ? "Odd" : "Even");
-
-        ImGui::TreePop();
-    }
-    ImGui::Text("Transfer mode  %s", (mode == Mode::Command) ? "[COMMAND]" : "[DATA]");
-
-    ImGui::Text("Draw area [x,y]");
-    ImGui::Text("[%3d,%3d]------+", drawing_area_left, drawing_area_top);
-    ImGui::Text("    |          | ");
-    ImGui::Text("    +------[%3d,%3d]", drawing_area_right, drawing_area_bottom);
-
-    ImGui::Text("Draw offset:  x=%d, y=%d", drawing_x_offset, drawing_y_offset);
-    ImGui::Text("VRAM start:   x=%u, y=%u", display_vram_x_start, display_vram_y_start);
-    ImGui::Text("Horiz. range: start=%u, end=%u", display_horizontal_start, display_horizontal_end);
-    ImGui::Text("Line range:   start=%u, end=%u", display_line_start, display_line_end);
-
-    ImGui::Text("Video mode: %s - %d BPP", status.video_mode == VideoMode::NTSC ? "NTSC" : "PAL",
-                status.display_area_color_depth ? 24 : 15);
-    ImGui::Text("Horizontal resolution: %u", HorizontalRes());
-    ImGui::Text("Vertical resolution:   %u", VerticalRes());
-
-    ImGui::Columns(1);
-    ImGui::Separator();
-
-    ImGui::End();
-}
-
-void GPU::DrawRendererState(bool* open) {
-    if (renderer) renderer->DrawImguiRendererState(open);
+GPU::DebugState GPU::GetDebugState() const {
+    DebugState state;
+    state.status = status.value;
+    state.command_buffer = command_buffer;
+    state.command_counter = command_counter;
+    state.command_mode = mode == Mode::Command;
+
+    state.drawing_area_left = drawing_area_left;
+    state.drawing_area_top = drawing_area_top;
+    state.drawing_area_right = drawing_area_right;
+    state.drawing_area_bottom = drawing_area_bottom;
+    state.drawing_x_offset = drawing_x_offset;
+    state.drawing_y_offset = drawing_y_offset;
+
+    state.display_vram_x_start = display_vram_x_start;
+    state.display_vram_y_start = display_vram_y_start;
+    state.display_horizontal_start = display_horizontal_start;
+    state.display_horizontal_end = display_horizontal_end;
+    state.display_line_start = display_line_start;
+    state.display_line_end = display_line_end;
+    return state;
 }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
 #include <memory>
 #include <vector>
@@ -11,16 +12,81 @@
 class System;
 
 class GPU {
-    friend class Renderer_SW;
-
 public:
     static constexpr u32 VRAM_WIDTH = 1024;
     static constexpr u32 VRAM_HEIGHT = 512;
     static constexpr u32 VRAM_SIZE = 1024 * 512;
 
+    enum class DmaDirection : u32 {
+        Off = 0,
+        Fifo = 1,
+        CpuToGp0 = 2,
+        VramToCpu = 3,
+    };
+
+    enum class VideoMode : u32 { NTSC, PAL };
+
+    // one bit per row of VRAM, used to track which rows got written since a consumer last looked at them
+    class VramRows {
+    public:
+        // sets the rows first to last (inclusive)
+        void Set(u32 first, u32 last) {
+            for (u32 word = first / 64; word <= last / 64; word++) {
+                const u32 lo = std::max(first, word * 64) % 64, hi = std::min(last, word * 64 + 63) % 64;
+                bits[word] |= (~0ull >> (63 - hi)) & (~0ull << lo);
+            }
+        }
+        void SetAll() { bits.fill(~0ull); }
+        void Clear() { bits.fill(0); }
+
+        bool Test(u32 row) const { return (bits[row / 64] >> (row % 64)) & 1; }
+        bool Any() const {
+            for (u64 word : bits)
+                if (word != 0) return true;
+            return false;
+        }
+
+    private:
+        std::array<u64, VRAM_HEIGHT / 64> bits = {};
+    };
+
+    // TODO: more enums for types
+    union GpuStatus {
+        u32 value = 0;
+
+        BitField<u32, u32, 0, 4> tex_page_x_base;
+        BitField<u32, u32, 4, 1> tex_page_y_base;
+        BitField<u32, u32, 5, 2> semi_transparency;
+        BitField<u32, u32, 7, 2> tex_page_colors;
+        BitField<u32, bool, 9, 1> dither;
+        BitField<u32, bool, 10, 1> draw_enable;
+        BitField<u32, bool, 11, 1> mask_enable;
+        BitField<u32, bool, 12, 1> draw_pixels;
+        BitField<u32, bool, 13, 1> interlace_field;
+        BitField<u32, bool, 14, 1> reverse;
+        BitField<u32, bool, 15, 1> tex_disable;
+        BitField<u32, u32, 16, 1> horizontal_res_2;
+        BitField<u32, u32, 17, 2> horizontal_res_1;
+        BitField<u32, u32, 19, 1> vertical_res;
+        BitField<u32, VideoMode, 20, 1> video_mode;
+        BitField<u32, u32, 21, 1> display_area_color_depth;
+        BitField<u32, bool, 22, 1> vertical_interlace;
+        BitField<u32, bool, 23, 1> display_disabled;
+        BitField<u32, bool, 24, 1> interrupt_request;
+        BitField<u32, bool, 25, 1> dma_data_stat;
+        BitField<u32, bool, 26, 1> can_receive_cmd_word;
+        BitField<u32, bool, 27, 1> can_send_vram_to_cpu;
+        BitField<u32, bool, 28, 1> can_receive_dma_block;
+        BitField<u32, DmaDirection, 29, 2> dma_direction;
+        BitField<u32, u32, 31, 1> interlace_even_or_odd_line;
+    };
+
     explicit GPU(System* system);
     void Reset();
 
+    void Step(u32 cycles);
+    u32 CyclesUntilNextEvent();
+
     ALWAYS_INLINE u32 VerticalRes() const { return (status.vertical_res && status.vertical_interlace) ? 480 : 240; }
 
     u32 HorizontalRes() const {
@@ -38,15 +104,53 @@ public:
 
     bool In24BPPMode() const { return static_cast<bool>(status.display_area_color_depth); }
 
+    // the part of VRAM that gets sent to the TV
+    struct DisplayArea {
+        u32 x = 0, y = 0;
+        u32 width = 0, height = 0;
+        bool is_24bpp = false;
+        // in 480 line mode the frame consists of two fields, the even and the odd lines
+        bool interlaced = false;
+        u32 field = 0;
+    };
+    DisplayArea GetDisplayArea() const;
+
     u32 ReadStat();
     void SendGP0Cmd(u32 cmd);
+    // same as calling SendGP0Cmd for every word, but the image data of CPU to VRAM copies gets written in bulk
+    void SendGP0Words(const u32* words, size_t count);
     void SendGP1Cmd(u32 cmd);
 
     u16* GetVRAM();
+    // copy of the display area for frontends that convert it on the CPU, only rows that changed get copied again
     u8* GetVideoOutput();
-
-    void DrawGpuState(bool* open);
-    void DrawRendererState(bool* open);
+    // rows of VRAM written since the last call, lets the host update its own copy of VRAM row by row
+    VramRows TakeDirtyVramRows();
+    // has to be called after writing to VRAM through GetVRAM(), drops all decoded textures
+    void InvalidateVram();
+
+    // switches between the single threaded and the multithreaded software renderer
+    void SetMultithreadedRenderer(bool enabled);
+    // moves the rasterization onto a dedicated GPU thread
+    void SetGpuThread(bool enabled);
+    const char* RendererName() const;
+
+    // read-only snapshot of the internal state for the debug views
+    struct DebugState {
+        u32 status = 0;
+        std::array<u32, 12> command_buffer = {};
+        u32 command_counter = 0;
+        bool command_mode = true;
+
+        u16 drawing_area_left = 0, drawing_area_top = 0;
+        u16 drawing_area_right = 0, drawing_area_bottom = 0;
+        s16 drawing_x_offset = 0, drawing_y_offset = 0;
+
+        u16 display_vram_x_start = 0, display_vram_y_start = 0;
+        u16 display_horizontal_start = 0, display_horizontal_end = 0;
+        u16 display_line_start = 0, display_line_end = 0;
+    };
+    DebugState GetDebugState() const;
 
     bool draw_frame = false;
 
@@ -88,9 +192,6 @@ private:
 
     bool InterlacedAnd240Vres() const { return !status.vertical_res && status.vertical_interlace; }
 
-    void Step(u32 cycles);
-    u32 CyclesUntilNextEvent();
-
     enum PolygonType : u8 {
         Three_Point = 3, Four_Point = 4
     };
@@ -114,53 +215,27 @@ private:
     void DrawLineMono(bool is_poly_line);
     void DrawLineShaded(bool is_poly_line);
 
-    void CopyRectCpuToVram(u32 data = 0);
+    // hands the current primitive together with the drawing state over to the renderer
+    void SubmitDraw();
+    void SubmitLines();
+    DrawCommand CaptureDrawState() const;
+
+    void CopyRectCpuToVram();
+    // writes the image data of the current upload, a whole DMA block can be passed at once
+    void CopyRectCpuToVram(const u32* data, u32 count);
     void CopyRectVramToCpu();
     void CopyRectVramToVram();
 
     void FillVram();
+    // the area wraps around the edges of VRAM
+    void InvalidateVram(u32 x, u32 y, u32 width, u32 height);
+    void MarkVramDirty(const VramRect& area);
 
     void ResetCommand();
 
-    enum class DmaDirection : u32 {
-        Off = 0,
-        Fifo = 1,
-        CpuToGp0 = 2,
-        VramToCpu = 3,
-    };
-
-    enum class VideoMode : u32 { NTSC, PAL };
-
-    // TODO: more enums for types
-    union GpuStatus {
-        u32 value = 0;
+    void CreateRenderer();
 
-        BitField<u32, u32, 0, 4> tex_page_x_base;
-        BitField<u32, u32, 4, 1> tex_page_y_base;
-        BitField<u32, u32, 5, 2> semi_transparency;
-        BitField<u32, u32, 7, 2> tex_page_colors;
-        BitField<u32, bool, 9, 1> dither;
-        BitField<u32, bool, 10, 1> draw_enable;
-        BitField<u32, bool, 11, 1> mask_enable;
-        BitField<u32, bool, 12, 1> draw_pixels;
-        BitField<u32, bool, 13, 1> interlace_field;
-        BitField<u32, bool, 14, 1> reverse;
-        BitField<u32, bool, 15, 1> tex_disable;
-        BitField<u32, u32, 16, 1> horizontal_res_2;
-        BitField<u32, u32, 17, 2> horizontal_res_1;
-        BitField<u32, u32, 19, 1> vertical_res;
-        BitField<u32, VideoMode, 20, 1> video_mode;
-        BitField<u32, u32, 21, 1> display_area_color_depth;
-        BitField<u32, bool, 22, 1> vertical_interlace;
-        BitField<u32, bool, 23, 1> display_disabled;
-        BitField<u32, bool, 24, 1> interrupt_request;
-        BitField<u32, bool, 25, 1> dma_data_stat;
-        BitField<u32, bool, 26, 1> can_receive_cmd_word;
-        BitField<u32, bool, 27, 1> can_send_vram_to_cpu;
-        BitField<u32, bool, 28, 1> can_receive_dma_block;
-        BitField<u32, DmaDirection, 29, 2> dma_direction;
-        BitField<u32, u32, 31, 1> interlace_even_or_odd_line;
-    } status;
+    GpuStatus status;
 
     bool tex_rectangle_xflip = false;
     bool tex_rectangle_yflip = false;
@@ -219,6 +294,14 @@ private:
     Mode mode = Mode::Command;
     u32 words_remaining = 0;
 
+    // rectangle of the current transfer between CPU and VRAM
+    struct VramTransfer {
+        u32 x = 0, y = 0;
+        u32 width = 0, height = 0;
+        // position of the next halfword inside of the rectangle
+        u32 column = 0, row = 0;
+    } vram_transfer;
+
     union {
         u32 value = 0;
 
@@ -236,10 +319,23 @@ private:
     System* sys = nullptr;
 
     std::unique_ptr<Renderer> renderer;
+    bool multithreaded_renderer = false;
+    bool gpu_thread = false;
 
     // TODO: is VRAM filled with garbage at boot?
     std::vector<u16> vram;
 
     // the actual output that gets displayed on the TV
     std::vector<u8> output;
+    // display area that output currently holds, a different area means that all of it has to be copied again
+    struct OutputArea {
+        u32 x = 0, y = 0;
+        u32 row_bytes = 0, height = 0;
+
+        bool operator==(const OutputArea& other) const = default;
+    } output_area;
+
+    // rows written since the last GetVideoOutput() and TakeDirtyVramRows() call
+    VramRows output_dirty_rows;
+    VramRows host_dirty_rows;
 };
\ No newline at end of file
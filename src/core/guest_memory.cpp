@@ -0,0 +1,252 @@
+#include "guest_memory.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cstdio>
+#endif
+
+#include "common/asserts.h"
+#include "common/log.h"
+
+LOG_CHANNEL(GuestMemory);
+
+namespace {
+
+// layout of the shared memory object
+constexpr u32 SHM_RAM_OFFSET = 0;
+constexpr u32 SHM_BIOS_OFFSET = SHM_RAM_OFFSET + GuestMemory::RAM_SIZE;
+constexpr u32 SHM_SCRATCH_OFFSET = SHM_BIOS_OFFSET + GuestMemory::BIOS_SIZE;
+constexpr u32 SHM_SIZE = SHM_SCRATCH_OFFSET + GuestMemory::PAGE_SIZE;
+
+// the signal handler has to find the instance a fault belongs to, it can't take a lock or walk a container that
+// might get reallocated, so every instance with write protection claims one of a few fixed slots
+constexpr u32 MAX_INSTANCES = 8;
+std::array<std::atomic<GuestMemory*>, MAX_INSTANCES> instances = {};
+static_assert(std::atomic<GuestMemory*>::is_always_lock_free && std::atomic<u64>::is_always_lock_free);
+
+bool ClaimInstanceSlot(GuestMemory* memory) {
+    for (auto& slot : instances) {
+        GuestMemory* expected = nullptr;
+        if (slot.compare_exchange_strong(expected, memory)) return true;
+    }
+    return false;
+}
+
+void ReleaseInstanceSlot(GuestMemory* memory) {
+    for (auto& slot : instances) {
+        GuestMemory* expected = memory;
+        slot.compare_exchange_strong(expected, nullptr);
+    }
+}
+
+#ifndef _WIN32
+struct sigaction previous_segv_action = {};
+struct sigaction previous_bus_action = {};
+bool signal_handler_installed = false;
+
+void ForwardSignal(const struct sigaction& action, int signal, siginfo_t* info, void* context) {
+    if (action.sa_flags & SA_SIGINFO) {
+        action.sa_sigaction(signal, info, context);
+        return;
+    }
+
+    if (action.sa_handler == SIG_DFL || action.sa_handler == SIG_IGN) {
+        // the faulting instruction gets executed again and terminates the process
+        struct sigaction default_action = {};
+        default_action.sa_handler = SIG_DFL;
+        sigemptyset(&default_action.sa_mask);
+        sigaction(signal, &default_action, nullptr);
+        return;
+    }
+
+    action.sa_handler(signal);
+}
+
+void SignalHandler(int signal, siginfo_t* info, void* context) {
+    if (GuestMemory::DispatchWriteFault(info->si_addr)) return;
+
+    ForwardSignal(signal == SIGBUS ? previous_bus_action : previous_segv_action, signal, info, context);
+}
+
+void InstallSignalHandler() {
+    if (signal_handler_installed) return;
+
+    struct sigaction action = {};
+    action.sa_sigaction = SignalHandler;
+    action.sa_flags = SA_SIGINFO;
+    sigemptyset(&action.sa_mask);
+
+    sigaction(SIGSEGV, &action, &previous_segv_action);
+#ifdef __APPLE__
+    // write faults on shared mappings raise SIGBUS on macOS
+    sigaction(SIGBUS, &action, &previous_bus_action);
+#endif
+
+    signal_handler_installed = true;
+}
+#endif
+
+}    // namespace
+
+GuestMemory::GuestMemory() {
+    if (!MapShared()) {
+        LogWarn("Failed to map the guest address space, RAM mirrors and write protection are disabled");
+        Release();
+        MapPrivate();
+    }
+
+    if (write_protection && !ClaimInstanceSlot(this)) {
+        LogWarn("Too many guest address spaces, write protection is disabled");
+        write_protection = false;
+    }
+#ifndef _WIN32
+    if (write_protection) InstallSignalHandler();
+#endif
+}
+
+GuestMemory::~GuestMemory() {
+    ReleaseInstanceSlot(this);
+    Release();
+}
+
+bool GuestMemory::MapShared() {
+#ifdef _WIN32
+    return false;
+#else
+#ifdef __linux__
+    shm_fd = memfd_create("frustration-guest-memory", 0);
+#else
+    char name[64];
+    std::snprintf(name, sizeof(name), "/frustration-%d-%p", static_cast<int>(getpid()), static_cast<void*>(this));
+    shm_fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (shm_fd >= 0) shm_unlink(name);
+#endif
+    if (shm_fd < 0 || ftruncate(shm_fd, SHM_SIZE) != 0) return false;
+
+    // reserve the whole physical address space, only the mapped regions are accessible
+    void* reserved = mmap(nullptr, ADDRESS_SPACE_SIZE, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (reserved == MAP_FAILED) return false;
+    base = static_cast<u8*>(reserved);
+
+    const auto MapView = [this](u8* address, u32 size, u32 offset, int protection) {
+        return mmap(address, size, protection, MAP_SHARED | MAP_FIXED, shm_fd, offset) != MAP_FAILED;
+    };
+
+    for (u32 mirror = 0; mirror < RAM_MIRROR_COUNT; mirror++) {
+        if (!MapView(base + mirror * RAM_SIZE, RAM_SIZE, SHM_RAM_OFFSET, PROT_READ | PROT_WRITE)) return false;
+    }
+    if (!MapView(base + SCRATCH_START, PAGE_SIZE, SHM_SCRATCH_OFFSET, PROT_READ | PROT_WRITE)) return false;
+    if (!MapView(base + BIOS_START, BIOS_SIZE, SHM_BIOS_OFFSET, PROT_READ)) return false;
+
+    void* alias = mmap(nullptr, BIOS_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, SHM_BIOS_OFFSET);
+    if (alias == MAP_FAILED) return false;
+    bios_alias = static_cast<u8*>(alias);
+
+    ram_mirrored = true;
+    // protecting single guest pages requires 4 KiB host pages
+    write_protection = sysconf(_SC_PAGESIZE) == PAGE_SIZE;
+
+    LogDebug("Mapped guest address space at {}", static_cast<void*>(base));
+    return true;
+#endif
+}
+
+void GuestMemory::MapPrivate() {
+#ifdef _WIN32
+    base = static_cast<u8*>(VirtualAlloc(nullptr, ADDRESS_SPACE_SIZE, MEM_RESERVE, PAGE_NOACCESS));
+    if (!base) Panic("Failed to reserve the guest address space");
+
+    bool success = VirtualAlloc(base, RAM_SIZE, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+    success &= VirtualAlloc(base + SCRATCH_START, PAGE_SIZE, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+    success &= VirtualAlloc(base + BIOS_START, BIOS_SIZE, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+#else
+    void* reserved = mmap(nullptr, ADDRESS_SPACE_SIZE, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (reserved == MAP_FAILED) Panic("Failed to reserve the guest address space");
+    base = static_cast<u8*>(reserved);
+
+    bool success = mprotect(base, RAM_SIZE, PROT_READ | PROT_WRITE) == 0;
+    success &= mprotect(base + SCRATCH_START, PAGE_SIZE, PROT_READ | PROT_WRITE) == 0;
+    success &= mprotect(base + BIOS_START, BIOS_SIZE, PROT_READ | PROT_WRITE) == 0;
+#endif
+    if (!success) Panic("Failed to commit guest memory");
+
+    bios_alias = base + BIOS_START;
+}
+
+void GuestMemory::Release() {
+#ifdef _WIN32
+    if (base) VirtualFree(base, 0, MEM_RELEASE);
+#else
+    if (bios_alias && bios_alias != base + BIOS_START) munmap(bios_alias, BIOS_SIZE);
+    // also removes all views inside the reserved range
+    if (base) munmap(base, ADDRESS_SPACE_SIZE);
+    if (shm_fd >= 0) close(shm_fd);
+#endif
+
+    base = nullptr;
+    bios_alias = nullptr;
+    shm_fd = -1;
+    ram_mirrored = false;
+    write_protection = false;
+    protected_pages = {};
+    TakeDirtyPages();
+}
+
+void GuestMemory::SetRAMPageWriteProtection(u32 page, bool write_protected) {
+    DebugAssert(page < RAM_PAGE_COUNT);
+    if (!write_protection || protected_pages[page] == write_protected) return;
+
+    protected_pages[page] = write_protected;
+#ifndef _WIN32
+    const int protection = write_protected ? PROT_READ : (PROT_READ | PROT_WRITE);
+    for (u32 mirror = 0; mirror < RAM_MIRROR_COUNT; mirror++) {
+        if (mprotect(base + mirror * RAM_SIZE + page * PAGE_SIZE, PAGE_SIZE, protection) != 0)
+            Panic("Failed to change the protection of RAM page {}", page);
+    }
+#endif
+}
+
+GuestMemory::PageBits GuestMemory::TakeDirtyPages() {
+    has_dirty_pages.store(false, std::memory_order_relaxed);
+
+    PageBits pages;
+    for (u32 i = 0; i < pages.size(); i++) pages[i] = dirty_pages[i].exchange(0, std::memory_order_relaxed);
+    return pages;
+}
+
+bool GuestMemory::DispatchWriteFault(const void* address) {
+    const u8* fault_address = static_cast<const u8*>(address);
+    for (const auto& slot : instances) {
+        GuestMemory* memory = slot.load(std::memory_order_acquire);
+        if (memory && memory->HandleWriteFault(fault_address)) return true;
+    }
+    return false;
+}
+
+bool GuestMemory::HandleWriteFault(const u8* address) {
+    if (!write_protection || address < base || address >= base + RAM_SIZE * RAM_MIRROR_COUNT) return false;
+
+    const u32 page = static_cast<u32>((address - base) & (RAM_SIZE - 1)) >> PAGE_SHIFT;
+    if (!protected_pages[page]) return false;
+
+#ifndef _WIN32
+    // runs inside the signal handler: no allocations, no locks, no logging, just mark the page and let the write
+    // through, the owner of the protection picks the mark up once the store is done
+    dirty_pages[page / 64].fetch_or(u64(1) << (page % 64), std::memory_order_relaxed);
+    has_dirty_pages.store(true, std::memory_order_relaxed);
+
+    for (u32 mirror = 0; mirror < RAM_MIRROR_COUNT; mirror++) {
+        if (mprotect(base + mirror * RAM_SIZE + page * PAGE_SIZE, PAGE_SIZE, PROT_READ | PROT_WRITE) != 0) return false;
+    }
+    // the write gets retried once the handler returns
+    return true;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+
+#include "util/types.h"
+
+// Host virtual memory region that mirrors the 512 MiB physical address space of the PS1.
+// RAM, scratchpad and BIOS live at their physical offsets, so any direct access is just base + physical address.
+// On POSIX hosts the memory is backed by a shared memory object, which allows mapping the four RAM mirrors
+// and a read-only BIOS view. RAM pages can be write-protected, writes to them then trap into a SIGSEGV handler.
+// The handler only marks the page as dirty and makes it writable again before the write gets retried,
+// everything else (like dropping the code of the page) happens outside of the signal handler.
+class GuestMemory {
+public:
+    GuestMemory();
+    ~GuestMemory();
+
+    GuestMemory(const GuestMemory&) = delete;
+    GuestMemory& operator=(const GuestMemory&) = delete;
+
+    // start of the physical address space
+    ALWAYS_INLINE u8* Base() { return base; }
+
+    ALWAYS_INLINE u8* RAM() { return base; }
+    ALWAYS_INLINE u8* Scratchpad() { return base + SCRATCH_START; }
+    // the BIOS is read-only through Base(), this is a writable alias for loading and patching
+    ALWAYS_INLINE u8* BIOS() { return bios_alias; }
+
+    // all four RAM mirrors are mapped onto the same host memory
+    bool RAMMirrored() const { return ram_mirrored; }
+    bool SupportsWriteProtection() const { return write_protection; }
+
+    // expects a RAM page index (physical address >> PAGE_SHIFT within the first 2 MiB)
+    void SetRAMPageWriteProtection(u32 page, bool write_protected);
+
+    // called from the signal handler, returns false if the address doesn't belong to a protected RAM page
+    static bool DispatchWriteFault(const void* address);
+
+    static constexpr u32 ADDRESS_SPACE_SIZE = 512 * 1024 * 1024;
+    static constexpr u32 RAM_SIZE = 2048 * 1024;
+    static constexpr u32 RAM_MIRROR_COUNT = 4;
+    static constexpr u32 SCRATCH_START = 0x1F800000;
+    static constexpr u32 BIOS_START = 0x1FC00000;
+    static constexpr u32 BIOS_SIZE = 512 * 1024;
+
+    static constexpr u32 PAGE_SHIFT = 12;
+    static constexpr u32 PAGE_SIZE = 1 << PAGE_SHIFT;
+    static constexpr u32 RAM_PAGE_COUNT = RAM_SIZE >> PAGE_SHIFT;
+
+    // protected pages that got written to, one bit per page
+    using PageBits = std::array<u64, RAM_PAGE_COUNT / 64>;
+    ALWAYS_INLINE bool HasDirtyPages() const { return has_dirty_pages.load(std::memory_order_relaxed); }
+    // returns the dirty pages and clears the marks, the pages are writable but still count as protected
+    // until SetRAMPageWriteProtection gets called for them
+    PageBits TakeDirtyPages();
+
+private:
+    bool MapShared();
+    void MapPrivate();
+    void Release();
+
+    bool HandleWriteFault(const u8* address);
+
+    u8* base = nullptr;
+    u8* bios_alias = nullptr;
+    int shm_fd = -1;
+
+    bool ram_mirrored = false;
+    bool write_protection = false;
+
+    std::array<bool, RAM_PAGE_COUNT> protected_pages = {};
+    // written by the signal handler, lock-free atomics are the only shared state it touches
+    std::array<std::atomic<u64>, RAM_PAGE_COUNT / 64> dirty_pages = {};
+    std::atomic<bool> has_dirty_pages = false;
+};
@@ -0,0 +1,64 @@
+#include "profiler.h"
+
+#include "common/asserts.h"
+#include "common/log.h"
+
+LOG_CHANNEL(Profiler);
+
+void Profiler::Start() {
+    totals = {};
+    current = Category::CPU;
+    depth = 0;
+    last_switch = Clock::now();
+    enabled = true;
+}
+
+void Profiler::Stop() {
+    if (!enabled) return;
+
+    SwitchTo(Category::CPU);
+    enabled = false;
+}
+
+double Profiler::Seconds(Category category) const {
+    DebugAssert(category < Category::Count);
+    return std::chrono::duration<double>(totals[static_cast<u32>(category)]).count();
+}
+
+double Profiler::TotalSeconds() const {
+    Clock::duration total = {};
+    for (const auto& duration : totals) total += duration;
+    return std::chrono::duration<double>(total).count();
+}
+
+const char* Profiler::CategoryName(Category category) {
+    switch (category) {
+        case Category::CPU: return "CPU";
+        case Category::GPU: return "GPU";
+        case Category::GTE: return "GTE";
+        case Category::DMA: return "DMA";
+        case Category::Scheduler: return "Scheduler";
+        default: return "Unknown";
+    }
+}
+
+void Profiler::Enter(Category category) {
+    DebugAssert(depth < MAX_DEPTH);
+
+    stack[depth++] = current;
+    SwitchTo(category);
+}
+
+void Profiler::Leave() {
+    // the profiler got stopped and restarted while the scope was open
+    if (!enabled || depth == 0) return;
+
+    SwitchTo(stack[--depth]);
+}
+
+void Profiler::SwitchTo(Category category) {
+    const auto now = Clock::now();
+    totals[static_cast<u32>(current)] += now - last_switch;
+    last_switch = now;
+    current = category;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+
+#include "util/types.h"
+
+// Splits the host time spent inside the emulation loop between the emulated subsystems.
+// Scopes can be nested, time spent inside a nested scope only counts towards the innermost one
+// (e.g. GPU commands sent by a DMA transfer). Everything outside of a scope counts as CPU time.
+// Profiling is disabled by default, a scope then only checks a flag.
+class Profiler {
+public:
+    enum class Category : u32 { CPU, GPU, GTE, DMA, Scheduler, Count };
+    static constexpr u32 CATEGORY_COUNT = static_cast<u32>(Category::Count);
+
+    class Scope {
+    public:
+        ALWAYS_INLINE Scope(Profiler& profiler, Category category) : profiler(profiler.enabled ? &profiler : nullptr) {
+            if (this->profiler) [[unlikely]] this->profiler->Enter(category);
+        }
+        ALWAYS_INLINE ~Scope() {
+            if (profiler) [[unlikely]] profiler->Leave();
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        Profiler* profiler = nullptr;
+    };
+
+    // discards all previous results and starts attributing time to the CPU
+    // has to be called outside of any scope
+    void Start();
+    void Stop();
+
+    bool Enabled() const { return enabled; }
+
+    double Seconds(Category category) const;
+    double TotalSeconds() const;
+
+    static const char* CategoryName(Category category);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    void Enter(Category category);
+    void Leave();
+    // adds the time since the last switch to the current category
+    void SwitchTo(Category category);
+
+    static constexpr u32 MAX_DEPTH = 8;
+
+    bool enabled = false;
+
+    Category current = Category::CPU;
+    std::array<Category, MAX_DEPTH> stack = {};
+    u32 depth = 0;
+
+    Clock::time_point last_switch = {};
+    std::array<Clock::duration, CATEGORY_COUNT> totals = {};
+};
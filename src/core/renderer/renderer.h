@@ -1,5 +1,8 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+
 #include "util/types.h"
 
 // TODO: improve the design of these structs
@@ -38,12 +41,67 @@ struct Rectangle {
 
 enum class RectSize : u32 { ONE, EIGHT, SIXTEEN, VARIABLE };
 
+// Inclusive rectangle in VRAM coordinates
+struct VramRect {
+    s32 left = 0, top = 0;
+    s32 right = -1, bottom = -1;
+
+    ALWAYS_INLINE bool Empty() const { return left > right || top > bottom; }
+    ALWAYS_INLINE bool Intersects(const VramRect& other) const {
+        return !Empty() && !other.Empty() && left <= other.right && other.left <= right && top <= other.bottom &&
+               other.top <= bottom;
+    }
+    ALWAYS_INLINE VramRect Union(const VramRect& other) const {
+        if (Empty()) return other;
+        if (other.Empty()) return *this;
+        return {std::min(left, other.left), std::min(top, other.top), std::max(right, other.right),
+                std::max(bottom, other.bottom)};
+    }
+};
+
+// Snapshot of everything a backend needs to draw a single primitive.
+// Lines get split into one command per segment.
+struct DrawCommand {
+    u32 cmd = 0;
+
+    std::array<Vertex, 4> vertices = {};
+    Rectangle rectangle = {};
+
+    // texture page
+    u8 tex_page_x_base = 0, tex_page_y_base = 0;
+    u8 tex_page_colors = 0;
+    u8 semi_transparency = 0;
+    bool tex_rectangle_xflip = false, tex_rectangle_yflip = false;
+    u16 clut = 0;
+
+    u8 tex_window_x_mask = 0, tex_window_y_mask = 0;
+    u8 tex_window_x_offset = 0, tex_window_y_offset = 0;
+
+    u16 drawing_area_left = 0, drawing_area_top = 0;
+    u16 drawing_area_right = 0, drawing_area_bottom = 0;
+    s16 drawing_x_offset = 0, drawing_y_offset = 0;
+
+    // decoded copy of a paletted texture (see TextureCache), filled in by the renderer,
+    // the texture gets sampled from VRAM if it is not set
+    const u16* texture = nullptr;
+
+    // lines never sample textures
+    ALWAYS_INLINE bool IsTextured() const { return (cmd >> 29) != 2 && (cmd & (1u << 26)) != 0; }
+};
+
 // Base class for a render backend
 class Renderer {
 public:
     virtual ~Renderer() = default;
 
-    virtual void Draw(u32 cmd) = 0;
+    virtual const char* Name() const = 0;
+
+    virtual void Draw(const DrawCommand& command) = 0;
+
+    // blocks until all previously submitted commands are visible in VRAM,
+    // has to be called before anything else reads or writes VRAM
+    virtual void Sync() {}
 
-    virtual void DrawImguiRendererState(bool* open) = 0;
+    // VRAM inside of the area was written without going through the renderer, only valid after Sync()
+    virtual void InvalidateVram(const VramRect& /* area */) {}
 };
@@ -0,0 +1,150 @@
+#include "renderer_mt.h"
+
+#include <algorithm>
+
+#include "common/asserts.h"
+#include "common/log.h"
+#include "gpu.h"
+
+LOG_CHANNEL(Renderer);
+
+Renderer_MT::Renderer_MT(u16* vram, u32 worker_count) : rasterizer(vram) {
+    static_assert(TILES_X * TILE_WIDTH == GPU::VRAM_WIDTH && TILES_Y * TILE_HEIGHT == GPU::VRAM_HEIGHT);
+
+    if (worker_count == 0) worker_count = std::max(std::thread::hardware_concurrency(), 1u) - 1;
+
+    commands.reserve(MAX_COMMANDS);
+    active_tiles.reserve(TILE_COUNT);
+
+    workers.reserve(worker_count);
+    for (u32 i = 0; i < worker_count; i++) workers.emplace_back(&Renderer_MT::WorkerThread, this);
+
+    LogInfo("Rasterizing with {} worker threads", worker_count);
+}
+
+Renderer_MT::~Renderer_MT() {
+    // VRAM has to be complete in case another backend takes over
+    Flush();
+
+    {
+        std::lock_guard lock(mutex);
+        shutdown = true;
+    }
+    work_available.notify_all();
+
+    for (auto& worker : workers) worker.join();
+}
+
+void Renderer_MT::Draw(const DrawCommand& command) {
+    const VramRect bounds = Renderer_SW::DrawBounds(command);
+    if (bounds.Empty()) return;
+
+    // overwrites a texture that pending commands still have to sample
+    if (bounds.Intersects(pending_textures)) Flush();
+
+    if (command.IsTextured()) {
+        const auto sources = Renderer_SW::TextureBounds(command);
+
+        // render-to-texture, the texture has to be finished before it can be sampled
+        if (sources[0].Intersects(pending_area) || sources[1].Intersects(pending_area)) Flush();
+
+        // a primitive that samples its own output depends on the order of the pixels, so it can not be split up
+        if (Renderer_SW::SamplesOwnOutput(command, bounds)) {
+            Flush();
+            rasterizer.Draw(command);
+            return;
+        }
+
+        // pending commands still point to the decoded textures
+        if (rasterizer.CachedTextureEvicts(command)) Flush();
+
+        pending_textures = pending_textures.Union(sources[0]).Union(sources[1]);
+    }
+
+    const u32 index = static_cast<u32>(commands.size());
+    DrawCommand& recorded = commands.emplace_back(command);
+    recorded.texture = rasterizer.CachedTexture(command);
+
+    for (u32 tile_y = bounds.top / TILE_HEIGHT; tile_y <= bounds.bottom / TILE_HEIGHT; tile_y++) {
+        for (u32 tile_x = bounds.left / TILE_WIDTH; tile_x <= bounds.right / TILE_WIDTH; tile_x++) {
+            const u32 tile = tile_y * TILES_X + tile_x;
+            if (bins[tile].empty()) active_tiles.push_back(tile);
+            bins[tile].push_back(index);
+        }
+    }
+
+    pending_area = pending_area.Union(bounds);
+    // a texture that overlaps with this command can only be decoded again after a flush (see above)
+    rasterizer.InvalidateVram(bounds);
+
+    if (commands.size() >= MAX_COMMANDS) Flush();
+}
+
+void Renderer_MT::Sync() {
+    Flush();
+}
+
+void Renderer_MT::InvalidateVram(const VramRect& area) {
+    DebugAssert(commands.empty());
+    rasterizer.InvalidateVram(area);
+}
+
+void Renderer_MT::Flush() {
+    if (commands.empty()) return;
+
+    next_tile = 0;
+
+    if (workers.empty() || active_tiles.size() < MIN_PARALLEL_TILES) {
+        RasterizeTiles();
+    } else {
+        {
+            std::lock_guard lock(mutex);
+            batch++;
+            busy_workers = static_cast<u32>(workers.size());
+        }
+        work_available.notify_all();
+
+        RasterizeTiles();
+
+        std::unique_lock lock(mutex);
+        work_done.wait(lock, [this] { return busy_workers == 0; });
+    }
+
+    for (u32 tile : active_tiles) bins[tile].clear();
+    active_tiles.clear();
+    commands.clear();
+    pending_area = {};
+    pending_textures = {};
+}
+
+void Renderer_MT::WorkerThread() {
+    u64 last_batch = 0;
+
+    while (true) {
+        {
+            std::unique_lock lock(mutex);
+            work_available.wait(lock, [&] { return shutdown || batch != last_batch; });
+            if (shutdown) return;
+            last_batch = batch;
+        }
+
+        RasterizeTiles();
+
+        {
+            std::lock_guard lock(mutex);
+            DebugAssert(busy_workers > 0);
+            if (--busy_workers == 0) work_done.notify_one();
+        }
+    }
+}
+
+void Renderer_MT::RasterizeTiles() {
+    for (u32 i = next_tile.fetch_add(1); i < active_tiles.size(); i = next_tile.fetch_add(1)) {
+        const u32 tile = active_tiles[i];
+        const s32 left = static_cast<s32>((tile % TILES_X) * TILE_WIDTH);
+        const s32 top = static_cast<s32>((tile / TILES_X) * TILE_HEIGHT);
+        const VramRect clip = {left, top, left + s32(TILE_WIDTH) - 1, top + s32(TILE_HEIGHT) - 1};
+
+        for (u32 index : bins[tile]) rasterizer.Rasterize(commands[index], clip);
+    }
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "renderer/renderer.h"
+#include "renderer/renderer_sw.h"
+#include "util/types.h"
+
+// Software rasterizer that spreads the work over multiple threads.
+// Draw commands only get recorded and sorted into the VRAM tiles they touch. Once a sync point is reached,
+// the tiles get rasterized in parallel, every tile runs through its commands in submission order.
+// Commands that sample textures from an area that still has pending draws, or that draw over a texture
+// that pending commands still sample, force an early flush.
+class Renderer_MT : public Renderer {
+public:
+    // the emulation thread helps out with rasterizing,
+    // a worker count of 0 starts one worker for every other host core
+    explicit Renderer_MT(u16* vram, u32 worker_count = 0);
+    ~Renderer_MT() override;
+
+    const char* Name() const override { return "Multithreaded Software Renderer (MT)"; }
+
+    void Draw(const DrawCommand& command) override;
+    void Sync() override;
+    void InvalidateVram(const VramRect& area) override;
+
+    Renderer_MT(const Renderer_MT&) = delete;
+    Renderer_MT& operator=(const Renderer_MT&) = delete;
+
+private:
+    static constexpr u32 TILE_WIDTH = 64;
+    static constexpr u32 TILE_HEIGHT = 32;
+    static constexpr u32 TILES_X = 1024 / TILE_WIDTH;
+    static constexpr u32 TILES_Y = 512 / TILE_HEIGHT;
+    static constexpr u32 TILE_COUNT = TILES_X * TILES_Y;
+
+    // upper bound for the size of the command list, flushes early if a frame has more
+    static constexpr u32 MAX_COMMANDS = 16 * 1024;
+    // smaller batches are not worth waking up the workers
+    static constexpr u32 MIN_PARALLEL_TILES = 2;
+
+    void Flush();
+
+    void WorkerThread();
+    // rasterizes tiles until there are none left in the current batch
+    void RasterizeTiles();
+
+    Renderer_SW rasterizer;
+
+    std::vector<DrawCommand> commands;
+    // indices into the command list for every tile
+    std::array<std::vector<u32>, TILE_COUNT> bins = {};
+    // tiles with at least one command, in the order they were touched
+    std::vector<u32> active_tiles;
+    // union of the areas of all pending commands
+    VramRect pending_area = {};
+    // union of the texture pages and CLUTs sampled by pending commands
+    VramRect pending_textures = {};
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable work_available;
+    std::condition_variable work_done;
+    // incremented for every batch handed to the workers
+    u64 batch = 0;
+    u32 busy_workers = 0;
+    bool shutdown = false;
+
+    std::atomic<u32> next_tile = 0;
+};
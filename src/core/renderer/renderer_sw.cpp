@@ -2,28 +2,26 @@
 
 #include <algorithm>
 #include <tuple>
+#include <utility>
 
 #include "common/asserts.h"
 #include "common/log.h"
 #include "gpu.h"
-#include "imgui.h"
-#include "system.h"
+#include "util/simd.h"
 
 LOG_CHANNEL(Renderer);
 
-Renderer_SW::Renderer_SW(GPU* gpu) : gpu(gpu) {
-    LogInfo("Graphics backend: Software Renderer (SW)");
-}
+Renderer_SW::Renderer_SW(u16* vram) : vram(vram), texture_cache(vram) {}
 
-static constexpr s32 EdgeFunction(Vertex* v0, Vertex* v1, Vertex* v2) {
+static constexpr s32 EdgeFunction(const Vertex* v0, const Vertex* v1, const Vertex* v2) {
     return (s32)((v1->x - v0->x) * (v2->y - v0->y) - (v1->y - v0->y) * (v2->x - v0->x));
 }
 
-static constexpr s32 EdgeFunction(Vertex* v0, Vertex* v1, s16 px, s16 py) {
+static constexpr s32 EdgeFunction(const Vertex* v0, const Vertex* v1, s16 px, s16 py) {
     return (s32)((v1->x - v0->x) * (py - v0->y) - (v1->y - v0->y) * (px - v0->x));
 }
 
-static constexpr Color BlendTexture(Color& tx_color, Color& blend_color) {
+static constexpr Color BlendTexture(const Color& tx_color, const Color& blend_color) {
     Color blend = {};
     blend.r = u8(std::min(((u32(tx_color.r) * u32(blend_color.r)) / 128u), 255u));
     blend.g = u8(std::min(((u32(tx_color.g) * u32(blend_color.g)) / 128u), 255u));
@@ -59,20 +57,166 @@ static constexpr Color CalcSemiTransparency(u32 mode, Color& back, Color& front)
     return c;
 }
 
+// Evaluates floor((a0 * w12 + a1 * w20 + a2 * w01) / area) for consecutive pixels of a span.
+// The numerator changes by a constant amount per pixel, so instead of dividing for every pixel
+// the quotient and remainder get stepped. All weights are positive inside of the triangle,
+// which makes the result identical to the truncating division.
+struct AttributeStepper {
+    s32 value = 0;
+    s32 remainder = 0;
+
+    s32 step_value = 0;
+    s32 step_remainder = 0;
+    s32 area = 1;
+
+    // expects a positive divisor, rounds towards negative infinity
+    static constexpr std::pair<s64, s64> FloorDivide(s64 dividend, s64 divisor) {
+        s64 quotient = dividend / divisor, rest = dividend % divisor;
+        if (rest < 0) rest += divisor, quotient--;
+        return {quotient, rest};
+    }
+
+    ALWAYS_INLINE void SetStep(s64 step, s32 triangle_area) {
+        area = triangle_area;
+        const auto [quotient, rest] = FloorDivide(step, area);
+        step_value = s32(quotient), step_remainder = s32(rest);
+    }
+
+    ALWAYS_INLINE void Start(s64 numerator) {
+        const auto [quotient, rest] = FloorDivide(numerator, area);
+        value = s32(quotient), remainder = s32(rest);
+    }
+
+    ALWAYS_INLINE void Step() {
+        value += step_value;
+        remainder += step_remainder;
+        if (remainder >= area) {
+            remainder -= area;
+            value++;
+        }
+    }
+};
+
+// narrows [first, last] down to the offsets from the start of the row at which the edge weight (w + A * offset)
+// is positive, returns false if the range is empty
+static ALWAYS_INLINE bool ClipSpan(s32 w, s32 A, s32& first, s32& last) {
+    if (A > 0) {
+        // weight grows to the right
+        if (w < 0) first = static_cast<s32>(std::max<s64>(first, (-s64(w) + A - 1) / A));
+    } else if (A < 0) {
+        // weight shrinks to the right
+        if (w < 0) return false;
+        last = static_cast<s32>(std::min<s64>(last, s64(w) / -A));
+    } else if (w < 0) {
+        return false;
+    }
+
+    return first <= last;
+}
+
+#ifdef USE_SSE2
+// steps eight consecutive pixels of an attribute at once
+struct AttributeStepperX8 {
+    __m128i value[2], remainder[2];
+    __m128i step_value, step_remainder;
+    __m128i area, area_minus_one;
+
+    explicit AttributeStepperX8(const AttributeStepper& attribute) {
+        alignas(16) s32 values[8], remainders[8];
+        AttributeStepper lane = attribute;
+        for (u32 i = 0; i < 8; i++) {
+            values[i] = lane.value, remainders[i] = lane.remainder;
+            lane.Step();
+        }
+
+        for (u32 i = 0; i < 2; i++) {
+            value[i] = _mm_load_si128(reinterpret_cast<const __m128i*>(values + i * 4));
+            remainder[i] = _mm_load_si128(reinterpret_cast<const __m128i*>(remainders + i * 4));
+        }
+
+        // 8 * step = 8 * step_value * area + 8 * step_remainder
+        const auto [quotient, rest] = AttributeStepper::FloorDivide(s64(attribute.step_remainder) * 8, attribute.area);
+        step_value = _mm_set1_epi32(attribute.step_value * 8 + s32(quotient));
+        step_remainder = _mm_set1_epi32(s32(rest));
+        area = _mm_set1_epi32(attribute.area);
+        area_minus_one = _mm_set1_epi32(attribute.area - 1);
+    }
+
+    ALWAYS_INLINE void Step() {
+        for (u32 i = 0; i < 2; i++) {
+            value[i] = _mm_add_epi32(value[i], step_value);
+            remainder[i] = _mm_add_epi32(remainder[i], step_remainder);
+            // all bits set in lanes where the remainder overflowed
+            const __m128i carry = _mm_cmpgt_epi32(remainder[i], area_minus_one);
+            remainder[i] = _mm_sub_epi32(remainder[i], _mm_and_si128(carry, area));
+            value[i] = _mm_sub_epi32(value[i], carry);
+        }
+    }
+
+    // state of the first lane, which is the next pixel after the last full step
+    void Store(AttributeStepper& attribute) const {
+        attribute.value = _mm_cvtsi128_si32(value[0]);
+        attribute.remainder = _mm_cvtsi128_si32(remainder[0]);
+    }
+};
+
+// converts eight 8-bit colors (one component per 32-bit lane) into eight 15-bit colors with the mask bit set
+static ALWAYS_INLINE __m128i To5551X8(const __m128i (&r)[2], const __m128i (&g)[2], const __m128i (&b)[2]) {
+    __m128i packed[2];
+    for (u32 i = 0; i < 2; i++) {
+        const __m128i r5 = _mm_srli_epi32(r[i], 3);
+        const __m128i g5 = _mm_slli_epi32(_mm_srli_epi32(g[i], 3), 5);
+        const __m128i b5 = _mm_slli_epi32(_mm_srli_epi32(b[i], 3), 10);
+        packed[i] = _mm_or_si128(_mm_or_si128(r5, g5), b5);
+    }
+    // all values fit into 15 bits, so the signed saturation never kicks in
+    return _mm_or_si128(_mm_packs_epi32(packed[0], packed[1]), _mm_set1_epi16(s16(0x8000)));
+}
+#endif
+
+// writes a span of gouraud shaded pixels
+static void DrawShadedSpan(u16* span, s32 count, AttributeStepper& r, AttributeStepper& g, AttributeStepper& b) {
+    s32 i = 0;
+
+#ifdef USE_SSE2
+    // the vectorized remainders have to stay below 2^31
+    if (count >= 8 && r.area < (1 << 30)) {
+        AttributeStepperX8 r8(r), g8(g), b8(b);
+        for (; i + 8 <= count; i += 8) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(span + i), To5551X8(r8.value, g8.value, b8.value));
+            r8.Step();
+            g8.Step();
+            b8.Step();
+        }
+        r8.Store(r);
+        g8.Store(g);
+        b8.Store(b);
+    }
+#endif
+
+    for (; i < count; i++) {
+        const Color color = {.r = u8(r.value), .g = u8(g.value), .b = u8(b.value)};
+        span[i] = color.To5551();
+        r.Step();
+        g.Step();
+        b.Step();
+    }
+}
+
 #define DRAW_FLAGS_SET(flags) ((draw_flags & (flags)) != 0)
 
 template<u32 draw_flags>
-void Renderer_SW::DrawTriangle() {
+void Renderer_SW::DrawTriangle(const DrawCommand& command, const VramRect& clip) const {
     // made possible by Fabian Giesen's great series of articles about software rasterizers
     // starting with:
     // https://fgiesen.wordpress.com/2013/02/06/the-barycentric-conspirac/
 
     // fetch the vertices
-    Vertex *v0, *v1, *v2;
+    const Vertex *v0, *v1, *v2;
     if constexpr (DRAW_FLAGS_SET(SECOND_TRIANGLE)) {
-        v0 = &gpu->vertices[1], v1 = &gpu->vertices[2], v2 = &gpu->vertices[3];
+        v0 = &command.vertices[1], v1 = &command.vertices[2], v2 = &command.vertices[3];
     } else {
-        v0 = &gpu->vertices[0], v1 = &gpu->vertices[1], v2 = &gpu->vertices[2];
+        v0 = &command.vertices[0], v1 = &command.vertices[1], v2 = &command.vertices[2];
     }
 
     // make sure vertices are oriented counter-clockwise
@@ -87,10 +231,15 @@ void Renderer_SW::DrawTriangle() {
 
     // clip against drawing area
     // origin is top-left
-    minX = std::clamp<s32>(minX + gpu->drawing_x_offset, gpu->drawing_area_left, gpu->drawing_area_right);
-    maxX = std::clamp<s32>(maxX + gpu->drawing_x_offset, gpu->drawing_area_left, gpu->drawing_area_right);
-    minY = std::clamp<s32>(minY + gpu->drawing_y_offset, gpu->drawing_area_top, gpu->drawing_area_bottom);
-    maxY = std::clamp<s32>(maxY + gpu->drawing_y_offset, gpu->drawing_area_top, gpu->drawing_area_bottom);
+    minX = std::clamp<s32>(minX + command.drawing_x_offset, command.drawing_area_left, command.drawing_area_right);
+    maxX = std::clamp<s32>(maxX + command.drawing_x_offset, command.drawing_area_left, command.drawing_area_right);
+    minY = std::clamp<s32>(minY + command.drawing_y_offset, command.drawing_area_top, command.drawing_area_bottom);
+    maxY = std::clamp<s32>(maxY + command.drawing_y_offset, command.drawing_area_top, command.drawing_area_bottom);
+
+    // coverage and attributes only depend on the pixel position, so clipping does not change the result
+    minX = std::max(minX, clip.left), maxX = std::min(maxX, clip.right);
+    minY = std::max(minY, clip.top), maxY = std::min(maxY, clip.bottom);
+    if (minX > maxX || minY > maxY) return;
 
     // prepare per-pixel increments
     const s32 A01 = v0->y - v1->y, B01 = v1->x - v0->x;
@@ -109,76 +258,102 @@ void Renderer_SW::DrawTriangle() {
     s32 w12_row = EdgeFunction(v1, v2, minX, minY);
     s32 w20_row = EdgeFunction(v2, v0, minX, minY);
 
+    // interpolated attributes only depend on the weights, so they change by a constant amount per pixel
+    AttributeStepper tex_x, tex_y, r, g, b;
+    const auto SetStep = [&](AttributeStepper& attribute, s32 a0, s32 a1, s32 a2) {
+        attribute.SetStep(s64(a0) * A12 + s64(a1) * A20 + s64(a2) * A01, area);
+    };
+    TextureSampler sampler;
+    if constexpr (DRAW_FLAGS_SET(TEXTURED)) {
+        sampler = MakeTextureSampler(command);
+        SetStep(tex_x, v0->tex_x, v1->tex_x, v2->tex_x);
+        SetStep(tex_y, v0->tex_y, v1->tex_y, v2->tex_y);
+    }
+    if constexpr (DRAW_FLAGS_SET(SHADED)) {
+        SetStep(r, v0->c.r, v1->c.r, v2->c.r);
+        SetStep(g, v0->c.g, v1->c.g, v2->c.g);
+        SetStep(b, v0->c.b, v1->c.b, v2->c.b);
+    }
+
     // main loop
     for (s32 py = minY; py <= maxY; py++) {
-        // weights at the start of the row
-        s32 w01 = w01_row;
-        s32 w12 = w12_row;
-        s32 w20 = w20_row;
+        // range of the row that is to the left of all edges
+        s32 first = 0, last = maxX - minX;
+        const bool inside = ClipSpan(w01_row, A01, first, last) && ClipSpan(w12_row, A12, first, last) &&
+                            ClipSpan(w20_row, A20, first, last);
+
+        if (inside) {
+            // weights at the start of the span
+            const s64 w01 = w01_row + s64(A01) * first;
+            const s64 w12 = w12_row + s64(A12) * first;
+            const s64 w20 = w20_row + s64(A20) * first;
+
+            const auto Start = [&](AttributeStepper& attribute, s32 a0, s32 a1, s32 a2) {
+                attribute.Start(a0 * w12 + a1 * w20 + a2 * w01);
+            };
+            if constexpr (DRAW_FLAGS_SET(TEXTURED)) {
+                Start(tex_x, v0->tex_x, v1->tex_x, v2->tex_x);
+                Start(tex_y, v0->tex_y, v1->tex_y, v2->tex_y);
+            }
+            if constexpr (DRAW_FLAGS_SET(SHADED)) {
+                Start(r, v0->c.r, v1->c.r, v2->c.r);
+                Start(g, v0->c.g, v1->c.g, v2->c.g);
+                Start(b, v0->c.b, v1->c.b, v2->c.b);
+            }
 
-        for (s32 px = minX; px <= maxX; px++) {
-            // check if point is to the left of all edges
-            // just use the sign bits
-            if ((w01 | w12 | w20) >= 0) {
-                Color px_color = {};
+            u16* row = &vram[GPU::VRAM_WIDTH * py];
+            const s32 start_x = minX + first, end_x = minX + last;
 
+            if constexpr (!DRAW_FLAGS_SET(TEXTURED)) {
+                // semi-transparency only applies to textured polygons (for now)
                 if constexpr (DRAW_FLAGS_SET(MONO)) {
                     // all vertices store the same color value
-                    px_color = v0->c;
+                    std::fill(row + start_x, row + end_x + 1, v0->c.To5551());
+                } else {
+                    DrawShadedSpan(row + start_x, end_x - start_x + 1, r, g, b);
                 }
+            } else {
+                for (s32 px = start_x; px <= end_x; px++) {
+                    const u8 u = u8(std::clamp(tex_x.value, 0, 255));
+                    const u8 v = u8(std::clamp(tex_y.value, 0, 255));
+                    const u16 texel = GetTexel<draw_flags>(sampler, u, v);
 
-                bool transparency_enabled = false;
-
-                if constexpr (DRAW_FLAGS_SET(TEXTURED)) {
-                    u8 tex_x = std::clamp((v0->tex_x * w12 + v1->tex_x * w20 + v2->tex_x * w01) / area, 0, 255);
-                    u8 tex_y = std::clamp((v0->tex_y * w12 + v1->tex_y * w20 + v2->tex_y * w01) / area, 0, 255);
-
-                    u16 texel = GetTexel(tex_x, tex_y);
-                    transparency_enabled = gpu->status.tex_page_colors == 2 || (texel & 0x8000) != 0;
+                    // fully transparent texels are not drawn
                     if (texel & TEXEL_MASK) {
-                        px_color = Color::FromU16(texel);
+                        Color px_color = Color::FromU16(texel);
                         if constexpr (DRAW_FLAGS_SET(TEXTURE_BLENDING) && !DRAW_FLAGS_SET(SHADED)) {
                             px_color = BlendTexture(px_color, v0->c);
                         }
-                    } else {
-                        // leave early
-                        w01 += A01; w12 += A12; w20 += A20;
-                        continue;
-                    }
-                }
 
-                if constexpr (DRAW_FLAGS_SET(SHADED)) {
-                    Color color;
+                        if constexpr (DRAW_FLAGS_SET(SHADED)) {
+                            Color color = {.r = u8(r.value), .g = u8(g.value), .b = u8(b.value)};
 
-                    color.r = (s32(v0->c.r) * w12 + s32(v1->c.r) * w20 + s32(v2->c.r) * w01) / area;
-                    color.g = (s32(v0->c.g) * w12 + s32(v1->c.g) * w20 + s32(v2->c.g) * w01) / area;
-                    color.b = (s32(v0->c.b) * w12 + s32(v1->c.b) * w20 + s32(v2->c.b) * w01) / area;
+                            if constexpr (DRAW_FLAGS_SET(TEXTURE_BLENDING)) {
+                                px_color = BlendTexture(px_color, color);
+                            } else {
+                                px_color = color;
+                            }
+                        }
 
-                    if constexpr (DRAW_FLAGS_SET(TEXTURE_BLENDING)) {
-                        px_color = BlendTexture(px_color, color);
-                    } else {
-                        px_color = color;
+                        const bool transparency_enabled = command.tex_page_colors == 2 || (texel & 0x8000) != 0;
+                        if (DRAW_FLAGS_SET(SEMI_TRANSPARENT) && transparency_enabled) {
+                            Color old = Color::FromU16(row[px]);
+                            Color mix = CalcSemiTransparency(command.semi_transparency, old, px_color);
+                            row[px] = mix.To5551();
+                        } else {
+                            row[px] = px_color.To5551();
+                        }
                     }
-                }
 
-                if constexpr (DRAW_FLAGS_SET(SEMI_TRANSPARENT)) {
-                    if (transparency_enabled) {
-                        Color old = Color::FromU16(gpu->vram[px + GPU::VRAM_WIDTH * py]);
-                        Color mix = CalcSemiTransparency(gpu->status.semi_transparency, old, px_color);
-                        gpu->vram[px + GPU::VRAM_WIDTH * py] = mix.To5551();
-                    } else {
-                        gpu->vram[px + GPU::VRAM_WIDTH * py] = px_color.To5551();
+                    tex_x.Step();
+                    tex_y.Step();
+                    if constexpr (DRAW_FLAGS_SET(SHADED)) {
+                        r.Step();
+                        g.Step();
+                        b.Step();
                     }
-                } else {
-                    gpu->vram[px + GPU::VRAM_WIDTH * py] = px_color.To5551();
                 }
-                //gpu->vram[px + GPU::VRAM_WIDTH * py] = px_color.To5551();
             }
-
-            // increment weights by one in x direction
-            w01 += A01;
-            w12 += A12;
-            w20 += A20;
         }
 
         // increment weights by one in y direction
@@ -186,19 +361,17 @@ void Renderer_SW::DrawTriangle() {
         w12_row += B12;
         w20_row += B20;
     }
-
-    gpu->sys->stats->frame_triangle_draw_count++;
 }
 
 template<u32 draw_flags>
-void Renderer_SW::Draw4PointPolygon() {
+void Renderer_SW::Draw4PointPolygon(const DrawCommand& command, const VramRect& clip) const {
     // build 4-point polygon using two calls to DrawTriangle
-    DrawTriangle<draw_flags>();
-    DrawTriangle<draw_flags | SECOND_TRIANGLE>();
+    DrawTriangle<draw_flags>(command, clip);
+    DrawTriangle<draw_flags | SECOND_TRIANGLE>(command, clip);
 }
 
 template<RectSize size>
-static constexpr std::tuple<u16, u16> GetSize(Rectangle& rect) {
+static constexpr std::tuple<u16, u16> GetSize(const Rectangle& rect) {
 #define MAKE(x, y) std::make_tuple(u16(x), u16(y))
 
     switch (size) {
@@ -212,35 +385,45 @@ static constexpr std::tuple<u16, u16> GetSize(Rectangle& rect) {
 }
 
 template<RectSize size, u32 draw_flags>
-void Renderer_SW::DrawRectangle() {
-    auto& rect = gpu->rectangle;
+void Renderer_SW::DrawRectangle(const DrawCommand& command, const VramRect& clip) const {
+    const auto& rect = command.rectangle;
 
     auto [size_x, size_y] = GetSize<size>(rect);
 
-    const s32 start_with_offset_x = (s32)rect.start_x + (s32)gpu->drawing_x_offset;
-    const s32 start_with_offset_y = (s32)rect.start_y + (s32)gpu->drawing_y_offset;
+    const s32 start_with_offset_x = (s32)rect.start_x + (s32)command.drawing_x_offset;
+    const s32 start_with_offset_y = (s32)rect.start_y + (s32)command.drawing_y_offset;
 
-    const s32 start_x = std::clamp<s32>(start_with_offset_x, gpu->drawing_area_left, gpu->drawing_area_right);
-    const s32 start_y = std::clamp<s32>(start_with_offset_y, gpu->drawing_area_top, gpu->drawing_area_bottom);
-    const s32 end_x = std::clamp<s32>(start_with_offset_x + size_x, gpu->drawing_area_left, gpu->drawing_area_right);
-    const s32 end_y = std::clamp<s32>(start_with_offset_y + size_y, gpu->drawing_area_top, gpu->drawing_area_bottom);
+    const s32 start_x = std::clamp<s32>(start_with_offset_x, command.drawing_area_left, command.drawing_area_right);
+    const s32 start_y = std::clamp<s32>(start_with_offset_y, command.drawing_area_top, command.drawing_area_bottom);
+    const s32 end_x =
+        std::clamp<s32>(start_with_offset_x + size_x, command.drawing_area_left, command.drawing_area_right);
+    const s32 end_y =
+        std::clamp<s32>(start_with_offset_y + size_y, command.drawing_area_top, command.drawing_area_bottom);
+
+    // texture coordinates stay relative to the start of the unclipped rectangle
+    const s32 clip_start_x = std::max(start_x, clip.left), clip_end_x = std::min(end_x, clip.right + 1);
+    const s32 clip_start_y = std::max(start_y, clip.top), clip_end_y = std::min(end_y, clip.bottom + 1);
 
     //LogTrace("Rect<{},{}> from (x={},y={}) to (x={},y={})", DRAW_FLAGS_SET(TEXTURED) ? "Textured" : "Mono",
     //         DRAW_FLAGS_SET(OPAQUE) ? "Opaque" : "SemiTransparent", start_x, start_y, end_x, end_y);
 
-    for (s32 y = start_y; y < end_y; y++) {
-        for (s32 x = start_x; x < end_x; x++) {
+    TextureSampler sampler;
+    if constexpr (DRAW_FLAGS_SET(TEXTURED)) sampler = MakeTextureSampler(command);
+
+    for (s32 y = clip_start_y; y < clip_end_y; y++) {
+        for (s32 x = clip_start_x; x < clip_end_x; x++) {
             Color px_color = {};
 
             bool transparency_enabled = true;
 
             if constexpr (DRAW_FLAGS_SET(TEXTURED)) {
-                const s32 tex_y_inc_dir = gpu->tex_rectangle_yflip ? -1 : +1;
-                const s32 tex_x_inc_dir = gpu->tex_rectangle_xflip ? -1 : +1;
+                const s32 tex_y_inc_dir = command.tex_rectangle_yflip ? -1 : +1;
+                const s32 tex_x_inc_dir = command.tex_rectangle_xflip ? -1 : +1;
 
-                u16 texel = GetTexel(rect.tex_x + (x - start_x) * tex_x_inc_dir, rect.tex_y + (y - start_y) * tex_y_inc_dir);
+                u16 texel = GetTexel<draw_flags>(sampler, rect.tex_x + (x - start_x) * tex_x_inc_dir,
+                                                 rect.tex_y + (y - start_y) * tex_y_inc_dir);
 
-                if (gpu->status.tex_page_colors != 2 && (texel & 0x8000) == 0) transparency_enabled = false;
+                if (command.tex_page_colors != 2 && (texel & 0x8000) == 0) transparency_enabled = false;
 
                 if (texel & TEXEL_MASK) {
                     px_color = Color::FromU16(texel);
@@ -257,209 +440,375 @@ void Renderer_SW::DrawRectangle() {
 
             if constexpr (DRAW_FLAGS_SET(SEMI_TRANSPARENT)) {
                 if (transparency_enabled) {
-                    Color old = Color::FromU16(gpu->vram[x + GPU::VRAM_WIDTH * y]);
-                    Color mix = CalcSemiTransparency(gpu->status.semi_transparency, old, px_color);
-                    gpu->vram[x + GPU::VRAM_WIDTH * y] = mix.To5551();
+                    Color old = Color::FromU16(vram[x + GPU::VRAM_WIDTH * y]);
+                    Color mix = CalcSemiTransparency(command.semi_transparency, old, px_color);
+                    vram[x + GPU::VRAM_WIDTH * y] = mix.To5551();
                 } else {
-                    gpu->vram[x + GPU::VRAM_WIDTH * y] = px_color.To5551();
+                    vram[x + GPU::VRAM_WIDTH * y] = px_color.To5551();
                 }
             } else {
-                gpu->vram[x + GPU::VRAM_WIDTH * y] = px_color.To5551();
+                vram[x + GPU::VRAM_WIDTH * y] = px_color.To5551();
             }
 
             // debug (print every rectangle red)
-            //gpu->vram[x + GPU::VRAM_WIDTH * y] = 0x1F;
+            //vram[x + GPU::VRAM_WIDTH * y] = 0x1F;
         }
     }
-
-    gpu->sys->stats->frame_rectangle_draw_count++;
 }
 
 template<u32 draw_flags>
-void Renderer_SW::DrawLine() {
-    if (gpu->line_buffer.size() < 2) {
-        LogWarn("Trying to draw a line without at least 2 points");
-        return;
-    }
-
-    for (usize i = 0; i < gpu->line_buffer.size() - 1; i++) {
-        Vertex& p0 = gpu->line_buffer[i];
-        Vertex& p1 = gpu->line_buffer[i+1];
-
-        s32 x0 = std::clamp<s32>(p0.x + gpu->drawing_x_offset, gpu->drawing_area_left, gpu->drawing_area_right);
-        s32 y0 = std::clamp<s32>(p0.y + gpu->drawing_y_offset, gpu->drawing_area_top, gpu->drawing_area_bottom);
-
-        s32 x1 = std::clamp<s32>(p1.x + gpu->drawing_x_offset, gpu->drawing_area_left, gpu->drawing_area_right);
-        s32 y1 = std::clamp<s32>(p1.y + gpu->drawing_y_offset, gpu->drawing_area_top, gpu->drawing_area_bottom);
-
-        s32 dx = std::abs(x1 - x0);
-        s32 sx = x0 < x1 ? 1 : -1;
-        s32 dy = -std::abs(y1 - y0);
-        s32 sy = y0 < y1 ? 1 : -1;
-        s32 error = dx + dy;
-
-        while (true) {
+void Renderer_SW::DrawLine(const DrawCommand& command, const VramRect& clip) const {
+    // a single segment from the first to the second vertex
+    const Vertex& p0 = command.vertices[0];
+    const Vertex& p1 = command.vertices[1];
+
+    s32 x0 = std::clamp<s32>(p0.x + command.drawing_x_offset, command.drawing_area_left, command.drawing_area_right);
+    s32 y0 = std::clamp<s32>(p0.y + command.drawing_y_offset, command.drawing_area_top, command.drawing_area_bottom);
+
+    s32 x1 = std::clamp<s32>(p1.x + command.drawing_x_offset, command.drawing_area_left, command.drawing_area_right);
+    s32 y1 = std::clamp<s32>(p1.y + command.drawing_y_offset, command.drawing_area_top, command.drawing_area_bottom);
+
+    s32 dx = std::abs(x1 - x0);
+    s32 sx = x0 < x1 ? 1 : -1;
+    s32 dy = -std::abs(y1 - y0);
+    s32 sy = y0 < y1 ? 1 : -1;
+    s32 error = dx + dy;
+
+    while (true) {
+        // the whole line gets walked for every clip rectangle to keep the pixels identical
+        if (x0 >= clip.left && x0 <= clip.right && y0 >= clip.top && y0 <= clip.bottom) {
             if constexpr (DRAW_FLAGS_SET(SHADED)) {
                 // TODO
-                gpu->vram[x0 + GPU::VRAM_WIDTH * y0] = 0x7FFF;
+                vram[x0 + GPU::VRAM_WIDTH * y0] = 0x7FFF;
             } else {
-                gpu->vram[x0 + GPU::VRAM_WIDTH * y0] = p0.c.To5551();
+                vram[x0 + GPU::VRAM_WIDTH * y0] = p0.c.To5551();
             }
+        }
 
-            // TODO: semi transparency
+        // TODO: semi transparency
 
-            if (x0 == x1 && y0 == y1) break;
-            s32 e2 = 2 * error;
-            if (e2 >= dy) {
-                if (x0 == x1) break;
-                error = error + dy;
-                x0 = x0 + sx;
-            }
-            if (e2 <= dx) {
-                if (y0 == y1) break;
-                error = error + dx;
-                y0 = y0 + sy;
-            }
+        if (x0 == x1 && y0 == y1) break;
+        s32 e2 = 2 * error;
+        if (e2 >= dy) {
+            if (x0 == x1) break;
+            error = error + dy;
+            x0 = x0 + sx;
+        }
+        if (e2 <= dx) {
+            if (y0 == y1) break;
+            error = error + dx;
+            y0 = y0 + sy;
         }
     }
+}
 
-    gpu->sys->stats->frame_line_draw_count++;
+template<u32 draw_flags>
+void Renderer_SW::DrawTexturedTriangle(const DrawCommand& command, const VramRect& clip) const {
+    static constexpr auto table = []<usize... variant>(std::index_sequence<variant...>) {
+        return std::array<DrawFunction, sizeof...(variant)>{
+            &Renderer_SW::DrawTriangle<draw_flags | TEXTURE_VARIANT_FLAGS[variant]>...};
+    }(std::make_index_sequence<TEXTURE_VARIANT_FLAGS.size()>());
+
+    (this->*table[TextureVariant(command)])(command, clip);
 }
 
-#undef DRAW_FLAGS_SET
+template<u32 draw_flags>
+void Renderer_SW::DrawTextured4PointPolygon(const DrawCommand& command, const VramRect& clip) const {
+    static constexpr auto table = []<usize... variant>(std::index_sequence<variant...>) {
+        return std::array<DrawFunction, sizeof...(variant)>{
+            &Renderer_SW::Draw4PointPolygon<draw_flags | TEXTURE_VARIANT_FLAGS[variant]>...};
+    }(std::make_index_sequence<TEXTURE_VARIANT_FLAGS.size()>());
 
-u16 Renderer_SW::GetTexel(u8 tex_x, u8 tex_y) {
-    tex_x = (tex_x & ~(gpu->tex_window_x_mask * 8)) | ((gpu->tex_window_x_offset & gpu->tex_window_x_mask) * 8);
-    tex_y = (tex_y & ~(gpu->tex_window_y_mask * 8)) | ((gpu->tex_window_y_offset & gpu->tex_window_y_mask) * 8);
+    (this->*table[TextureVariant(command)])(command, clip);
+}
 
-    u16 base_x = gpu->status.tex_page_x_base * 64;
-    u16 base_y = gpu->status.tex_page_y_base * 256;
+template<RectSize size, u32 draw_flags>
+void Renderer_SW::DrawTexturedRectangle(const DrawCommand& command, const VramRect& clip) const {
+    static constexpr auto table = []<usize... variant>(std::index_sequence<variant...>) {
+        return std::array<DrawFunction, sizeof...(variant)>{
+            &Renderer_SW::DrawRectangle<size, draw_flags | TEXTURE_VARIANT_FLAGS[variant]>...};
+    }(std::make_index_sequence<TEXTURE_VARIANT_FLAGS.size()>());
 
-    u8 tex_mode = gpu->status.tex_page_colors;
-    u16 texel;
+    (this->*table[TextureVariant(command)])(command, clip);
+}
 
-    switch (tex_mode) {
-        case 0:
-        {
-            u32 tx = std::min<u32>(base_x + (tex_x / 4), 1023u);
-            u32 ty = std::min<u32>(base_y + tex_y, 511u);
+u32 Renderer_SW::TextureVariant(const DrawCommand& command) {
+    if (command.texture) return 0;
 
-            u16 palette_value = gpu->vram[tx + GPU::VRAM_WIDTH * ty];
-            u16 palette_index = (palette_value >> ((tex_x % 4) * 4)) & 0xFu;
+    // a zero mask leaves the texture coordinates unchanged
+    const u32 window = (command.tex_window_x_mask | command.tex_window_y_mask) != 0;
+    switch (command.tex_page_colors) {
+        case 0: return 1 + window;
+        case 1: return 3 + window;
+        case 2: return 5 + window;
+        default:
+            LogWarn("Invalid texture color mode 3");
+            return 7;
+    }
+}
 
-            u16 texel_x = std::min<u32>((gpu->clut & 0x3F) * 16 + palette_index, 1023u);
-            u16 texel_y = (gpu->clut >> 6) & 0x1FF;
+Renderer_SW::TextureSampler Renderer_SW::MakeTextureSampler(const DrawCommand& command) const {
+    TextureSampler sampler;
+    if (command.texture) {
+        sampler.texels = command.texture;
+        return sampler;
+    }
 
-            texel = gpu->vram[texel_x + GPU::VRAM_WIDTH * texel_y];
-            break;
-        }
-        case 1:
-        {
-            u32 tx = std::min<u32>(base_x + (tex_x / 2), 1023u);
-            u32 ty = std::min<u32>(base_y + tex_y, 511u);
+    sampler.texels = &vram[GPU::VRAM_WIDTH * command.tex_page_y_base * 256];
+    sampler.clut = &vram[GPU::VRAM_WIDTH * ((command.clut >> 6) & 0x1FF)];
+    sampler.base_x = command.tex_page_x_base * 64;
+    sampler.clut_x = (command.clut & 0x3F) * 16;
 
-            u16 palette_value = gpu->vram[tx + GPU::VRAM_WIDTH * ty];
-            u16 palette_index = (palette_value >> ((tex_x % 2) * 8)) & 0xFFu;
+    sampler.window_and_x = u8(~(command.tex_window_x_mask * 8));
+    sampler.window_or_x = u8((command.tex_window_x_offset & command.tex_window_x_mask) * 8);
+    sampler.window_and_y = u8(~(command.tex_window_y_mask * 8));
+    sampler.window_or_y = u8((command.tex_window_y_offset & command.tex_window_y_mask) * 8);
+    return sampler;
+}
 
-            u16 texel_x = std::min<u32>((gpu->clut & 0x3F) * 16 + palette_index, 1023u);
-            u16 texel_y = (gpu->clut >> 6) & 0x1FF;
+template<u32 draw_flags>
+ALWAYS_INLINE u16 Renderer_SW::GetTexel(const TextureSampler& sampler, u8 tex_x, u8 tex_y) const {
+    if constexpr (DRAW_FLAGS_SET(TEXTURE_DECODED)) {
+        // the texture window is already applied to the decoded texture
+        return sampler.texels[tex_y * TextureCache::TEXTURE_SIZE + tex_x];
+    }
 
-            texel = gpu->vram[texel_x + GPU::VRAM_WIDTH * texel_y];
-            break;
-        }
-        case 2:
-        {
-            u32 texel_x = (base_x + tex_x) & 1023u;
-            u32 texel_y = (base_y + tex_y) & 511u;
+    if constexpr (DRAW_FLAGS_SET(TEXTURE_WINDOW)) {
+        tex_x = (tex_x & sampler.window_and_x) | sampler.window_or_x;
+        tex_y = (tex_y & sampler.window_and_y) | sampler.window_or_y;
+    }
 
-            texel = gpu->vram[texel_x + GPU::VRAM_WIDTH * texel_y];
-            break;
-        }
-        default:
-            texel = 0xFF;
-            LogWarn("Invalid texture color mode 3");
+    // texture pages start at y = 0 or y = 256, so the row never leaves VRAM
+    const u16* row = sampler.texels + GPU::VRAM_WIDTH * tex_y;
+
+    if constexpr (DRAW_FLAGS_SET(TEXTURE_4BIT)) {
+        const u16 palette_value = row[std::min<u32>(sampler.base_x + (tex_x / 4), 1023u)];
+        const u16 palette_index = (palette_value >> ((tex_x % 4) * 4)) & 0xFu;
+        return sampler.clut[std::min<u32>(sampler.clut_x + palette_index, 1023u)];
+    } else if constexpr (DRAW_FLAGS_SET(TEXTURE_8BIT)) {
+        const u16 palette_value = row[std::min<u32>(sampler.base_x + (tex_x / 2), 1023u)];
+        const u16 palette_index = (palette_value >> ((tex_x % 2) * 8)) & 0xFFu;
+        return sampler.clut[std::min<u32>(sampler.clut_x + palette_index, 1023u)];
+    } else if constexpr (DRAW_FLAGS_SET(TEXTURE_15BIT)) {
+        return row[(sampler.base_x + tex_x) & 1023u];
+    } else {
+        // reserved color mode
+        return 0xFF;
+    }
+}
+
+#undef DRAW_FLAGS_SET
+
+void Renderer_SW::Draw(const DrawCommand& command) {
+    const VramRect bounds = DrawBounds(command);
+    if (bounds.Empty()) return;
+
+    if (TextureCache::IsCacheable(command) && !SamplesOwnOutput(command, bounds)) {
+        DrawCommand cached = command;
+        cached.texture = texture_cache.GetTexture(command);
+        Rasterize(cached, bounds);
+    } else {
+        Rasterize(command, bounds);
     }
 
-    return texel;
+    texture_cache.InvalidateVram(bounds);
 }
 
-void Renderer_SW::Draw(u32 cmd) {
+const u16* Renderer_SW::CachedTexture(const DrawCommand& command) {
+    if (!TextureCache::IsCacheable(command)) return nullptr;
+    return texture_cache.GetTexture(command);
+}
+
+bool Renderer_SW::CachedTextureEvicts(const DrawCommand& command) const {
+    return TextureCache::IsCacheable(command) && texture_cache.MissEvicts(command);
+}
+
+void Renderer_SW::Rasterize(const DrawCommand& command, const VramRect& clip) const {
     // clang-format off
 
-    switch ((cmd >> 24)) {
-        case 0x20: DrawTriangle<MONO | OPAQUE>(); break;
-        case 0x22: DrawTriangle<MONO | SEMI_TRANSPARENT>(); break;
-        case 0x24: DrawTriangle<TEXTURED | OPAQUE | TEXTURE_BLENDING>(); break;
-        case 0x25: DrawTriangle<TEXTURED | OPAQUE | RAW_TEXTURE>(); break;
-        case 0x26: DrawTriangle<TEXTURED | SEMI_TRANSPARENT | TEXTURE_BLENDING>(); break;
-        case 0x27: DrawTriangle<TEXTURED | SEMI_TRANSPARENT | RAW_TEXTURE>(); break;
-        case 0x30: DrawTriangle<SHADED | OPAQUE>(); break;
-        case 0x32: DrawTriangle<SHADED | SEMI_TRANSPARENT>(); break;
-        case 0x34: DrawTriangle<SHADED | TEXTURED | OPAQUE | TEXTURE_BLENDING>(); break;
-        case 0x36: DrawTriangle<SHADED | TEXTURED | SEMI_TRANSPARENT | TEXTURE_BLENDING>(); break;
-
-        case 0x28: Draw4PointPolygon<MONO | OPAQUE>(); break;
-        case 0x2A: Draw4PointPolygon<MONO | SEMI_TRANSPARENT>(); break;
-        case 0x2C: Draw4PointPolygon<TEXTURED | OPAQUE | TEXTURE_BLENDING>(); break;
-        case 0x2D: Draw4PointPolygon<TEXTURED | OPAQUE | RAW_TEXTURE>(); break;
-        case 0x2E: Draw4PointPolygon<TEXTURED | SEMI_TRANSPARENT | TEXTURE_BLENDING>(); break;
-        case 0x2F: Draw4PointPolygon<TEXTURED | SEMI_TRANSPARENT | RAW_TEXTURE>(); break;
-        case 0x38: Draw4PointPolygon<SHADED | OPAQUE>(); break;
-        case 0x3A: Draw4PointPolygon<SHADED | SEMI_TRANSPARENT>(); break;
-        case 0x3C: Draw4PointPolygon<SHADED | TEXTURED | OPAQUE | TEXTURE_BLENDING>(); break;
-        case 0x3E: Draw4PointPolygon<SHADED | TEXTURED | SEMI_TRANSPARENT | TEXTURE_BLENDING>(); break;
-
-        case 0x40: case 0x48: DrawLine<MONO | OPAQUE>(); break;
-        case 0x42: case 0x4A: DrawLine<MONO | SEMI_TRANSPARENT>(); break;
-
-        case 0x50: case 0x58: DrawLine<SHADED | OPAQUE>(); break;
-        case 0x52: case 0x5A: DrawLine<SHADED | SEMI_TRANSPARENT>(); break;
-
-        case 0x60: DrawRectangle<RectSize::VARIABLE, MONO | OPAQUE>(); break;
-        case 0x62: DrawRectangle<RectSize::VARIABLE, MONO | SEMI_TRANSPARENT>(); break;
-        case 0x68: DrawRectangle<RectSize::ONE, MONO | OPAQUE>(); break;
-        case 0x6A: DrawRectangle<RectSize::ONE, MONO | SEMI_TRANSPARENT>(); break;
-        case 0x70: DrawRectangle<RectSize::EIGHT, MONO | OPAQUE>(); break;
-        case 0x72: DrawRectangle<RectSize::EIGHT, MONO | SEMI_TRANSPARENT>(); break;
-        case 0x78: DrawRectangle<RectSize::SIXTEEN, MONO | OPAQUE>(); break;
-        case 0x7A: DrawRectangle<RectSize::SIXTEEN, MONO | SEMI_TRANSPARENT>(); break;
-
-        case 0x64: DrawRectangle<RectSize::VARIABLE, TEXTURED | OPAQUE | TEXTURE_BLENDING>(); break;
-        case 0x65: DrawRectangle<RectSize::VARIABLE, TEXTURED | OPAQUE | RAW_TEXTURE>(); break;
-        case 0x66: DrawRectangle<RectSize::VARIABLE, TEXTURED | SEMI_TRANSPARENT | TEXTURE_BLENDING>(); break;
-        case 0x67: DrawRectangle<RectSize::VARIABLE, TEXTURED | SEMI_TRANSPARENT | RAW_TEXTURE>(); break;
+    switch ((command.cmd >> 24)) {
+        case 0x20: DrawTriangle<MONO | OPAQUE>(command, clip); break;
+        case 0x22: DrawTriangle<MONO | SEMI_TRANSPARENT>(command, clip); break;
+        case 0x24: DrawTexturedTriangle<TEXTURED | OPAQUE | TEXTURE_BLENDING>(command, clip); break;
+        case 0x25: DrawTexturedTriangle<TEXTURED | OPAQUE | RAW_TEXTURE>(command, clip); break;
+        case 0x26: DrawTexturedTriangle<TEXTURED | SEMI_TRANSPARENT | TEXTURE_BLENDING>(command, clip); break;
+        case 0x27: DrawTexturedTriangle<TEXTURED | SEMI_TRANSPARENT | RAW_TEXTURE>(command, clip); break;
+        case 0x30: DrawTriangle<SHADED | OPAQUE>(command, clip); break;
+        case 0x32: DrawTriangle<SHADED | SEMI_TRANSPARENT>(command, clip); break;
+        case 0x34: DrawTexturedTriangle<SHADED | TEXTURED | OPAQUE | TEXTURE_BLENDING>(command, clip); break;
+        case 0x36: DrawTexturedTriangle<SHADED | TEXTURED | SEMI_TRANSPARENT | TEXTURE_BLENDING>(command, clip); break;
+
+        case 0x28: Draw4PointPolygon<MONO | OPAQUE>(command, clip); break;
+        case 0x2A: Draw4PointPolygon<MONO | SEMI_TRANSPARENT>(command, clip); break;
+        case 0x2C: DrawTextured4PointPolygon<TEXTURED | OPAQUE | TEXTURE_BLENDING>(command, clip); break;
+        case 0x2D: DrawTextured4PointPolygon<TEXTURED | OPAQUE | RAW_TEXTURE>(command, clip); break;
+        case 0x2E: DrawTextured4PointPolygon<TEXTURED | SEMI_TRANSPARENT | TEXTURE_BLENDING>(command, clip); break;
+        case 0x2F: DrawTextured4PointPolygon<TEXTURED | SEMI_TRANSPARENT | RAW_TEXTURE>(command, clip); break;
+        case 0x38: Draw4PointPolygon<SHADED | OPAQUE>(command, clip); break;
+        case 0x3A: Draw4PointPolygon<SHADED | SEMI_TRANSPARENT>(command, clip); break;
+        case 0x3C: DrawTextured4PointPolygon<SHADED | TEXTURED | OPAQUE | TEXTURE_BLENDING>(command, clip); break;
+        case 0x3E: DrawTextured4PointPolygon<SHADED | TEXTURED | SEMI_TRANSPARENT | TEXTURE_BLENDING>(command, clip); break;
+
+        case 0x40: case 0x48: DrawLine<MONO | OPAQUE>(command, clip); break;
+        case 0x42: case 0x4A: DrawLine<MONO | SEMI_TRANSPARENT>(command, clip); break;
+
+        case 0x50: case 0x58: DrawLine<SHADED | OPAQUE>(command, clip); break;
+        case 0x52: case 0x5A: DrawLine<SHADED | SEMI_TRANSPARENT>(command, clip); break;
+
+        case 0x60: DrawRectangle<RectSize::VARIABLE, MONO | OPAQUE>(command, clip); break;
+        case 0x62: DrawRectangle<RectSize::VARIABLE, MONO | SEMI_TRANSPARENT>(command, clip); break;
+        case 0x68: DrawRectangle<RectSize::ONE, MONO | OPAQUE>(command, clip); break;
+        case 0x6A: DrawRectangle<RectSize::ONE, MONO | SEMI_TRANSPARENT>(command, clip); break;
+        case 0x70: DrawRectangle<RectSize::EIGHT, MONO | OPAQUE>(command, clip); break;
+        case 0x72: DrawRectangle<RectSize::EIGHT, MONO | SEMI_TRANSPARENT>(command, clip); break;
+        case 0x78: DrawRectangle<RectSize::SIXTEEN, MONO | OPAQUE>(command, clip); break;
+        case 0x7A: DrawRectangle<RectSize::SIXTEEN, MONO | SEMI_TRANSPARENT>(command, clip); break;
+
+        case 0x64: DrawTexturedRectangle<RectSize::VARIABLE, TEXTURED | OPAQUE | TEXTURE_BLENDING>(command, clip); break;
+        case 0x65: DrawTexturedRectangle<RectSize::VARIABLE, TEXTURED | OPAQUE | RAW_TEXTURE>(command, clip); break;
+        case 0x66: DrawTexturedRectangle<RectSize::VARIABLE, TEXTURED | SEMI_TRANSPARENT | TEXTURE_BLENDING>(command, clip); break;
+        case 0x67: DrawTexturedRectangle<RectSize::VARIABLE, TEXTURED | SEMI_TRANSPARENT | RAW_TEXTURE>(command, clip); break;
 
         // textured dots make no sense, implement if used by a game?
-        //case 0x6C: DrawRectangle<RectSize::ONE, TEXTURED | OPAQUE | BLENDING>(); break;
-        //case 0x6D: DrawRectangle<RectSize::ONE, TEXTURED | OPAQUE>(); break;
-        //case 0x6E: DrawRectangle<RectSize::ONE, TEXTURED | BLENDING>(); break;
-        //case 0x6F: DrawRectangle<RectSize::ONE, TEXTURED>(); break;
-
-        case 0x74: DrawRectangle<RectSize::EIGHT, TEXTURED | OPAQUE | TEXTURE_BLENDING>(); break;
-        case 0x75: DrawRectangle<RectSize::EIGHT, TEXTURED | OPAQUE | RAW_TEXTURE>(); break;
-        case 0x76: DrawRectangle<RectSize::EIGHT, TEXTURED | SEMI_TRANSPARENT | TEXTURE_BLENDING>(); break;
-        case 0x77: DrawRectangle<RectSize::EIGHT, TEXTURED | SEMI_TRANSPARENT | RAW_TEXTURE>(); break;
-
-        case 0x7C: DrawRectangle<RectSize::VARIABLE, TEXTURED | OPAQUE | TEXTURE_BLENDING>(); break;
-        case 0x7D: DrawRectangle<RectSize::VARIABLE, TEXTURED | OPAQUE | RAW_TEXTURE>(); break;
-        case 0x7E: DrawRectangle<RectSize::VARIABLE, TEXTURED | SEMI_TRANSPARENT | TEXTURE_BLENDING>(); break;
-        case 0x7F: DrawRectangle<RectSize::VARIABLE, TEXTURED | SEMI_TRANSPARENT | RAW_TEXTURE>(); break;
-
-        default: Panic("Invalid draw command 0x{:08X}", cmd);
+        //case 0x6C: DrawRectangle<RectSize::ONE, TEXTURED | OPAQUE | BLENDING>(command, clip); break;
+        //case 0x6D: DrawRectangle<RectSize::ONE, TEXTURED | OPAQUE>(command, clip); break;
+        //case 0x6E: DrawRectangle<RectSize::ONE, TEXTURED | BLENDING>(command, clip); break;
+        //case 0x6F: DrawRectangle<RectSize::ONE, TEXTURED>(command, clip); break;
+
+        case 0x74: DrawTexturedRectangle<RectSize::EIGHT, TEXTURED | OPAQUE | TEXTURE_BLENDING>(command, clip); break;
+        case 0x75: DrawTexturedRectangle<RectSize::EIGHT, TEXTURED | OPAQUE | RAW_TEXTURE>(command, clip); break;
+        case 0x76: DrawTexturedRectangle<RectSize::EIGHT, TEXTURED | SEMI_TRANSPARENT | TEXTURE_BLENDING>(command, clip); break;
+        case 0x77: DrawTexturedRectangle<RectSize::EIGHT, TEXTURED | SEMI_TRANSPARENT | RAW_TEXTURE>(command, clip); break;
+
+        case 0x7C: DrawTexturedRectangle<RectSize::VARIABLE, TEXTURED | OPAQUE | TEXTURE_BLENDING>(command, clip); break;
+        case 0x7D: DrawTexturedRectangle<RectSize::VARIABLE, TEXTURED | OPAQUE | RAW_TEXTURE>(command, clip); break;
+        case 0x7E: DrawTexturedRectangle<RectSize::VARIABLE, TEXTURED | SEMI_TRANSPARENT | TEXTURE_BLENDING>(command, clip); break;
+        case 0x7F: DrawTexturedRectangle<RectSize::VARIABLE, TEXTURED | SEMI_TRANSPARENT | RAW_TEXTURE>(command, clip); break;
+
+        default: Panic("Invalid draw command 0x{:08X}", command.cmd);
     }
 
     // clang-format on
 }
 
-void Renderer_SW::DrawImguiRendererState(bool* open) {
-    ImGui::Begin("Software Renderer", open);
+// size of a rectangle command before clipping
+static std::tuple<u16, u16> RectangleSize(const DrawCommand& command) {
+    const u32 op = command.cmd >> 24;
+    const Rectangle& rect = command.rectangle;
+
+    // 0x7C-0x7F get drawn with the variable size
+    if (op >= 0x7C) return {rect.size_x, rect.size_y};
 
-    ImGui::Text("Primitives");
-    ImGui::Separator();
-    ImGui::Text("Triangles per frame: %lu", gpu->sys->stats->frame_triangle_draw_count);
-    ImGui::Text("Rectangles per frame: %lu", gpu->sys->stats->frame_rectangle_draw_count);
-    ImGui::Text("Lines per frame: %lu", gpu->sys->stats->frame_line_draw_count);
-    ImGui::Separator();
+    switch ((op >> 3) & 0x3) {
+        case 1: return {1, 1};
+        case 2: return {8, 8};
+        case 3: return {16, 16};
+        default: return {rect.size_x, rect.size_y};
+    }
+}
 
-    ImGui::End();
+VramRect Renderer_SW::DrawBounds(const DrawCommand& command) {
+    // same clipping as the draw functions, the order of the clamped coordinates is only guaranteed
+    // if the drawing area is valid
+    const auto ClampX = [&](s32 x) {
+        return std::clamp<s32>(x + command.drawing_x_offset, command.drawing_area_left, command.drawing_area_right);
+    };
+    const auto ClampY = [&](s32 y) {
+        return std::clamp<s32>(y + command.drawing_y_offset, command.drawing_area_top, command.drawing_area_bottom);
+    };
+    const auto Ordered = [](s32 x0, s32 y0, s32 x1, s32 y1) {
+        return VramRect{std::min(x0, x1), std::min(y0, y1), std::max(x0, x1), std::max(y0, y1)};
+    };
+
+    const u32 op = command.cmd >> 24;
+    switch (op >> 5) {
+        case 1: {
+            // polygon
+            const u32 count = (op & 0x08) ? 4 : 3;
+            s32 min_x = command.vertices[0].x, max_x = min_x;
+            s32 min_y = command.vertices[0].y, max_y = min_y;
+            for (u32 i = 1; i < count; i++) {
+                const Vertex& v = command.vertices[i];
+                min_x = std::min<s32>(min_x, v.x), max_x = std::max<s32>(max_x, v.x);
+                min_y = std::min<s32>(min_y, v.y), max_y = std::max<s32>(max_y, v.y);
+            }
+            return Ordered(ClampX(min_x), ClampY(min_y), ClampX(max_x), ClampY(max_y));
+        }
+        case 2: {
+            // line segment
+            const Vertex& p0 = command.vertices[0];
+            const Vertex& p1 = command.vertices[1];
+            return Ordered(ClampX(p0.x), ClampY(p0.y), ClampX(p1.x), ClampY(p1.y));
+        }
+        case 3: {
+            // rectangle, the end is exclusive
+            const Rectangle& rect = command.rectangle;
+            const auto [size_x, size_y] = RectangleSize(command);
+
+            const s32 start_x = ClampX(rect.start_x), start_y = ClampY(rect.start_y);
+            const s32 end_x = ClampX(rect.start_x + size_x), end_y = ClampY(rect.start_y + size_y);
+            if (start_x >= end_x || start_y >= end_y) return {};
+            return {start_x, start_y, end_x - 1, end_y - 1};
+        }
+        default: return {};
+    }
+}
+
+VramRect Renderer_SW::TexCoordBounds(const DrawCommand& command) {
+    const u32 op = command.cmd >> 24;
+
+    if ((op >> 5) == 3) {
+        // rectangles step through the texture coordinates one texel per pixel, they wrap around at 256
+        const Rectangle& rect = command.rectangle;
+        const auto [size_x, size_y] = RectangleSize(command);
+        const auto Range = [](s32 start, s32 count, bool flip) -> std::pair<s32, s32> {
+            if (count == 0) return {start, start};
+            const s32 end = flip ? start - count + 1 : start + count - 1;
+            if (end < 0 || end > 255) return {0, 255};
+            return {std::min(start, end), std::max(start, end)};
+        };
+        const auto [left, right] = Range(rect.tex_x, size_x, command.tex_rectangle_xflip);
+        const auto [top, bottom] = Range(rect.tex_y, size_y, command.tex_rectangle_yflip);
+        return {left, top, right, bottom};
+    }
+
+    // interpolated texture coordinates never leave the range spanned by the vertices
+    const u32 count = (op & 0x08) ? 4 : 3;
+    VramRect bounds = {command.vertices[0].tex_x, command.vertices[0].tex_y, command.vertices[0].tex_x,
+                       command.vertices[0].tex_y};
+    for (u32 i = 1; i < count; i++) {
+        bounds = bounds.Union({command.vertices[i].tex_x, command.vertices[i].tex_y, command.vertices[i].tex_x,
+                               command.vertices[i].tex_y});
+    }
+    return bounds;
+}
+
+bool Renderer_SW::SamplesOwnOutput(const DrawCommand& command, const VramRect& bounds) {
+    if (!command.IsTextured()) return false;
+    const auto sources = TextureBounds(command);
+    return sources[0].Intersects(bounds) || sources[1].Intersects(bounds);
+}
+
+std::array<VramRect, 2> Renderer_SW::TextureBounds(const DrawCommand& command) {
+    const s32 base_x = command.tex_page_x_base * 64;
+    const s32 base_y = command.tex_page_y_base * 256;
+    const s32 clut_x = (command.clut & 0x3F) * 16;
+    const s32 clut_y = (command.clut >> 6) & 0x1FF;
+
+    const auto Page = [&](s32 width) {
+        return VramRect{base_x, base_y, std::min(base_x + width - 1, 1023), base_y + 255};
+    };
+    const auto Clut = [&](s32 width) {
+        return VramRect{clut_x, clut_y, std::min(clut_x + width - 1, 1023), clut_y};
+    };
+
+    switch (command.tex_page_colors) {
+        case 0: return {Page(64), Clut(16)};
+        case 1: return {Page(128), Clut(256)};
+        case 2:
+            // 15-bit pages wrap around horizontally
+            if (base_x + 256 > 1024) return {VramRect{0, base_y, 1023, base_y + 255}, VramRect{}};
+            return {Page(256), VramRect{}};
+        default: return {};
+    }
 }
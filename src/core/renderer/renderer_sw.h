@@ -3,18 +3,38 @@
 #include <array>
 
 #include "renderer/renderer.h"
+#include "renderer/texture_cache.h"
 #include "util/types.h"
 
-class GPU;
-
 // Software rasterizer (slow)
 class Renderer_SW : public Renderer {
 public:
-    explicit Renderer_SW(GPU* gpu);
+    explicit Renderer_SW(u16* vram);
+
+    const char* Name() const override { return "Software Renderer (SW)"; }
+
+    void Draw(const DrawCommand& command) override;
+    void InvalidateVram(const VramRect& area) override { texture_cache.InvalidateVram(area); }
+
+    // only touches pixels inside of the clip rectangle, the result is identical to drawing the whole primitive
+    // and cutting out the clip rectangle afterwards
+    // safe to call from multiple threads as long as the clip rectangles do not overlap
+    void Rasterize(const DrawCommand& command, const VramRect& clip) const;
 
-    void Draw(u32 cmd) override;
+    // area a command can write to
+    static VramRect DrawBounds(const DrawCommand& command);
+    // areas a textured command can read from, texture page and CLUT
+    static std::array<VramRect, 2> TextureBounds(const DrawCommand& command);
+    // texture coordinates a textured command can sample, before the texture window is applied
+    static VramRect TexCoordBounds(const DrawCommand& command);
+    // a primitive that draws over its own texture has to see its own output
+    static bool SamplesOwnOutput(const DrawCommand& command, const VramRect& bounds);
+
+    // decoded texture for a command that can be sampled through the texture cache, nullptr otherwise
+    const u16* CachedTexture(const DrawCommand& command);
+    // true if caching the texture of this command would evict a valid texture
+    bool CachedTextureEvicts(const DrawCommand& command) const;
 
-    void DrawImguiRendererState(bool* open) override;
 private:
     // draw flags
     static constexpr u32 MONO               = 1u << 0;
@@ -26,22 +46,65 @@ private:
     static constexpr u32 RAW_TEXTURE        = 1u << 6;
     // second triangle during 4-point polygon draw call
     static constexpr u32 SECOND_TRIANGLE    = 1u << 7;
+    // texture source, textured commands without any of these use the reserved color mode
+    static constexpr u32 TEXTURE_DECODED    = 1u << 8;
+    static constexpr u32 TEXTURE_4BIT       = 1u << 9;
+    static constexpr u32 TEXTURE_8BIT       = 1u << 10;
+    static constexpr u32 TEXTURE_15BIT      = 1u << 11;
+    // the texture window is not the identity, decoded textures have it applied already
+    static constexpr u32 TEXTURE_WINDOW     = 1u << 12;
 
     static constexpr u16 TEXEL_MASK = 0x7FFF;
 
+    // texture flags for every texture variant, indexed by TextureVariant()
+    static constexpr std::array<u32, 8> TEXTURE_VARIANT_FLAGS = {
+        TEXTURE_DECODED,
+        TEXTURE_4BIT, TEXTURE_4BIT | TEXTURE_WINDOW,
+        TEXTURE_8BIT, TEXTURE_8BIT | TEXTURE_WINDOW,
+        TEXTURE_15BIT, TEXTURE_15BIT | TEXTURE_WINDOW,
+        0,
+    };
+
+    using DrawFunction = void (Renderer_SW::*)(const DrawCommand& command, const VramRect& clip) const;
+
+    // texture lookup state that stays the same for the whole primitive
+    struct TextureSampler {
+        // decoded texture or the start of the texture page in VRAM
+        const u16* texels = nullptr;
+        // row of the CLUT in VRAM
+        const u16* clut = nullptr;
+        u32 base_x = 0, clut_x = 0;
+        u8 window_and_x = 0xFF, window_or_x = 0;
+        u8 window_and_y = 0xFF, window_or_y = 0;
+    };
+
+    static u32 TextureVariant(const DrawCommand& command);
+    TextureSampler MakeTextureSampler(const DrawCommand& command) const;
+
     template<u32 draw_flags>
-    void DrawTriangle();
+    void DrawTriangle(const DrawCommand& command, const VramRect& clip) const;
 
     template<u32 draw_flags>
-    void Draw4PointPolygon();
+    void Draw4PointPolygon(const DrawCommand& command, const VramRect& clip) const;
+
+    template<RectSize size, u32 draw_flags>
+    void DrawRectangle(const DrawCommand& command, const VramRect& clip) const;
 
+    template<u32 draw_flags>
+    void DrawLine(const DrawCommand& command, const VramRect& clip) const;
+
+    // pick the instantiation for the texture variant of the command from a table
+    template<u32 draw_flags>
+    void DrawTexturedTriangle(const DrawCommand& command, const VramRect& clip) const;
+    template<u32 draw_flags>
+    void DrawTextured4PointPolygon(const DrawCommand& command, const VramRect& clip) const;
     template<RectSize size, u32 draw_flags>
-    void DrawRectangle();
+    void DrawTexturedRectangle(const DrawCommand& command, const VramRect& clip) const;
 
     template<u32 draw_flags>
-    void DrawLine();
+    u16 GetTexel(const TextureSampler& sampler, u8 tex_x, u8 tex_y) const;
 
-    u16 GetTexel(u8 tex_x, u8 tex_y);
+    u16* vram = nullptr;
 
-    GPU* gpu = nullptr;
+    TextureCache texture_cache;
 };
@@ -0,0 +1,89 @@
+#include "renderer_threaded.h"
+
+#include "common/asserts.h"
+#include "common/log.h"
+
+LOG_CHANNEL(Renderer);
+
+Renderer_Threaded::Renderer_Threaded(std::unique_ptr<Renderer> backend)
+    : backend(std::move(backend)), queue(QUEUE_SIZE) {
+    static_assert((QUEUE_SIZE & QUEUE_MASK) == 0);
+    Assert(this->backend);
+
+    name = std::string(this->backend->Name()) + " on GPU thread";
+
+    thread = std::thread(&Renderer_Threaded::GpuThread, this);
+}
+
+Renderer_Threaded::~Renderer_Threaded() {
+    DrawCommand exit;
+    exit.cmd = EXIT_COMMAND;
+    Push(exit);
+
+    thread.join();
+
+    // VRAM has to be complete in case another backend takes over
+    backend->Sync();
+}
+
+void Renderer_Threaded::Draw(const DrawCommand& command) {
+    DebugAssert(command.cmd != EXIT_COMMAND);
+    Push(command);
+}
+
+void Renderer_Threaded::Sync() {
+    const u32 current_head = head.load(std::memory_order_relaxed);
+
+    u32 current_tail = tail.load(std::memory_order_acquire);
+    while (current_tail != current_head) {
+        tail.wait(current_tail, std::memory_order_acquire);
+        current_tail = tail.load(std::memory_order_acquire);
+    }
+
+    // the GPU thread is idle now and waits for the next command, so the backend can be used from here
+    backend->Sync();
+}
+
+void Renderer_Threaded::InvalidateVram(const VramRect& area) {
+    // Sync() left the GPU thread idle
+    DebugAssert(tail.load(std::memory_order_acquire) == head.load(std::memory_order_relaxed));
+    backend->InvalidateVram(area);
+}
+
+void Renderer_Threaded::Push(const DrawCommand& command) {
+    const u32 current_head = head.load(std::memory_order_relaxed);
+
+    // wait for a free slot if the GPU thread fell behind
+    u32 current_tail = tail.load(std::memory_order_acquire);
+    while (current_head - current_tail == QUEUE_SIZE) {
+        tail.wait(current_tail, std::memory_order_acquire);
+        current_tail = tail.load(std::memory_order_acquire);
+    }
+
+    queue[current_head & QUEUE_MASK] = command;
+    head.store(current_head + 1, std::memory_order_release);
+    head.notify_one();
+}
+
+void Renderer_Threaded::GpuThread() {
+    u32 current_tail = tail.load(std::memory_order_relaxed);
+
+    while (true) {
+        const u32 current_head = head.load(std::memory_order_acquire);
+        if (current_head == current_tail) {
+            head.wait(current_head, std::memory_order_acquire);
+            continue;
+        }
+
+        for (; current_tail != current_head; current_tail++) {
+            const DrawCommand& command = queue[current_tail & QUEUE_MASK];
+            if (command.cmd == EXIT_COMMAND) return;
+
+            backend->Draw(command);
+            tail.store(current_tail + 1, std::memory_order_release);
+        }
+
+        // only wake up the emulation thread once the whole batch is done
+        tail.notify_one();
+    }
+}
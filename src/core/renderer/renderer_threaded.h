@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "renderer/renderer.h"
+#include "util/types.h"
+
+// Runs another backend on a dedicated GPU thread.
+// The emulation thread keeps parsing GP0 commands (the parser shares its state with GP1 and GPUSTAT)
+// and only pushes the finished draw commands into a lock-free single producer, single consumer ring buffer.
+// Rasterization then overlaps with the emulation of the CPU, GTE and the rest of the system
+// until the next sync point.
+class Renderer_Threaded : public Renderer {
+public:
+    explicit Renderer_Threaded(std::unique_ptr<Renderer> backend);
+    ~Renderer_Threaded() override;
+
+    const char* Name() const override { return name.c_str(); }
+
+    void Draw(const DrawCommand& command) override;
+    void Sync() override;
+    void InvalidateVram(const VramRect& area) override;
+
+    Renderer_Threaded(const Renderer_Threaded&) = delete;
+    Renderer_Threaded& operator=(const Renderer_Threaded&) = delete;
+
+private:
+    // has to be a power of two
+    static constexpr u32 QUEUE_SIZE = 4096;
+    static constexpr u32 QUEUE_MASK = QUEUE_SIZE - 1;
+    // a NOP command tells the GPU thread to exit, real draw commands always have an opcode
+    static constexpr u32 EXIT_COMMAND = 0;
+
+    void Push(const DrawCommand& command);
+    void GpuThread();
+
+    std::unique_ptr<Renderer> backend;
+    std::string name;
+
+    std::vector<DrawCommand> queue;
+    // both indices only ever grow and wrap around at 2^32, which keeps full and empty apart
+    // written by the emulation thread
+    alignas(64) std::atomic<u32> head = 0;
+    // written by the GPU thread, once the command has been drawn
+    alignas(64) std::atomic<u32> tail = 0;
+
+    std::thread thread;
+};
@@ -0,0 +1,136 @@
+#include "texture_cache.h"
+
+#include <algorithm>
+
+#include "common/asserts.h"
+#include "common/log.h"
+#include "gpu.h"
+#include "renderer/renderer_sw.h"
+
+LOG_CHANNEL(Renderer);
+
+TextureCache::TextureCache(const u16* vram) : vram(vram), texels(ENTRY_COUNT * TEXELS_PER_ENTRY) {}
+
+const u16* TextureCache::GetTexture(const DrawCommand& command) {
+    DebugAssert(IsCacheable(command));
+
+    const Key key = MakeKey(command);
+    s32 index = FindEntry(key);
+
+    if (index < 0) {
+        index = static_cast<s32>(FindVictim());
+
+        Entry& entry = entries[index];
+        entry.key = key;
+        entry.sources = Renderer_SW::TextureBounds(command);
+        entry.valid = true;
+        entry.decoded_start.fill(0);
+        entry.decoded_end.fill(0);
+        cached_area = cached_area.Union(entry.sources[0]).Union(entry.sources[1]);
+    }
+
+    Decode(entries[index], Renderer_SW::TexCoordBounds(command), &texels[index * TEXELS_PER_ENTRY]);
+    entries[index].last_use = ++use_counter;
+    return &texels[index * TEXELS_PER_ENTRY];
+}
+
+bool TextureCache::MissEvicts(const DrawCommand& command) const {
+    if (FindEntry(MakeKey(command)) >= 0) return false;
+    return entries[FindVictim()].valid;
+}
+
+void TextureCache::Flush() {
+    for (auto& entry : entries) entry.valid = false;
+    cached_area = {};
+}
+
+TextureCache::Key TextureCache::MakeKey(const DrawCommand& command) {
+    return {
+        .tex_page_x_base = command.tex_page_x_base,
+        .tex_page_y_base = command.tex_page_y_base,
+        .tex_page_colors = command.tex_page_colors,
+        .clut = command.clut,
+        .tex_window_x_mask = command.tex_window_x_mask,
+        .tex_window_y_mask = command.tex_window_y_mask,
+        .tex_window_x_offset = command.tex_window_x_offset,
+        .tex_window_y_offset = command.tex_window_y_offset,
+    };
+}
+
+s32 TextureCache::FindEntry(const Key& key) const {
+    for (u32 i = 0; i < ENTRY_COUNT; i++) {
+        if (entries[i].valid && entries[i].key == key) return static_cast<s32>(i);
+    }
+    return -1;
+}
+
+u32 TextureCache::FindVictim() const {
+    // invalid entries first, then the least recently used one
+    u32 victim = 0;
+    for (u32 i = 0; i < ENTRY_COUNT; i++) {
+        if (!entries[i].valid) return i;
+        if (entries[i].last_use < entries[victim].last_use) victim = i;
+    }
+    return victim;
+}
+
+void TextureCache::Decode(Entry& entry, const VramRect& area, u16* texels) const {
+    const Key& key = entry.key;
+    const u32 start = static_cast<u32>(area.left), end = static_cast<u32>(area.right) + 1;
+
+    // same lookup as Renderer_SW::GetTexel
+    const auto Window = [](u32 coord, u8 mask, u8 offset) {
+        return u8((coord & ~(mask * 8u)) | ((offset & mask) * 8u));
+    };
+
+    const u32 base_x = key.tex_page_x_base * 64;
+    const u32 base_y = key.tex_page_y_base * 256;
+    const u32 clut_x = (key.clut & 0x3F) * 16;
+    const u16* clut = &vram[GPU::VRAM_WIDTH * ((key.clut >> 6) & 0x1FF)];
+
+    // 4-bit textures pack four texels into a halfword, 8-bit textures two
+    const u32 shift = key.tex_page_colors == 0 ? 2 : 1;
+    const u32 index_bits = 16 >> shift;
+    const u32 index_mask = (1u << index_bits) - 1;
+
+    for (s32 v = area.top; v <= area.bottom; v++) {
+        u16& decoded_start = entry.decoded_start[v];
+        u16& decoded_end = entry.decoded_end[v];
+        if (decoded_start <= start && end <= decoded_end) continue;
+
+        const u16* row = &vram[GPU::VRAM_WIDTH * (base_y + Window(v, key.tex_window_y_mask, key.tex_window_y_offset))];
+        u16* dest = &texels[v * TEXTURE_SIZE];
+        const auto DecodeSpan = [&](u32 first, u32 last) {
+            for (u32 u = first; u < last; u++) {
+                const u32 tex_x = Window(u, key.tex_window_x_mask, key.tex_window_x_offset);
+                const u16 palette_value = row[std::min<u32>(base_x + (tex_x >> shift), 1023u)];
+                const u32 palette_index = (palette_value >> ((tex_x & ((1u << shift) - 1)) * index_bits)) & index_mask;
+                dest[u] = clut[std::min<u32>(clut_x + palette_index, 1023u)];
+            }
+        };
+
+        // grow the decoded span of the row so that it stays contiguous
+        if (decoded_start == decoded_end) {
+            DecodeSpan(start, end);
+            decoded_start = u16(start), decoded_end = u16(end);
+        } else {
+            const u32 new_start = std::min<u32>(start, decoded_start), new_end = std::max<u32>(end, decoded_end);
+            DecodeSpan(new_start, decoded_start);
+            DecodeSpan(decoded_end, new_end);
+            decoded_start = u16(new_start), decoded_end = u16(new_end);
+        }
+    }
+}
+
+void TextureCache::InvalidateEntries(const VramRect& area) {
+    cached_area = {};
+    for (auto& entry : entries) {
+        if (!entry.valid) continue;
+
+        if (area.Intersects(entry.sources[0]) || area.Intersects(entry.sources[1])) {
+            entry.valid = false;
+        } else {
+            cached_area = cached_area.Union(entry.sources[0]).Union(entry.sources[1]);
+        }
+    }
+}
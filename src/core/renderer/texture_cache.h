@@ -0,0 +1,77 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include "renderer/renderer.h"
+#include "util/types.h"
+
+// Caches decoded copies of 4-bit and 8-bit paletted textures.
+// An entry holds a texture page looked up through one CLUT and texture window as 256x256 15-bit texels,
+// so sampling it is a single load indexed by the texture coordinates.
+// Only the texels that the commands can sample get decoded, one span per row that grows on demand.
+// Entries are invalidated whenever VRAM inside of their texture page or CLUT gets written.
+class TextureCache {
+public:
+    explicit TextureCache(const u16* vram);
+
+    // only paletted textures get cached, 15-bit textures are sampled straight from VRAM
+    static ALWAYS_INLINE bool IsCacheable(const DrawCommand& command) {
+        return command.IsTextured() && command.tex_page_colors <= 1;
+    }
+
+    // decodes the sampled part of the texture if necessary, a miss can evict the least recently used entry
+    const u16* GetTexture(const DrawCommand& command);
+    // true if GetTexture would have to evict an entry that is still valid
+    bool MissEvicts(const DrawCommand& command) const;
+
+    // has to be called for every write to VRAM
+    ALWAYS_INLINE void InvalidateVram(const VramRect& area) {
+        if (area.Intersects(cached_area)) [[unlikely]] InvalidateEntries(area);
+    }
+
+    // drop all entries
+    void Flush();
+
+    static constexpr u32 TEXTURE_SIZE = 256;
+
+private:
+    struct Key {
+        u8 tex_page_x_base = 0, tex_page_y_base = 0;
+        u8 tex_page_colors = 0;
+        u16 clut = 0;
+        u8 tex_window_x_mask = 0, tex_window_y_mask = 0;
+        u8 tex_window_x_offset = 0, tex_window_y_offset = 0;
+
+        bool operator==(const Key& other) const = default;
+    };
+
+    struct Entry {
+        Key key;
+        // texture page and CLUT
+        std::array<VramRect, 2> sources = {};
+        bool valid = false;
+        u64 last_use = 0;
+        // decoded span of every row, the end is exclusive
+        std::array<u16, TEXTURE_SIZE> decoded_start = {}, decoded_end = {};
+    };
+
+    static Key MakeKey(const DrawCommand& command);
+
+    s32 FindEntry(const Key& key) const;
+    u32 FindVictim() const;
+    // makes sure that the texels inside of the area (in texture coordinates) are decoded
+    void Decode(Entry& entry, const VramRect& area, u16* texels) const;
+    void InvalidateEntries(const VramRect& area);
+
+    static constexpr u32 ENTRY_COUNT = 32;
+    static constexpr u32 TEXELS_PER_ENTRY = TEXTURE_SIZE * TEXTURE_SIZE;
+
+    const u16* vram = nullptr;
+
+    std::array<Entry, ENTRY_COUNT> entries = {};
+    std::vector<u16> texels;
+    // union of the sources of all valid entries, keeps unrelated VRAM writes cheap
+    VramRect cached_area = {};
+    u64 use_counter = 0;
+};
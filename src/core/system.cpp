@@ -28,8 +28,9 @@ System::System() {
 
     debugger = std::make_unique<Debugger>(this);
     stats = std::make_unique<Stats>();
+    profiler = std::make_unique<Profiler>();
 
-    RecalculateCyclesUntilNextEvent();
+    ScheduleComponents();
 
     LogInfo("Initialized PSX core");
 }
@@ -52,10 +53,10 @@ void System::Reset() {
     // Stats is POD, so just use memset for reset purposes
     std::memset(stats.get(), 0, sizeof(Stats));
 
-    accumulated_cycles = 0;
-    cycles_until_next_event = 0;
+    global_ticks = 0;
+    update_ticks = {};
 
-    RecalculateCyclesUntilNextEvent();
+    ScheduleComponents();
 
     // can't run both at the same time
     DebugAssert(!(!Config::ps_bin_file_path.empty() && !Config::psexe_file_path.empty()));
@@ -70,45 +71,110 @@ void System::Reset() {
     LogInfo("System reset");
 }
 
-void System::AddCycles(u32 cycles) {
-    accumulated_cycles += cycles;
-
-    // update all components that reached an event
-    while (accumulated_cycles >= cycles_until_next_event) {
+void System::RunEvents() {
+    Profiler::Scope scope(*profiler, Profiler::Category::Scheduler);
+
+    running_events = true;
+
+    // only the components that own a reached event get updated, the others catch up once they are accessed
+    while (global_ticks >= next_event_ticks) {
+        const u64 ticks = next_event_ticks;
+
+        switch (event_queue[0]) {
+            case TimedEvent::Timer:
+            case TimedEvent::GPU:
+                // the GPU drives the timers that are synced to the video signal and its next event
+                // depends on their state, so these two always get updated together
+                UpdateComponent(TimedEvent::Timer, ticks);
+                UpdateComponent(TimedEvent::GPU, ticks);
+                Schedule(TimedEvent::Timer, timers->CyclesUntilNextEvent());
+                Schedule(TimedEvent::GPU, gpu->CyclesUntilNextEvent());
+                break;
+            case TimedEvent::CDROM:
+                UpdateComponent(TimedEvent::CDROM, ticks);
+                Schedule(TimedEvent::CDROM, cdrom->CyclesUntilNextEvent());
+                break;
+            case TimedEvent::DMA:
+                UpdateComponent(TimedEvent::DMA, ticks);
+                Schedule(TimedEvent::DMA, dma->CyclesUntilNextEvent());
+                break;
+            default: Panic("Invalid timed event");
+        }
+    }
 
-        if (cycles_until_next_event > 0) {
-            // let all the components tick up to the next event
-            UpdateComponents(cycles_until_next_event);
+    running_events = false;
+}
 
-            accumulated_cycles -= cycles_until_next_event;
-        }
+void System::StallCpu(u32 cycles) {
+    global_ticks += cycles;
 
-        // recalculate pending event timings
-        RecalculateCyclesUntilNextEvent();
-    }
+    // the loop in RunEvents catches up on its own
+    if (!running_events && global_ticks >= next_event_ticks) RunEvents();
 }
 
 void System::ForceUpdateComponents() {
-    if (accumulated_cycles > 0) {
-        // update all components to the current state
-        UpdateComponents(accumulated_cycles);
+    Profiler::Scope scope(*profiler, Profiler::Category::Scheduler);
 
-        accumulated_cycles = 0;
-    }
+    // fixed order, the GPU drives the timers that are synced to the video signal
+    UpdateComponent(TimedEvent::Timer, global_ticks);
+    UpdateComponent(TimedEvent::GPU, global_ticks);
+    UpdateComponent(TimedEvent::CDROM, global_ticks);
+    UpdateComponent(TimedEvent::DMA, global_ticks);
 }
 
-void System::RecalculateCyclesUntilNextEvent() {
-    cycles_until_next_event = MaxCycles;
+void System::Schedule(TimedEvent event, u32 cycles) {
+    const u64 ticks = (cycles == MaxCycles) ? NEVER : update_ticks[static_cast<u32>(event)] + cycles;
+    event_ticks[static_cast<u32>(event)] = ticks;
 
-    for (auto& event : timed_events) {
-        const u32 component_cycles = std::invoke(event.cycles_until_event);
+    // keep the queue sorted by timestamp, with only a handful of events insertion sort is all we need
+    u32 position = 0;
+    while (event_queue[position] != event) position++;
 
-        cycles_until_next_event = std::min(cycles_until_next_event, component_cycles);
+    while (position > 0 && event_ticks[static_cast<u32>(event_queue[position - 1])] > ticks) {
+        event_queue[position] = event_queue[position - 1];
+        position--;
+    }
+    while (position + 1 < EVENT_COUNT && event_ticks[static_cast<u32>(event_queue[position + 1])] < ticks) {
+        event_queue[position] = event_queue[position + 1];
+        position++;
     }
+    event_queue[position] = event;
+
+    next_event_ticks = event_ticks[static_cast<u32>(event_queue[0])];
+}
+
+void System::Deschedule(TimedEvent event) {
+    Schedule(event, MaxCycles);
+}
+
+u32 System::GetCyclesUntilNextEvent(TimedEvent event) const {
+    const u32 index = static_cast<u32>(event);
+    return static_cast<u32>(std::min<u64>(event_ticks[index] - update_ticks[index], MaxCycles));
 }
 
-void System::UpdateComponents(u32 cycles) {
-    for (auto& event : timed_events) {
-        std::invoke(event.add_cycles, cycles);
+void System::UpdateComponent(TimedEvent event, u64 ticks) {
+    u64& component_ticks = update_ticks[static_cast<u32>(event)];
+    DebugAssert(ticks <= event_ticks[static_cast<u32>(event)]);
+
+    // a component that was not accessed for a long time might be more than MaxCycles behind
+    while (component_ticks < ticks) {
+        const u32 cycles = static_cast<u32>(std::min<u64>(ticks - component_ticks, MaxCycles));
+        // moved before stepping in case the component causes another update while it is stepped
+        component_ticks += cycles;
+
+        switch (event) {
+            case TimedEvent::Timer: timers->Step(cycles); break;
+            case TimedEvent::GPU: gpu->Step(cycles); break;
+            case TimedEvent::CDROM: cdrom->Step(cycles); break;
+            case TimedEvent::DMA: dma->Step(cycles); break;
+            default: Panic("Invalid timed event");
+        }
     }
 }
+
+void System::ScheduleComponents() {
+    Schedule(TimedEvent::Timer, timers->CyclesUntilNextEvent());
+    Schedule(TimedEvent::GPU, gpu->CyclesUntilNextEvent());
+    Schedule(TimedEvent::CDROM, cdrom->CyclesUntilNextEvent());
+    Schedule(TimedEvent::DMA, dma->CyclesUntilNextEvent());
+}
@@ -1,13 +1,13 @@
 #pragma once
 
 #include <array>
-#include <functional>
 #include <limits>
 #include <memory>
 #include <string>
 
-#include "util/types.h"
+#include "profiler.h"
 #include "stats.h"
+#include "util/types.h"
 
 namespace CPU {
 class CPU;
@@ -30,10 +30,29 @@ public:
     ~System();
     void Reset();
 
-    void AddCycles(u32 cycles);
+    enum class TimedEvent : u32 { Timer = 0, GPU = 1, CDROM = 2, DMA = 3, Count = 4 };
+
+    // advances the global cycle counter, a component only gets updated once its next event is reached
+    ALWAYS_INLINE void AddCycles(u32 cycles) {
+        global_ticks += cycles;
+        if (global_ticks >= next_event_ticks) [[unlikely]] RunEvents();
+    }
+
+    // time passes without the CPU executing instructions, e.g. while a DMA transfer owns the bus
+    // unlike AddCycles it can be called while the components get updated
+    void StallCpu(u32 cycles);
+
+    // bring all components up to the current cycle (e.g. before accessing their registers)
     void ForceUpdateComponents();
-    void RecalculateCyclesUntilNextEvent();
-    u32 GetCyclesUntilNextEvent() const { return cycles_until_next_event; }
+
+    // schedule the next event of a component, the cycles are relative to the last update of that component
+    // scheduling an event in MaxCycles cycles removes it
+    void Schedule(TimedEvent event, u32 cycles);
+    void Deschedule(TimedEvent event);
+
+    u32 GetCyclesUntilNextEvent(TimedEvent event) const;
+    u64 GetGlobalTicks() const { return global_ticks; }
+    u64 GetNextEventTicks() const { return next_event_ticks; }
 
     std::unique_ptr<CPU::CPU> cpu;
     std::unique_ptr<BUS> bus;
@@ -46,23 +65,27 @@ public:
 
     std::unique_ptr<Debugger> debugger;
     std::unique_ptr<Stats> stats;
+    std::unique_ptr<Profiler> profiler;
 
-    enum class TimedEvent : u32 { Timer = 0, GPU = 1, CDROM = 2, Count = 3 };
-
-    struct TimedEventCallbacks {
-        std::function<void(u32)> add_cycles = nullptr;
-        std::function<u32()> cycles_until_event = nullptr;
-    };
+private:
+    void RunEvents();
+    // step a single component from its last update up to the given cycle
+    void UpdateComponent(TimedEvent event, u64 ticks);
+    // ask every component for its next event
+    void ScheduleComponents();
 
-    std::array<TimedEventCallbacks, static_cast<u32>(TimedEvent::Count)> timed_events = {};
+    static constexpr u64 NEVER = std::numeric_limits<u64>::max();
+    static constexpr u32 EVENT_COUNT = static_cast<u32>(TimedEvent::Count);
 
-    void RegisterEvent(System::TimedEvent event_index, std::function<void(u32)>&& add_cycles_fn,
-                       std::function<u32()>&& cycles_until_event_fn) {
-        timed_events[static_cast<u32>(event_index)] = {add_cycles_fn, cycles_until_event_fn};
-    }
-private:
-    void UpdateComponents(u32 cycles);
+    // cycle counter of the CPU
+    u64 global_ticks = 0;
+    // copy of the timestamp of the first event in the queue, checked after every instruction
+    u64 next_event_ticks = 0;
+    bool running_events = false;
 
-    u32 accumulated_cycles = 0;
-    u32 cycles_until_next_event = 0;
+    // the cycle every component was last updated to, absolute event timestamps and the events sorted by them
+    std::array<u64, EVENT_COUNT> update_ticks = {};
+    std::array<u64, EVENT_COUNT> event_ticks = {};
+    std::array<TimedEvent, EVENT_COUNT> event_queue = {TimedEvent::Timer, TimedEvent::GPU, TimedEvent::CDROM,
+                                                       TimedEvent::DMA};
 };
@@ -60,7 +60,7 @@ struct Timer {
 };
 
 // timer_blank.cpp
-struct BlankTimer : public Timer {
+struct BlankTimer final : public Timer {
     BlankTimer(u32 index, System* system);
     void Step(u32 cycles) override;
     u32 CyclesUntilNextEvent() override;
@@ -69,7 +69,7 @@ struct BlankTimer : public Timer {
 };
 
 // timer_system.cpp
-struct SystemTimer : public Timer {
+struct SystemTimer final : public Timer {
     bool StopAtCurrentValue() const;
     u32 div_8_remainder = 0;
 
@@ -1,6 +1,6 @@
 #include "timers.h"
 
-#include "imgui.h"
+#include <algorithm>
 
 #include "common/asserts.h"
 #include "common/log.h"
@@ -16,24 +16,24 @@ TimerController::TimerController(System* system)
     timers[0] = &dot_timer;
     timers[1] = &hblank_timer;
     timers[2] = &system_timer;
-
-    // register timed event
-    sys->RegisterEvent(
-        System::TimedEvent::Timer, [this](u32 cycles) { Step(cycles); }, [this]() { return CyclesUntilNextEvent(); });
 }
 
 void TimerController::Step(u32 cycles) {
-    for (auto& timer : timers) timer->Step(cycles);
+    // called on the concrete timers so the calls don't go through the vtable
+    dot_timer.Step(cycles);
+    hblank_timer.Step(cycles);
+    system_timer.Step(cycles);
 }
 
 u32 TimerController::CyclesUntilNextEvent() {
-    u32 min_cycles = std::numeric_limits<u32>::max();
-
-    for (auto& timer : timers) {
-        min_cycles = std::min(min_cycles, timer->CyclesUntilNextEvent());
-    }
+    return std::min({dot_timer.CyclesUntilNextEvent(), hblank_timer.CyclesUntilNextEvent(),
+                     system_timer.CyclesUntilNextEvent()});
+}
 
-    return min_cycles;
+void TimerController::ScheduleEvents() {
+    sys->Schedule(System::TimedEvent::Timer, CyclesUntilNextEvent());
+    // the GPU event depends on the state of the timers that use the dotclock or hblank as their clock source
+    sys->Schedule(System::TimedEvent::GPU, sys->gpu->CyclesUntilNextEvent());
 }
 
 u32 TimerController::Load(u32 address) {
@@ -71,7 +71,7 @@ u32 TimerController::Load(u32 address) {
         Panic("Invalid timer register");
     }
 
-    sys->RecalculateCyclesUntilNextEvent();
+    ScheduleEvents();
 
     return value;
 }
@@ -115,7 +115,7 @@ void TimerController::Store(u32 address, u32 value) {
         Panic("Invalid timer register");
     }
 
-    sys->RecalculateCyclesUntilNextEvent();
+    ScheduleEvents();
 }
 
 u32 TimerController::Peek(u32 address) {
@@ -147,64 +147,3 @@ void TimerController::Reset() {
 
     system_timer.div_8_remainder = 0;
 }
-
-void TimerController::DrawTimerState(bool* open) {
-    ImGui::Begin("Timer State", open);
-    ImGui::Columns(4);
-
-    const ImVec4 white(1.0, 1.0, 1.0, 1.0);
-    const ImVec4 grey(0.5, 0.5, 0.5, 1.0);
-
-    const auto ClockSourceName = [](Timer* timer) {
-        if (timer->IsUsingSystemClock()) return "System Clock";
-        switch (timer->index) {
-            case TMR0: return "Dotclock";
-            case TMR1: return "HBlank";
-            case TMR2: return "System Clock / 8";
-        }
-        return "XXX";
-    };
-
-    ImGui::Text("Status");
-    ImGui::Text("Counter");
-    ImGui::Text("Target");
-
-    ImGui::Text("Sync");
-    ImGui::Text("Sync mode");
-
-    ImGui::Text("IRQ on target");
-    ImGui::Text("IRQ on max value");
-
-    ImGui::Text("IRQ Mode");
-    ImGui::Text("IRQ Mode");
-
-    ImGui::Text("Clock Source");
-
-    ImGui::Text("IRQ allowed");
-    ImGui::Text("Reached target");
-    ImGui::Text("Reached max value");
-
-    ImGui::NextColumn();
-
-    for (u32 i = 0; i < 3; i++) {
-        auto& timer = timers[i];
-        ImGui::Text("TMR%u [%s]", i, timer->paused ? "paused" : "running");
-        ImGui::Text("%u", timer->counter);
-        ImGui::Text("%u [%s]", timer->target & 0xFFFF,
-                    timer->mode.reset_mode == ResetMode::AfterTarget ? "enabled" : "disabled");
-        ImGui::Text("%s", timer->mode.sync_enabled ? "enabled" : "disabled");
-        ImGui::TextColored(timer->mode.sync_enabled ? white : grey, "%u", timer->mode.sync_mode.GetValue());
-        ImGui::Text("%s", timer->mode.irq_on_target ? "yes" : "no");
-        ImGui::Text("%s", timer->mode.irq_on_max_value ? "yes" : "no");
-        ImGui::Text("%s", timer->mode.irq_repeat_mode ? "Repeat" : "One-Shot");
-        ImGui::Text("%s", timer->mode.irq_toggle_mode ? "Toggle" : "Pulse");
-        ImGui::Text("%s", ClockSourceName(timer));
-        ImGui::Text("%s", timer->mode.allow_irq ? "yes" : "no");
-        ImGui::Text("%s", timer->mode.reached_target ? "true" : "false");
-        ImGui::Text("%s", timer->mode.reached_max_value ? "true" : "false");
-        ImGui::NextColumn();
-    }
-    ImGui::Columns(1);
-
-    ImGui::End();
-}
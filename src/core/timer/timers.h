@@ -18,8 +18,6 @@ public:
     void Step(u32 cycles);
     u32 CyclesUntilNextEvent();
 
-    void DrawTimerState(bool* open);
-
     BlankTimer dot_timer;
     BlankTimer hblank_timer;
     SystemTimer system_timer;
@@ -27,6 +25,8 @@ public:
     Timer* timers[3] = {};
 
 private:
+    void ScheduleEvents();
+
     static constexpr u32 MODE_WRITE_MASK = 0b1110001111111111;
 
     System* sys = nullptr;
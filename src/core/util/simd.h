@@ -0,0 +1,7 @@
+#pragma once
+
+// SSE2 is part of the x86-64 baseline, so no runtime detection is needed
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define USE_SSE2
+#endif
@@ -0,0 +1,284 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "common/config.h"
+#include "common/log.h"
+#include "emulator.h"
+#include "gpu.h"
+#include "profiler.h"
+
+LOG_CHANNEL(MAIN);
+
+namespace {
+
+constexpr u32 DEFAULT_FRAME_COUNT = 600;
+
+// writes the current display area as a binary PPM image
+bool DumpFrame(Emulator& emulator, const std::string& path) {
+    auto [hres, vres, is_24bpp] = emulator.DisplayInfo();
+    const u8* output = emulator.GetVideoOutput();
+
+    std::vector<u8> image(usize(hres) * vres * 3);
+    if (is_24bpp) {
+        std::copy(output, output + image.size(), image.begin());
+    } else {
+        for (usize i = 0; i < usize(hres) * vres; i++) {
+            const u16 pixel = static_cast<u16>(output[i * 2] | (output[i * 2 + 1] << 8));
+            // expand the 5 bit color components to 8 bit
+            const auto Expand = [](u32 c) { return static_cast<u8>((c << 3) | (c >> 2)); };
+            image[i * 3 + 0] = Expand(pixel & 0x1F);
+            image[i * 3 + 1] = Expand((pixel >> 5) & 0x1F);
+            image[i * 3 + 2] = Expand((pixel >> 10) & 0x1F);
+        }
+    }
+
+    std::ofstream file(path, std::ofstream::binary);
+    if (!file) return false;
+    file << "P6\n" << hres << " " << vres << "\n255\n";
+    file.write(reinterpret_cast<const char*>(image.data()), static_cast<std::streamsize>(image.size()));
+    return file.good();
+}
+
+// writes the raw VRAM contents (1024x512 halfwords, little endian)
+bool DumpVRAM(Emulator& emulator, const std::string& path) {
+    std::ofstream file(path, std::ofstream::binary);
+    if (!file) return false;
+    file.write(reinterpret_cast<const char*>(emulator.GetVRAM()), GPU::VRAM_SIZE * sizeof(u16));
+    return file.good();
+}
+
+// peak resident set size of the process in bytes
+u64 PeakMemoryUsage() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters = {};
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+    return counters.PeakWorkingSetSize;
+#else
+    rusage usage = {};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+    return static_cast<u64>(usage.ru_maxrss);
+#else
+    // reported in kilobytes
+    return static_cast<u64>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+void PrintProfile(const Profiler& profiler, std::vector<double>& frame_times) {
+    if (!frame_times.empty()) {
+        std::sort(frame_times.begin(), frame_times.end());
+        double sum = 0.0;
+        for (double time : frame_times) sum += time;
+
+        const auto Percentile = [&](double p) {
+            return frame_times[static_cast<usize>(p * static_cast<double>(frame_times.size() - 1))];
+        };
+        std::printf("Frame time: avg %.3f ms, median %.3f ms, 99th percentile %.3f ms, max %.3f ms\n",
+                    sum / frame_times.size() * 1e3, Percentile(0.5) * 1e3, Percentile(0.99) * 1e3,
+                    frame_times.back() * 1e3);
+    }
+
+    const double total = profiler.TotalSeconds();
+    std::printf("Host time per subsystem:\n");
+    for (u32 i = 0; i < Profiler::CATEGORY_COUNT; i++) {
+        const auto category = static_cast<Profiler::Category>(i);
+        const double seconds = profiler.Seconds(category);
+        std::printf("    %-10s %8.3f s %6.1f%%\n", Profiler::CategoryName(category), seconds,
+                    total > 0.0 ? seconds / total * 100.0 : 0.0);
+    }
+
+    std::printf("Peak memory: %.1f MiB\n", static_cast<double>(PeakMemoryUsage()) / (1024.0 * 1024.0));
+}
+
+void PrintUsageAndExit(int exit_code) {
+    std::printf("Usage: frustration-headless [OPTIONS]\n\n");
+    std::printf("Options:\n");
+    std::printf("    -h, --help              Display this message\n");
+    std::printf("    -B, --bios FILE         Set the BIOS source\n");
+    std::printf("    -b, --bin FILE          Execute the PSX binary\n");
+    std::printf("    -e, --psexe FILE        Inject and run the PSEXE file\n");
+    std::printf("    -n, --frames N          Number of frames to run (default: %u)\n", DEFAULT_FRAME_COUNT);
+    std::printf("    -p, --until-pc ADDRESS  Stop early once the CPU reaches the (hex) address\n");
+    std::printf("    -f, --dump-frame FILE   Write the final display area to a PPM image\n");
+    std::printf("    -v, --dump-vram FILE    Write the final VRAM contents to a raw 16bpp file\n");
+    std::printf("    -i, --interpreter       Disable the recompiler\n");
+    std::printf("    -t, --threaded-renderer Rasterize with the multithreaded software renderer\n");
+    std::printf("    -g, --gpu-thread        Rasterize on a dedicated GPU thread\n");
+    std::printf("    -P, --profile           Report frame times, host time per subsystem and peak memory\n");
+    std::printf("    -q, --quiet             Only log errors\n\n");
+
+    std::exit(exit_code);
+}
+
+}    // namespace
+
+int main(int argc, char* argv[]) {
+
+    // parse command line arguments
+
+    std::string arg_bios_path, arg_bin_path, arg_psexe_path, arg_frame_path, arg_vram_path;
+    u32 frame_count = DEFAULT_FRAME_COUNT;
+    u32 stop_address = 0;
+    bool use_stop_address = false;
+    bool use_interpreter = false;
+    bool use_threaded_renderer = false;
+    bool use_gpu_thread = false;
+    bool quiet = false;
+    bool profile = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg(argv[i]);
+
+        if (arg == "-h" || arg == "--help") PrintUsageAndExit(0);
+
+        const auto NextArg = [&]() {
+            if (i + 1 >= argc) PrintUsageAndExit(1);
+            return std::string(argv[i++ + 1]);
+        };
+
+        if (arg == "-B" || arg == "--bios") {
+            arg_bios_path = NextArg();
+            continue;
+        }
+        if (arg == "-b" || arg == "--bin") {
+            arg_bin_path = NextArg();
+            continue;
+        }
+        if (arg == "-e" || arg == "--psexe") {
+            arg_psexe_path = NextArg();
+            continue;
+        }
+        if (arg == "-n" || arg == "--frames") {
+            frame_count = static_cast<u32>(std::strtoul(NextArg().c_str(), nullptr, 10));
+            if (frame_count == 0) PrintUsageAndExit(1);
+            continue;
+        }
+        if (arg == "-p" || arg == "--until-pc") {
+            stop_address = static_cast<u32>(std::strtoul(NextArg().c_str(), nullptr, 16));
+            use_stop_address = true;
+            continue;
+        }
+        if (arg == "-f" || arg == "--dump-frame") {
+            arg_frame_path = NextArg();
+            continue;
+        }
+        if (arg == "-v" || arg == "--dump-vram") {
+            arg_vram_path = NextArg();
+            continue;
+        }
+        if (arg == "-i" || arg == "--interpreter") {
+            use_interpreter = true;
+            continue;
+        }
+        if (arg == "-t" || arg == "--threaded-renderer") {
+            use_threaded_renderer = true;
+            continue;
+        }
+        if (arg == "-g" || arg == "--gpu-thread") {
+            use_gpu_thread = true;
+            continue;
+        }
+        if (arg == "-P" || arg == "--profile") {
+            profile = true;
+            continue;
+        }
+        if (arg == "-q" || arg == "--quiet") {
+            quiet = true;
+            continue;
+        }
+
+        std::printf("Unknown argument '%s'\n", arg.data());
+        PrintUsageAndExit(1);
+    }
+
+    if (arg_bios_path.empty()) PrintUsageAndExit(1);
+
+    Log::Init(quiet ? spdlog::level::err : spdlog::level::warn);
+
+    // everything is configured through the command line
+    Config::config_file_enabled = false;
+    Config::bios_path.Set(arg_bios_path);
+    Config::ps_bin_file_path = arg_bin_path;
+    Config::psexe_file_path = arg_psexe_path;
+
+    Emulator emulator;
+    if (use_interpreter) emulator.SetRecompilerEnabled(false);
+    if (use_threaded_renderer) emulator.SetMultithreadedRendererEnabled(true);
+    if (use_gpu_thread) emulator.SetGpuThreadEnabled(true);
+
+    if (!emulator.LoadBIOS()) return 1;
+
+    if (!Config::psexe_file_path.empty() && !emulator.LoadPsExe()) {
+        LogErr("Failed to load PS-EXE file");
+        return 1;
+    }
+
+    if (use_stop_address) emulator.AddBreakpoint(stop_address);
+
+    emulator.SetPaused(false);
+
+    u32 frames = 0;
+    bool reached_stop_address = false;
+
+    // time measurement adds some overhead, so the profiler only runs if requested
+    Profiler& profiler = *emulator.GetSystem().profiler;
+    if (profile) profiler.Start();
+    std::vector<double> frame_times;
+    frame_times.reserve(frame_count);
+
+    const auto start = std::chrono::steady_clock::now();
+    auto frame_start = start;
+    while (frames < frame_count) {
+        emulator.RunFrame();
+
+        const auto frame_end = std::chrono::steady_clock::now();
+        frame_times.push_back(std::chrono::duration<double>(frame_end - frame_start).count());
+        frame_start = frame_end;
+
+        // only the breakpoint at the stop address can halt the CPU
+        if (emulator.IsPaused()) {
+            reached_stop_address = true;
+            break;
+        }
+
+        emulator.ResetDrawFrame();
+        frames++;
+    }
+    const auto end = std::chrono::steady_clock::now();
+    profiler.Stop();
+
+    const double seconds = std::chrono::duration<double>(end - start).count();
+    std::printf("Ran %u frames in %.3f s (%.2f FPS)\n", frames, seconds, frames / seconds);
+    if (use_stop_address) {
+        std::printf("%s stop address 0x%08X\n", reached_stop_address ? "Reached" : "Did not reach", stop_address);
+    }
+    if (profile) PrintProfile(profiler, frame_times);
+
+    if (!arg_frame_path.empty() && !DumpFrame(emulator, arg_frame_path)) {
+        LogErr("Failed to write frame to {}", arg_frame_path);
+        return 1;
+    }
+    if (!arg_vram_path.empty() && !DumpVRAM(emulator, arg_vram_path)) {
+        LogErr("Failed to write VRAM to {}", arg_vram_path);
+        return 1;
+    }
+
+    Log::Shutdown();
+
+    // a missed stop condition counts as a failed run
+    return (use_stop_address && !reached_stop_address) ? 2 : 0;
+}
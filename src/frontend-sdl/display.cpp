@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <ctime>
 #include <thread>
 #include <filesystem>
@@ -21,6 +22,7 @@
 #include "common/asserts.h"
 #include "common/config.h"
 #include "common/log.h"
+#include "debug_ui.h"
 #include "emulator.h"
 
 namespace fs = std::filesystem;
@@ -104,31 +106,37 @@ bool Display::Init(Emulator* system, SDL_Window* win, SDL_GLContext context, con
     ImGui_ImplSDL2_InitForOpenGL(window, gl_context);
     ImGui_ImplOpenGL3_Init(glsl_version);
 
-    // build the vram texture (always 15BPP)
+    // build the raw vram texture, integer textures can't be filtered
     glGenTextures(1, &vram_tex_handler);
     glBindTexture(GL_TEXTURE_2D, vram_tex_handler);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 1024, 512, 0, GL_RGBA, GL_UNSIGNED_SHORT_1_5_5_5_REV, system->GetVRAM());
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R16UI, 1024, 512, 0, GL_RED_INTEGER, GL_UNSIGNED_SHORT, system->GetVRAM());
     GLenum status;
     if ((status = glGetError()) != GL_NO_ERROR) {
         LogCrit("OpenGL error {} during texture creation", status);
         return false;
     }
-    glBindTexture(GL_TEXTURE_2D, 0);
 
-    // build the output texture (can be either 15BPP or 24BPP)
-    glGenTextures(1, &output_tex_handler);
-    glBindTexture(GL_TEXTURE_2D, output_tex_handler);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 1024, 512, 0, GL_RGBA, GL_UNSIGNED_SHORT_1_5_5_5_REV, nullptr);
-    if ((status = glGetError()) != GL_NO_ERROR) {
-        LogCrit("OpenGL error {} during texture creation", status);
-        return false;
+    // build the vram view texture (always 15BPP) and the output texture (converted from either 15BPP or 24BPP)
+    for (GLuint* handler : {&vram_view_tex_handler, &output_tex_handler}) {
+        glGenTextures(1, handler);
+        glBindTexture(GL_TEXTURE_2D, *handler);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1024, 512, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        if ((status = glGetError()) != GL_NO_ERROR) {
+            LogCrit("OpenGL error {} during texture creation", status);
+            return false;
+        }
     }
     glBindTexture(GL_TEXTURE_2D, 0);
 
+    if (!CreateDisplayProgram(glsl_version)) return false;
+    ConvertVram(vram_view_tex_handler, {.width = GPU::VRAM_WIDTH, .height = GPU::VRAM_HEIGHT}, -1);
+
+    if (!vram_upload.Init(GPU::VRAM_SIZE * sizeof(u16))) return false;
+
     start = std::chrono::system_clock::now();
     end = std::chrono::system_clock::now();
     return true;
@@ -178,6 +186,22 @@ void Display::Draw() {
             if (ImGui::MenuItem("Pause", "H", &emu_paused)) emu->SetPaused(emu_paused);
             if (ImGui::MenuItem("Reset", "R")) emu->Reset();
             ImGui::Separator();
+            bool code_cache = Config::cpu_code_cache.Get();
+            if (ImGui::MenuItem("CPU Code Cache", nullptr, &code_cache)) emu->SetCodeCacheEnabled(code_cache);
+#ifdef USE_RECOMPILER
+            bool recompiler = Config::cpu_recompiler.Get();
+            if (ImGui::MenuItem("CPU Recompiler", nullptr, &recompiler)) emu->SetRecompilerEnabled(recompiler);
+            bool differential = Config::recompiler_differential_testing;
+            if (ImGui::MenuItem("Recompiler Differential Testing", nullptr, &differential))
+                emu->SetRecompilerDifferentialTesting(differential);
+#endif
+            ImGui::Separator();
+            bool multithreaded = Config::gpu_multithreaded_renderer.Get();
+            if (ImGui::MenuItem("Multithreaded Renderer", nullptr, &multithreaded))
+                emu->SetMultithreadedRendererEnabled(multithreaded);
+            bool gpu_thread = Config::gpu_thread.Get();
+            if (ImGui::MenuItem("GPU Thread", nullptr, &gpu_thread)) emu->SetGpuThreadEnabled(gpu_thread);
+            ImGui::MenuItem("Bob Deinterlacing", nullptr, &bob_deinterlacing);
             ImGui::EndMenu();
         }
         if (ImGui::BeginMenu("Window")) {
@@ -255,36 +279,26 @@ void Display::Draw() {
     }
 
     // HACK: place emulator into a separate window to delay dealing with OpenGL
+    const GPU::VramRows dirty_rows = UpdateVramTextures();
     {
-        glBindTexture(GL_TEXTURE_2D, vram_tex_handler);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 1024, 512, 0, GL_RGBA, GL_UNSIGNED_SHORT_1_5_5_5_REV, emu->GetVRAM());
-
         ImGui::SetNextWindowSize(ImVec2(1024 + 25, 512 + 60));
         ImGui::Begin("VRAM", nullptr, ImGuiWindowFlags_NoScrollbar);
-        ImGui::Image((void*)(intptr_t)vram_tex_handler, ImVec2(1024, 512));
+        ImGui::Image((void*)(intptr_t)vram_view_tex_handler, ImVec2(1024, 512));
         ImGui::End();
     }
 
     // video output
     {
-        auto [hres, vres, in_24_bpp_mode] = emu->DisplayInfo();
-
-        glBindTexture(GL_TEXTURE_2D, output_tex_handler);
-        if (in_24_bpp_mode) {
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, (GLsizei)hres, (GLsizei)vres, 0, GL_RGB, GL_UNSIGNED_BYTE,
-                         emu->GetVideoOutput());
-        } else {
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, (GLsizei)hres, (GLsizei)vres, 0, GL_RGBA,
-                         GL_UNSIGNED_SHORT_1_5_5_5_REV, emu->GetVideoOutput());
-        }
+        UpdateOutputTexture(dirty_rows);
+        const ImVec2 size((float)output_area.width, (float)output_area.height);
 
-        ImGui::SetNextWindowSize(ImVec2(hres + 25, vres + 60));
+        ImGui::SetNextWindowSize(ImVec2(size.x + 25, size.y + 60));
         ImGui::Begin("Video", nullptr, ImGuiWindowFlags_NoScrollbar);
-        ImGui::Image((void*)(intptr_t)output_tex_handler, ImVec2(hres, vres));
+        ImGui::Image((void*)(intptr_t)output_tex_handler, size);
         ImGui::End();
     }
 
-    emu->DrawDebugWindows();
+    DebugUI::DrawDebugWindows(emu->GetSystem());
 
     if (show_demo_window) ImGui::ShowDemoWindow(&show_demo_window);
 
@@ -292,6 +306,199 @@ void Display::Draw() {
     DrawDragAndDropPopup();
 }
 
+GPU::VramRows Display::UpdateVramTextures() {
+    // only upload the rows that got written since the last frame
+    const u16* vram = emu->GetVRAM();
+    const GPU::VramRows dirty_rows = emu->TakeDirtyVramRows();
+    if (!dirty_rows.Any()) return dirty_rows;
+
+    const auto ForEachDirtyRun = [&dirty_rows](auto function) {
+        for (u32 row = 0; row < GPU::VRAM_HEIGHT;) {
+            if (!dirty_rows.Test(row)) {
+                row++;
+                continue;
+            }
+            u32 end = row + 1;
+            while (end < GPU::VRAM_HEIGHT && dirty_rows.Test(end)) end++;
+            function(row, end - row);
+            row = end;
+        }
+    };
+
+    // the rows keep their place inside of the buffer, all of them have to be written before the first upload
+    constexpr u32 ROW_BYTES = GPU::VRAM_WIDTH * sizeof(u16);
+    u8* buffer = vram_upload.Map();
+    ForEachDirtyRun([&](u32 row, u32 count) {
+        std::memcpy(buffer + ROW_BYTES * row, vram + GPU::VRAM_WIDTH * row, ROW_BYTES * count);
+    });
+
+    glBindTexture(GL_TEXTURE_2D, vram_tex_handler);
+    ForEachDirtyRun([&](u32 row, u32 count) {
+        vram_upload.Upload(ROW_BYTES * row, 0, (s32)row, GPU::VRAM_WIDTH, (s32)count, GL_RED_INTEGER,
+                           GL_UNSIGNED_SHORT);
+    });
+    vram_upload.Finish();
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    ConvertVram(vram_view_tex_handler, {.width = GPU::VRAM_WIDTH, .height = GPU::VRAM_HEIGHT}, -1);
+    return dirty_rows;
+}
+
+void Display::UpdateOutputTexture(const GPU::VramRows& dirty_rows) {
+    GPU::DisplayArea area = emu->GetDisplayArea();
+    const bool bob = bob_deinterlacing && area.interlaced;
+    // the field only matters if just one of them is shown
+    if (!bob) area.field = 0;
+
+    if (area.width != output_area.width || area.height != output_area.height) {
+        glBindTexture(GL_TEXTURE_2D, output_tex_handler);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, (GLsizei)area.width, (GLsizei)area.height, 0, GL_RGBA,
+                     GL_UNSIGNED_BYTE, nullptr);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        output_valid = false;
+    }
+
+    // static images (menus, loading screens) don't get converted again
+    bool changed = !output_valid || area.x != output_area.x || area.y != output_area.y ||
+                   area.is_24bpp != output_area.is_24bpp || area.field != output_area.field;
+    for (u32 row = 0; row < area.height && !changed; row++) changed = dirty_rows.Test((area.y + row) % GPU::VRAM_HEIGHT);
+
+    output_area = area;
+    if (!changed) return;
+
+    ConvertVram(output_tex_handler, area, bob ? static_cast<s32>(area.field) : -1);
+    output_valid = true;
+}
+
+bool Display::CreateDisplayProgram(const char* glsl_version) {
+    // one triangle that covers the whole target, the texture coordinates are in pixels
+    const char* vertex_source = R"(
+uniform vec2 size;
+out vec2 tex_coord;
+
+void main() {
+    vec2 position = vec2(float((gl_VertexID << 1) & 2), float(gl_VertexID & 2));
+    tex_coord = position * size;
+    gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+}
+)";
+
+    // crops the display area out of VRAM and converts it to RGB
+    // 24-bit pixels span two halfwords and start at either the low or the high byte of the first one
+    const char* fragment_source = R"(
+uniform usampler2D vram;
+uniform ivec2 origin;
+uniform bool is_24bpp;
+uniform int field;
+in vec2 tex_coord;
+out vec4 color;
+
+uint Fetch(int x, int y) {
+    return texelFetch(vram, ivec2(x & 1023, y & 511), 0).r;
+}
+
+void main() {
+    ivec2 position = ivec2(tex_coord);
+    // bob deinterlacing doubles the lines of the current field
+    int y = origin.y + (field < 0 ? position.y : ((position.y & ~1) | field));
+
+    if (is_24bpp) {
+        int byte_x = origin.x * 2 + position.x * 3;
+        uint low = Fetch(byte_x >> 1, y), high = Fetch((byte_x >> 1) + 1, y);
+        uint rgb = (byte_x & 1) == 0 ? (low | (high << 16)) : ((low >> 8) | (high << 8));
+        color = vec4(float(rgb & 0xFFu), float((rgb >> 8) & 0xFFu), float((rgb >> 16) & 0xFFu), 255.0) / 255.0;
+    } else {
+        uint pixel = Fetch(origin.x + position.x, y);
+        color = vec4(float(pixel & 0x1Fu), float((pixel >> 5) & 0x1Fu), float((pixel >> 10) & 0x1Fu), 31.0) / 31.0;
+    }
+}
+)";
+
+    const auto Compile = [glsl_version](GLenum type, const char* source) -> GLuint {
+        const GLuint shader = glCreateShader(type);
+        const char* sources[] = {glsl_version, "\n", source};
+        glShaderSource(shader, 3, sources, nullptr);
+        glCompileShader(shader);
+
+        GLint success = GL_FALSE;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+        if (success != GL_TRUE) {
+            char log[1024] = {};
+            glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+            LogCrit("Failed to compile display shader: {}", log);
+            glDeleteShader(shader);
+            return 0;
+        }
+        return shader;
+    };
+
+    const GLuint vertex_shader = Compile(GL_VERTEX_SHADER, vertex_source);
+    const GLuint fragment_shader = Compile(GL_FRAGMENT_SHADER, fragment_source);
+    if (!vertex_shader || !fragment_shader) return false;
+
+    display_program = glCreateProgram();
+    glAttachShader(display_program, vertex_shader);
+    glAttachShader(display_program, fragment_shader);
+    glBindFragDataLocation(display_program, 0, "color");
+    glLinkProgram(display_program);
+    glDeleteShader(vertex_shader);
+    glDeleteShader(fragment_shader);
+
+    GLint success = GL_FALSE;
+    glGetProgramiv(display_program, GL_LINK_STATUS, &success);
+    if (success != GL_TRUE) {
+        char log[1024] = {};
+        glGetProgramInfoLog(display_program, sizeof(log), nullptr, log);
+        LogCrit("Failed to link display program: {}", log);
+        return false;
+    }
+
+    origin_location = glGetUniformLocation(display_program, "origin");
+    size_location = glGetUniformLocation(display_program, "size");
+    is_24bpp_location = glGetUniformLocation(display_program, "is_24bpp");
+    field_location = glGetUniformLocation(display_program, "field");
+    glUseProgram(display_program);
+    glUniform1i(glGetUniformLocation(display_program, "vram"), 0);
+    glUseProgram(0);
+
+    // core profiles can't draw without a vertex array, even if it has no attributes
+    glGenVertexArrays(1, &vertex_array);
+    glGenFramebuffers(1, &framebuffer);
+
+    GLenum status;
+    if ((status = glGetError()) != GL_NO_ERROR) {
+        LogCrit("OpenGL error {} during display program creation", status);
+        return false;
+    }
+    return true;
+}
+
+void Display::ConvertVram(GLuint target, const GPU::DisplayArea& area, s32 field) {
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target, 0);
+    glViewport(0, 0, (GLsizei)area.width, (GLsizei)area.height);
+    glDisable(GL_BLEND);
+    glDisable(GL_SCISSOR_TEST);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_CULL_FACE);
+
+    glUseProgram(display_program);
+    glUniform2i(origin_location, (GLint)area.x, (GLint)area.y);
+    glUniform2f(size_location, (float)area.width, (float)area.height);
+    glUniform1i(is_24bpp_location, area.is_24bpp);
+    glUniform1i(field_location, field);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, vram_tex_handler);
+    glBindVertexArray(vertex_array);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glUseProgram(0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
 void Display::DrawDragAndDropPopup() {
     if (ImGui::BeginPopupModal("Dropped File", nullptr, ImGuiWindowFlags_AlwaysAutoResize)) {
         std::string dropped_filename = fs::path(dropped_file).filename();
@@ -354,7 +561,7 @@ void Display::SaveScreenshot() {
     }
     std::string filename(buffer);
 
-    auto [hres, vres, _] = emu->DisplayInfo();
+    const u32 hres = output_area.width, vres = output_area.height;
     std::vector<u8> image_buffer(usize(hres) * usize(vres) * 3);
 
     glBindTexture(GL_TEXTURE_2D, output_tex_handler);
@@ -6,6 +6,8 @@
 #include <chrono>
 #include <string>
 
+#include "gpu.h"
+#include "upload_buffer.h"
 #include "util/types.h"
 
 class Emulator;
@@ -28,13 +30,36 @@ public:
 private:
     void DrawDragAndDropPopup();
 
+    bool CreateDisplayProgram(const char* glsl_version);
+    // converts the area of the raw VRAM texture into the RGB target texture, a field of -1 shows both fields
+    void ConvertVram(GLuint target, const GPU::DisplayArea& area, s32 field);
+    // uploads the rows of VRAM that got written since the last frame and returns them
+    GPU::VramRows UpdateVramTextures();
+    void UpdateOutputTexture(const GPU::VramRows& dirty_rows);
+
     std::string dropped_file;
 
     bool show_demo_window = false;
 
+    // raw VRAM contents as 16-bit integers, all display conversion happens in the display program
     GLuint vram_tex_handler = 0;
+    UploadBuffer vram_upload;
+
+    // the whole VRAM interpreted as 15-bit colors
+    GLuint vram_view_tex_handler = 0;
 
     GLuint output_tex_handler = 0;
+    // display area that is currently converted into the output texture
+    GPU::DisplayArea output_area;
+    bool output_valid = false;
+
+    // only show the current field of interlaced frames, with every line doubled
+    bool bob_deinterlacing = false;
+
+    GLuint display_program = 0;
+    GLint origin_location = -1, size_location = -1, is_24bpp_location = -1, field_location = -1;
+    GLuint vertex_array = 0;
+    GLuint framebuffer = 0;
 
     SDL_Window* window = nullptr;
     SDL_GLContext gl_context = nullptr;
@@ -178,11 +178,7 @@ int main(int argc, char* argv[]) {
     while (!emulator.done) {
         if (!emulator.IsPaused()) {
 
-            while (!emulator.DrawNextFrame()) {
-                emulator.Tick();
-                // cpu reached a breakpoint
-                if (emulator.IsPaused()) [[unlikely]] break;
-            }
+            emulator.RunFrame();
 
             // check if ready to draw next frame again because the cpu could have hit a breakpoint
             // before reaching the next vblank
@@ -0,0 +1,112 @@
+#include "upload_buffer.h"
+
+#include <cstdint>
+#include <cstring>
+
+#include "common/asserts.h"
+#include "common/log.h"
+
+LOG_CHANNEL(Display);
+
+static bool HasExtension(const char* name) {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++) {
+        const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+        if (extension && std::strcmp(extension, name) == 0) return true;
+    }
+    return false;
+}
+
+bool UploadBuffer::Init(u32 size) {
+    region_size = size;
+    const GLsizeiptr buffer_size = GLsizeiptr(size) * REGION_COUNT;
+
+    // the loader returns function pointers even for unsupported functions, so only the version and extensions count
+    // fences are core since 3.2, without them a persistent mapping can't be synchronized
+    has_sync = gl3wIsSupported(3, 2) || HasExtension("GL_ARB_sync");
+    persistent = has_sync && (gl3wIsSupported(4, 4) || HasExtension("GL_ARB_buffer_storage"));
+
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+
+    if (persistent) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_PIXEL_UNPACK_BUFFER, buffer_size, nullptr, flags);
+        persistent_memory = static_cast<u8*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, buffer_size, flags));
+        if (!persistent_memory) {
+            LogWarn("Failed to map pixel buffer persistently, falling back to mapping it every frame");
+            persistent = false;
+            glDeleteBuffers(1, &buffer);
+            glGenBuffers(1, &buffer);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+        }
+    }
+    if (!persistent) glBufferData(GL_PIXEL_UNPACK_BUFFER, buffer_size, nullptr, GL_STREAM_DRAW);
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    GLenum status;
+    if ((status = glGetError()) != GL_NO_ERROR) {
+        LogCrit("OpenGL error {} during pixel buffer creation", status);
+        return false;
+    }
+
+    LogInfo("Pixel buffer upload: {} x {} KiB ({})", REGION_COUNT, size / 1024,
+            persistent ? "persistent mapping" : "mapped per frame");
+    return true;
+}
+
+u8* UploadBuffer::Map() {
+    DebugAssert(!mapped);
+
+    // the GPU might still be copying the contents from three frames ago
+    if (GLsync& fence = fences[region]; fence) {
+        while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1'000'000'000) == GL_TIMEOUT_EXPIRED) {}
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    mapped = true;
+    if (persistent) return persistent_memory + usize(region) * region_size;
+
+    // without a fence the driver has to synchronize the mapping on its own
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT;
+    if (has_sync) flags |= GL_MAP_UNSYNCHRONIZED_BIT;
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+    void* memory = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, GLintptr(region) * region_size, region_size, flags);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    Assert(memory);
+    return static_cast<u8*>(memory);
+}
+
+void UploadBuffer::Upload(u32 offset, s32 x, s32 y, s32 width, s32 height, GLenum format, GLenum type) {
+    DebugAssert(mapped || !persistent);
+    DebugAssert(offset < region_size);
+    Unmap();
+
+    // with a bound unpack buffer the data pointer is an offset into the buffer
+    const uintptr_t buffer_offset = uintptr_t(region) * region_size + offset;
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, format, type, reinterpret_cast<const void*>(buffer_offset));
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void UploadBuffer::Finish() {
+    Unmap();
+    mapped = false;
+
+    if (has_sync) fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    region = (region + 1) % REGION_COUNT;
+}
+
+void UploadBuffer::Unmap() {
+    // persistent mappings stay valid while the GPU reads from them
+    if (persistent || !mapped) return;
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    mapped = false;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <GL/gl3w.h>
+
+#include <array>
+
+#include "util/types.h"
+
+// Streams pixel data into textures through a ring of three pixel buffer regions.
+// The CPU writes a frame into one region while the GPU can still copy the previous ones into their textures,
+// so neither side waits for the other and the textures never get reallocated.
+// The buffer stays persistently mapped if the driver supports ARB_buffer_storage, otherwise every region gets
+// mapped for one frame at a time.
+class UploadBuffer {
+public:
+    bool Init(u32 size);
+
+    // returns the memory of the next region, waits until the GPU is done with its previous contents
+    u8* Map();
+    // copies data written through Map() into the texture bound to GL_TEXTURE_2D, offset is relative to the region
+    void Upload(u32 offset, s32 x, s32 y, s32 width, s32 height, GLenum format, GLenum type);
+    // hands the region over to the GPU, has to follow every Map() call
+    void Finish();
+
+    bool IsPersistent() const { return persistent; }
+
+private:
+    static constexpr u32 REGION_COUNT = 3;
+
+    void Unmap();
+
+    GLuint buffer = 0;
+    u32 region_size = 0;
+    u32 region = 0;
+
+    bool has_sync = false;
+    bool persistent = false;
+    u8* persistent_memory = nullptr;
+    bool mapped = false;
+
+    // signaled once the GPU finished copying out of the region
+    std::array<GLsync, REGION_COUNT> fences = {};
+};